@@ -16,31 +16,58 @@ limitations under the License.
 
 #pragma once
 #include "avec/BoostAlign.hpp"
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <cmath>
+#include <cstdint>
 #include <vector>
 
-#define AVEC_ASSERT_ALIGNMENT(ptr, Vec)                                        \
-  assert(boost::alignment::is_aligned(                                         \
-    ptr, avec::size<Vec>() * sizeof(typename ScalarTypes<Vec>::Float)));
+// T can be a simd vector type, or a container with an Alignment template
+// argument, see AlignmentOf
+#define AVEC_ASSERT_ALIGNMENT(ptr, T)                                          \
+  assert(boost::alignment::is_aligned(ptr, avec::AlignmentOf<T>::value));
 
-#define AVEC_ASSUME_ALIGNMENT(ptr, Vec)                                        \
-  BOOST_ALIGN_ASSUME_ALIGNED(                                                  \
-    ptr, avec::size<Vec>() * sizeof(typename ScalarTypes<Vec>::Float));
+#define AVEC_ASSUME_ALIGNMENT(ptr, T)                                          \
+  BOOST_ALIGN_ASSUME_ALIGNED(ptr, avec::AlignmentOf<T>::value);
+
+// the default alignment of the containers, can be overridden, for example to
+// 128 for cpus with 128 bytes cache lines
+#ifndef AVEC_DEFAULT_ALIGNMENT
+#define AVEC_DEFAULT_ALIGNMENT 64
+#endif
 
 namespace avec {
 
-constexpr std::size_t ALIGNMENT = 64; // cache line
+constexpr std::size_t ALIGNMENT = AVEC_DEFAULT_ALIGNMENT; // cache line
+
+static_assert(boost::alignment::detail::is_alignment_constant<ALIGNMENT>::value,
+              "AVEC_DEFAULT_ALIGNMENT must be a power of two");
 
 /**
- * std::vector aligned to the width of a cache line using
- * boost::alignment::aligned_allocator.
- * @tparam T type of elements held by the std::vector
+ * Static template class with the alignment, in bytes, guaranteed for the memory
+ * of T. For simd vector types it is the size of the vector, see Traits.hpp,
+ * for containers it is their Alignment template argument.
+ * @tparam T a simd vector type or a container.
  */
 template<class T>
+struct AlignmentOf;
+
+/**
+ * std::vector aligned to the width of a cache line, or to any other alignment,
+ * using boost::alignment::aligned_allocator.
+ * @tparam T type of elements held by the std::vector
+ * @tparam Alignment the alignment of the memory, in bytes.
+ */
+template<class T, std::size_t Alignment = ALIGNMENT>
 using aligned_vector =
-  std::vector<T, boost::alignment::aligned_allocator<T, ALIGNMENT>>;
+  std::vector<T, boost::alignment::aligned_allocator<T, Alignment>>;
+
+template<class T, std::size_t Alignment>
+struct AlignmentOf<aligned_vector<T, Alignment>>
+{
+  static constexpr std::size_t value = Alignment;
+};
 
 /**
  * Deleter for unique_ptr holding memory allocated using
@@ -60,22 +87,349 @@ using aligned_ptr = std::unique_ptr<T, AlignedDeleter>;
 /**
  *Template class that provides static methods to construct aligned unique_ptr or
  *aligned_vector of the class specified as its template argument.
+ * @tparam Alignment the alignment of the memory, in bytes.
  */
-template<class Class>
+template<class Class, std::size_t Alignment = ALIGNMENT>
 class Aligned final
 {
 public:
   template<class HolderClass = Class>
   static aligned_ptr<HolderClass> make()
   {
-    auto ptr = boost::alignment::aligned_alloc(ALIGNMENT, sizeof(Class));
+    auto ptr = boost::alignment::aligned_alloc(
+      std::max(Alignment, std::alignment_of<Class>::value), sizeof(Class));
     return aligned_ptr<HolderClass>(new (ptr) Class);
   }
 
-  static aligned_vector<Class> make(int num)
+  static aligned_vector<Class, Alignment> make(int num)
+  {
+    return aligned_vector<Class, Alignment>(num);
+  }
+};
+
+/**
+ * A monotonic (bump) arena of cache line aligned memory. Each allocation is
+ * just a pointer increment, consecutive allocations are adjacent in memory, and
+ * everything is released at once calling reset(), typically at the beginning
+ * of each processing block.
+ */
+class AlignedArena final
+{
+  aligned_ptr<unsigned char> memory;
+  std::size_t capacity = 0;
+  std::size_t offset = 0;
+
+public:
+  /**
+   * Constructor.
+   * @param capacityInBytes the size of the memory block to allocate.
+   */
+  explicit AlignedArena(std::size_t capacityInBytes = 0)
+  {
+    setCapacity(capacityInBytes);
+  }
+
+  /**
+   * Allocates a new memory block for the arena, releasing the previous one. Any
+   * memory previously served by the arena is no longer valid after this call.
+   * @param capacityInBytes the size of the memory block to allocate.
+   */
+  void setCapacity(std::size_t capacityInBytes)
+  {
+    capacityInBytes = (capacityInBytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    memory.reset(static_cast<unsigned char*>(
+      capacityInBytes > 0
+        ? boost::alignment::aligned_alloc(ALIGNMENT, capacityInBytes)
+        : nullptr));
+    capacity = memory ? capacityInBytes : 0;
+    offset = 0;
+  }
+
+  /**
+   * Serves a piece of memory from the arena.
+   * @param numBytes the size of the memory to allocate.
+   * @param alignment the alignment of the memory to allocate. It must be a
+   * power of two, not greater than ALIGNMENT.
+   * @return a pointer to the allocated memory, or nullptr if there is not
+   * enough space left in the arena.
+   */
+  void* allocate(std::size_t numBytes, std::size_t alignment = ALIGNMENT)
+  {
+    assert(boost::alignment::detail::is_alignment(alignment));
+    assert(alignment <= ALIGNMENT);
+    auto const begin = (offset + alignment - 1) & ~(alignment - 1);
+    if (begin > capacity || numBytes > capacity - begin) {
+      return nullptr;
+    }
+    offset = begin + numBytes;
+    return memory.get() + begin;
+  }
+
+  /**
+   * Releases all the memory served by the arena, which can then be reused.
+   */
+  void reset() { offset = 0; }
+
+  /**
+   * @return the size of the memory block of the arena, in bytes.
+   */
+  std::size_t getCapacity() const { return capacity; }
+
+  /**
+   * @return the amount of memory served by the arena since the last reset, in
+   * bytes, including the padding needed for alignment.
+   */
+  std::size_t getNumAllocatedBytes() const { return offset; }
+};
+
+/**
+ * A pool of fixed size, cache line aligned, blocks of memory, managed with a
+ * free list. Both allocation and deallocation are O(1).
+ */
+class AlignedPool final
+{
+  aligned_ptr<unsigned char> memory;
+  void* freeList = nullptr;
+  std::size_t blockSize = 0;
+  std::size_t numBlocks = 0;
+  std::size_t numFreeBlocks = 0;
+
+public:
+  /**
+   * Constructor.
+   * @param blockSize the size of each block, in bytes. It is rounded up to a
+   * multiple of ALIGNMENT.
+   * @param numBlocks the number of blocks to allocate.
+   */
+  AlignedPool(std::size_t blockSize, std::size_t numBlocks)
+    : blockSize((std::max(blockSize, sizeof(void*)) + ALIGNMENT - 1) &
+                ~(ALIGNMENT - 1))
+    , numBlocks(numBlocks)
+  {
+    if (numBlocks == 0) {
+      return;
+    }
+    memory.reset(static_cast<unsigned char*>(boost::alignment::aligned_alloc(
+      ALIGNMENT, this->blockSize * numBlocks)));
+    if (!memory) {
+      this->numBlocks = 0;
+      return;
+    }
+    for (std::size_t i = numBlocks; i > 0; --i) {
+      deallocate(memory.get() + (i - 1) * this->blockSize);
+    }
+  }
+
+  /**
+   * Takes a block from the pool.
+   * @return a pointer to the block, or nullptr if the pool is exhausted.
+   */
+  void* allocate()
+  {
+    if (!freeList) {
+      return nullptr;
+    }
+    auto block = freeList;
+    freeList = *static_cast<void**>(block);
+    --numFreeBlocks;
+    return block;
+  }
+
+  /**
+   * Gives a block back to the pool.
+   * @param block pointer to a block previously obtained from allocate().
+   */
+  void deallocate(void* block)
+  {
+    if (!block) {
+      return;
+    }
+    assert(static_cast<unsigned char*>(block) >= memory.get() &&
+           static_cast<unsigned char*>(block) <
+             memory.get() + blockSize * numBlocks);
+    *static_cast<void**>(block) = freeList;
+    freeList = block;
+    ++numFreeBlocks;
+  }
+
+  /**
+   * @return the size of each block, in bytes.
+   */
+  std::size_t getBlockSize() const { return blockSize; }
+
+  /**
+   * @return the total number of blocks.
+   */
+  std::size_t getNumBlocks() const { return numBlocks; }
+
+  /**
+   * @return the number of blocks that are not in use.
+   */
+  std::size_t getNumFreeBlocks() const { return numFreeBlocks; }
+};
+
+/**
+ * Allocator serving cache line aligned memory from an AlignedArena, to be used
+ * with std::vector and VecBuffer. Deallocation is a no-op: the memory is
+ * reclaimed when the arena is reset. The arena must outlive the containers
+ * using it.
+ * @tparam T type of the elements to allocate.
+ */
+template<class T>
+class ArenaAllocator
+{
+  template<class U>
+  friend class ArenaAllocator;
+
+  AlignedArena* arena = nullptr;
+
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template<class U>
+  struct rebind
+  {
+    using other = ArenaAllocator<U>;
+  };
+
+  ArenaAllocator(AlignedArena& arena) noexcept
+    : arena(&arena)
+  {}
+
+  template<class U>
+  ArenaAllocator(ArenaAllocator<U> const& other) noexcept
+    : arena(other.arena)
+  {}
+
+  T* allocate(std::size_t size)
+  {
+    if (size == 0) {
+      return nullptr;
+    }
+    assert(arena);
+    void* p = arena->allocate(sizeof(T) * size,
+                              std::max(ALIGNMENT, std::alignment_of<T>::value));
+    if (!p) {
+#ifndef BOOST_NO_EXCEPTIONS
+      throw std::bad_alloc();
+#endif
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T*, std::size_t) {}
+
+  /**
+   * @return the arena used by the allocator.
+   */
+  AlignedArena* getArena() const { return arena; }
+};
+
+template<class T, class U>
+inline bool
+operator==(ArenaAllocator<T> const& a, ArenaAllocator<U> const& b) noexcept
+{
+  return a.getArena() == b.getArena();
+}
+
+template<class T, class U>
+inline bool
+operator!=(ArenaAllocator<T> const& a, ArenaAllocator<U> const& b) noexcept
+{
+  return !(a == b);
+}
+
+/**
+ * Allocator serving cache line aligned memory from an AlignedPool, to be used
+ * with std::vector and VecBuffer. Each allocation takes a whole block of the
+ * pool, so it must fit in AlignedPool::getBlockSize() bytes. The pool must
+ * outlive the containers using it.
+ * @tparam T type of the elements to allocate.
+ */
+template<class T>
+class PoolAllocator
+{
+  template<class U>
+  friend class PoolAllocator;
+
+  AlignedPool* pool = nullptr;
+
+public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template<class U>
+  struct rebind
   {
-    return aligned_vector<Class>(num);
+    using other = PoolAllocator<U>;
+  };
+
+  PoolAllocator(AlignedPool& pool) noexcept
+    : pool(&pool)
+  {}
+
+  template<class U>
+  PoolAllocator(PoolAllocator<U> const& other) noexcept
+    : pool(other.pool)
+  {}
+
+  T* allocate(std::size_t size)
+  {
+    if (size == 0) {
+      return nullptr;
+    }
+    assert(pool);
+    static_assert(std::alignment_of<T>::value <= ALIGNMENT,
+                  "PoolAllocator can not satisfy the alignment of T");
+    void* p = sizeof(T) * size <= pool->getBlockSize() ? pool->allocate()
+                                                        : nullptr;
+    if (!p) {
+#ifndef BOOST_NO_EXCEPTIONS
+      throw std::bad_alloc();
+#endif
+    }
+    return static_cast<T*>(p);
   }
+
+  void deallocate(T* ptr, std::size_t) { pool->deallocate(ptr); }
+
+  /**
+   * @return the pool used by the allocator.
+   */
+  AlignedPool* getPool() const { return pool; }
 };
 
+template<class T, class U>
+inline bool
+operator==(PoolAllocator<T> const& a, PoolAllocator<U> const& b) noexcept
+{
+  return a.getPool() == b.getPool();
+}
+
+template<class T, class U>
+inline bool
+operator!=(PoolAllocator<T> const& a, PoolAllocator<U> const& b) noexcept
+{
+  return !(a == b);
+}
+
+/**
+ * std::vector using an ArenaAllocator.
+ * @tparam T type of elements held by the std::vector
+ */
+template<class T>
+using arena_vector = std::vector<T, ArenaAllocator<T>>;
+
+/**
+ * std::vector using a PoolAllocator.
+ * @tparam T type of elements held by the std::vector
+ */
+template<class T>
+using pool_vector = std::vector<T, PoolAllocator<T>>;
+
 } // namespace avec
\ No newline at end of file
@@ -15,32 +15,132 @@ limitations under the License.
 */
 
 #pragma once
+#include "avec/BufferFile.hpp"
+#include "avec/HugePages.hpp"
 #include "avec/InterleavedBuffer.hpp"
+#include "avec/Numa.hpp"
+#include "avec/PackedVecBuffer.hpp"
+#include "avec/PcmReader.hpp"
+#include "avec/Recorder.hpp"
+#include "avec/VecExpression.hpp"
+#include "avec/VecSpan.hpp"
 
-template<class T>
-using aligned_vector = avec::aligned_vector<T>;
+template<class T, std::size_t Alignment = avec::ALIGNMENT>
+using aligned_vector = avec::aligned_vector<T, Alignment>;
 
 template<class T>
 using aligned_ptr = avec::aligned_ptr<T>;
 
+template<class T, std::size_t Alignment = avec::ALIGNMENT>
+using Aligned = avec::Aligned<T, Alignment>;
+
+using AlignedArena = avec::AlignedArena;
+
+using AlignedPool = avec::AlignedPool;
+
+template<class T>
+using ArenaAllocator = avec::ArenaAllocator<T>;
+
 template<class T>
-using Aligned = avec::Aligned<T>;
+using PoolAllocator = avec::PoolAllocator<T>;
+
+template<class T,
+         avec::HugePagePolicy Policy = avec::HugePagePolicy::transparent>
+using HugePageAllocator = avec::HugePageAllocator<T, Policy>;
+
+template<class T>
+using arena_vector = avec::arena_vector<T>;
+
+template<class T>
+using pool_vector = avec::pool_vector<T>;
+
+template<class Float, std::size_t Alignment = avec::ALIGNMENT>
+using Buffer = avec::Buffer<Float, Alignment>;
 
 template<class Float>
-using Buffer = avec::Buffer<Float>;
+using BufferView = avec::BufferView<Float>;
+
+template<class Vec, std::size_t Alignment = avec::ALIGNMENT>
+using VecBuffer = avec::VecBuffer<Vec, Alignment>;
+
+template<class Vec>
+using ArenaVecBuffer = avec::ArenaVecBuffer<Vec>;
+
+template<class Vec>
+using PoolVecBuffer = avec::PoolVecBuffer<Vec>;
+
+template<class Vec>
+using VecSpan = avec::VecSpan<Vec>;
+
+template<class Function, class... Operands>
+using VecExpression = avec::VecExpression<Function, Operands...>;
+
+using VecAccess = avec::VecAccess;
+
+template<class Vec, VecAccess Access = VecAccess::aligned>
+using VecView = avec::VecView<Vec, Access>;
 
 template<class Vec>
-using VecBuffer = avec::VecBuffer<Vec>;
+using UnalignedVecView = avec::UnalignedVecView<Vec>;
 
 template<class Vec>
-using VecView = avec::VecView<Vec>;
+using PartialVecView = avec::PartialVecView<Vec>;
+
+template<typename Float, std::size_t Alignment = avec::ALIGNMENT>
+using InterleavedBuffer = avec::InterleavedBuffer<Float, Alignment>;
 
 template<typename Float>
-using InterleavedBuffer = avec::InterleavedBuffer<Float>;
+using InterleavedView = avec::InterleavedView<Float>;
+
+template<typename Float>
+using MappedBuffer = avec::MappedBuffer<Float>;
+
+template<typename Float>
+using MappedInterleavedBuffer = avec::MappedInterleavedBuffer<Float>;
+
+template<typename Float>
+using PcmReader = avec::PcmReader<Float>;
+
+template<typename Float>
+using Recorder = avec::Recorder<Float>;
+
+template<typename Float>
+using FirstTouchInterleavedBuffer = avec::FirstTouchInterleavedBuffer<Float>;
+
+using Half = avec::Half;
+
+using BFloat16 = avec::BFloat16;
+
+template<class Vec, class Format, std::size_t Alignment = avec::ALIGNMENT>
+using PackedVecBuffer = avec::PackedVecBuffer<Vec, Format, Alignment>;
+
+template<class Vec, class Format>
+using PackedVecView = avec::PackedVecView<Vec, Format>;
+
+template<class Vec, std::size_t Alignment = avec::ALIGNMENT>
+using HalfVecBuffer = avec::HalfVecBuffer<Vec, Alignment>;
+
+template<class Vec>
+using HalfVecView = avec::HalfVecView<Vec>;
+
+template<class Vec, std::size_t Alignment = avec::ALIGNMENT>
+using BFloat16VecBuffer = avec::BFloat16VecBuffer<Vec, Alignment>;
+
+template<class Vec>
+using BFloat16VecView = avec::BFloat16VecView<Vec>;
 
 template<typename Float>
 using SimdTypes = avec::SimdTypes<Float>;
 
+template<typename Float, uint32_t N>
+using Vec = avec::Vec<Float, N>;
+
+template<typename Float, uint32_t N>
+using VecTypes = avec::VecTypes<Float, N>;
+
+template<typename Float>
+using NativeVec = avec::NativeVec<Float>;
+
 template<typename Vec>
 using ScalarTypes = avec::ScalarTypes<Vec>;
 
@@ -11,6 +11,7 @@ Distributed under the Boost Software License, Version 1.0.
 #pragma once
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
 #include <memory>
 #include <new>
 #include <type_traits>
@@ -17,6 +17,7 @@ limitations under the License.
 #pragma once
 
 #include "avec/Alignment.hpp"
+#include "avec/Traits.hpp"
 
 namespace avec {
 
@@ -27,11 +28,30 @@ namespace avec {
  * Multi channel buffer, holding an aligned_vector<Float> for each
  * channel
  * @tparam Float the sample type, float or double.
+ * @tparam Alignment the alignment of the memory of each channel, in bytes.
+ * @tparam Allocator the allocator used for the memory of each channel. It must
+ * be default constructible and provide memory aligned to Alignment, see
+ * HugePageAllocator.
  */
-template<class Float>
+template<class Float,
+         std::size_t Alignment = ALIGNMENT,
+         class Allocator =
+           boost::alignment::aligned_allocator<Float, Alignment>>
 class Buffer final
 {
-  std::vector<aligned_vector<Float>> data;
+public:
+  /**
+   * The alignment of the memory of each channel, in bytes.
+   */
+  static constexpr std::size_t alignment = Alignment;
+
+  /**
+   * The type of each channel of the buffer.
+   */
+  using Channel = std::vector<Float, Allocator>;
+
+private:
+  std::vector<Channel> data;
   std::vector<Float*> pointers;
   uint32_t size = 0;
   uint32_t capacity = 0;
@@ -50,13 +70,13 @@ public:
    * @param i the index of the element to retrieve
    * @return a reference to the i-th element of buffer.
    */
-  aligned_vector<Float>& operator[](uint32_t i) { return data[i]; }
+  Channel& operator[](uint32_t i) { return data[i]; }
   /**
    * Gets a const reference to an element of the buffer.
    * @param i the index of the element to retrieve
    * @return a const reference to the i-th element of buffer.
    */
-  aligned_vector<Float> const& operator[](uint32_t i) const { return data[i]; }
+  Channel const& operator[](uint32_t i) const { return data[i]; }
 
   /**
    * @return a Float** to the buffer.
@@ -75,7 +95,12 @@ public:
   void fill(Float value)
   {
     for (auto& channel : data) {
-      std::fill(channel.begin(), channel.end(), value);
+      if (channel.empty()) {
+        continue;
+      }
+      Float* ptr = channel.data();
+      BOOST_ALIGN_ASSUME_ALIGNED(ptr, Alignment);
+      std::fill(ptr, ptr + channel.size(), value);
     }
   }
 
@@ -193,40 +218,393 @@ public:
   }
 };
 
+/**
+ * A non-owning view over a multi channel buffer, with a sample offset, a number
+ * of samples, and a subset of channels. It can view a Buffer or any Float**.
+ * A BufferView<Float const> is a read-only view, which is what a const Buffer
+ * can be viewed as. A BufferView<Float> converts to a BufferView<Float const>.
+ * @tparam Float the sample type, float or double, optionally const.
+ */
+template<class Float>
+class BufferView final
+{
+  template<class>
+  friend class BufferView;
+
+  using MutableFloat = typename std::remove_const<Float>::type;
+
+  Float* const* data = nullptr;
+  uint32_t const* channelIndices = nullptr;
+  uint32_t numChannels = 0;
+  uint32_t offset = 0;
+  uint32_t numSamples = 0;
+
+public:
+  /**
+   * Constructor.
+   * @param data the channels to view.
+   * @param numChannels the number of channels to view.
+   * @param numSamples the number of samples to view.
+   * @param offset the sample of each channel at which the view begins.
+   */
+  BufferView(Float* const* data,
+             uint32_t numChannels,
+             uint32_t numSamples,
+             uint32_t offset = 0)
+    : data(data)
+    , numChannels(numChannels)
+    , offset(offset)
+    , numSamples(numSamples)
+  {}
+
+  /**
+   * Constructor. Views all the channels and samples of a Buffer.
+   * @param buffer the Buffer to view.
+   */
+  template<std::size_t Alignment, class Allocator>
+  BufferView(Buffer<MutableFloat, Alignment, Allocator>& buffer)
+    : BufferView(buffer.get(),
+                 buffer.getNumChannels(),
+                 buffer.getNumSamples())
+  {}
+
+  /**
+   * Constructor. Views all the channels and samples of a const Buffer, only
+   * available for read-only views.
+   * @param buffer the Buffer to view.
+   */
+  template<std::size_t Alignment,
+           class Allocator,
+           class F = Float,
+           typename std::enable_if<std::is_const<F>::value, int>::type = 0>
+  BufferView(Buffer<MutableFloat, Alignment, Allocator> const& buffer)
+    : BufferView(buffer.get(),
+                 buffer.getNumChannels(),
+                 buffer.getNumSamples())
+  {}
+
+  /**
+   * Constructor. Makes a read-only view from a mutable one.
+   * @param other the view to convert.
+   */
+  template<class F = Float,
+           typename std::enable_if<std::is_const<F>::value, int>::type = 0>
+  BufferView(BufferView<MutableFloat> const& other)
+    : data(other.data)
+    , channelIndices(other.channelIndices)
+    , numChannels(other.numChannels)
+    , offset(other.offset)
+    , numSamples(other.numSamples)
+  {}
+
+  BufferView() = default;
+
+  /**
+   * @param channel the channel of the view.
+   * @return a pointer to the first sample of the view on the channel.
+   */
+  Float* operator[](uint32_t channel) const
+  {
+    assert(channel < numChannels);
+    return data[channelIndices ? channelIndices[channel] : channel] + offset;
+  }
+
+  /**
+   * @return the number of channels of the view.
+   */
+  uint32_t getNumChannels() const { return numChannels; }
+
+  /**
+   * @return the number of samples of the view.
+   */
+  uint32_t getNumSamples() const { return numSamples; }
+
+  /**
+   * @return the sample at which the view begins on each of the viewed
+   * channels.
+   */
+  uint32_t getOffset() const { return offset; }
+
+  /**
+   * Gets a view over a range of the samples of this view.
+   * @param first the first sample of the range, relative to this view.
+   * @param num the number of samples of the range.
+   * @return the view over the range of samples.
+   */
+  BufferView getSamples(uint32_t first, uint32_t num) const
+  {
+    assert(first + num <= numSamples);
+    auto view = *this;
+    view.offset += first;
+    view.numSamples = num;
+    return view;
+  }
+
+  /**
+   * Gets a view over a range of the channels of this view.
+   * @param first the first channel of the range, relative to this view.
+   * @param num the number of channels of the range.
+   * @return the view over the range of channels.
+   */
+  BufferView getChannels(uint32_t first, uint32_t num) const
+  {
+    assert(first + num <= numChannels);
+    auto view = *this;
+    if (channelIndices) {
+      view.channelIndices += first;
+    }
+    else {
+      view.data += first;
+    }
+    view.numChannels = num;
+    return view;
+  }
+
+  /**
+   * Gets a view over an arbitrary subset of the channels of this view. This
+   * view must not be a subset itself.
+   * @param indices the channels of this view to be viewed. The array is not
+   * copied and must outlive the returned view.
+   * @param num the number of channels of the subset.
+   * @return the view over the subset of channels.
+   */
+  BufferView getChannels(uint32_t const* indices, uint32_t num) const
+  {
+    assert(!channelIndices);
+    auto view = *this;
+    view.channelIndices = indices;
+    view.numChannels = num;
+    return view;
+  }
+};
+
+/**
+ * Settings for copyBuffer.
+ */
+struct CopySettings final
+{
+  /**
+   * Gain applied to the samples while copying them.
+   */
+  double gain = 1.0;
+  /**
+   * If true, the samples are clamped to [-clampLevel, clampLevel] after the
+   * gain is applied.
+   */
+  bool clamp = false;
+  /**
+   * The level to clamp the samples to, if clamp is true.
+   */
+  double clampLevel = 1.0;
+};
+
+namespace detail {
+
+/**
+ * Converts, scales and clamps the samples of a channel, computing in double
+ * precision if either side is double. Conversions between float and double are
+ * vectorized with to_float and to_double, over 8 lanes on x86 and 4 lanes on
+ * AArch64. On 32 bit ARM and with the generic backend, the samples are
+ * converted one by one.
+ */
 template<typename InScalar, typename OutScalar>
 inline void
-copyBuffer(Buffer<InScalar> const& input,
-                 Buffer<OutScalar>& output,
-                 uint32_t numChannels)
+convertSamples(InScalar const* input,
+               OutScalar* output,
+               uint32_t numSamples,
+               CopySettings const& settings)
+{
+  bool const applyGain = settings.gain != 1.0;
+  if (std::is_same<InScalar, OutScalar>::value && !applyGain &&
+      !settings.clamp) {
+    std::copy(input, input + numSamples, output);
+    return;
+  }
+  using Compute = typename std::conditional<
+    std::is_same<InScalar, double>::value ||
+      std::is_same<OutScalar, double>::value,
+    double,
+    float>::type;
+  Compute const gain = static_cast<Compute>(settings.gain);
+  Compute const level = static_cast<Compute>(settings.clampLevel);
+  uint32_t i = 0;
+#if AVEC_X86 || AVEC_NEON_64
+#if AVEC_X86
+  using FloatVec = Vec8f;
+  using DoubleVec = Vec8d;
+#else
+  using FloatVec = Vec4f;
+  using DoubleVec = Vec4d;
+#endif
+  using InVec =
+    typename std::conditional<std::is_same<InScalar, float>::value,
+                              FloatVec,
+                              DoubleVec>::type;
+  using ComputeVec =
+    typename std::conditional<std::is_same<Compute, float>::value,
+                              FloatVec,
+                              DoubleVec>::type;
+  constexpr uint32_t vecSize = FloatVec::size();
+  auto const toCompute = [](InVec const& x) -> ComputeVec {
+    if constexpr (std::is_same<InVec, ComputeVec>::value) {
+      return x;
+    }
+    else {
+      return to_double(x);
+    }
+  };
+  auto const toOutput = [](ComputeVec const& x) {
+    if constexpr (std::is_same<OutScalar, Compute>::value) {
+      return x;
+    }
+    else {
+      return to_float(x);
+    }
+  };
+  ComputeVec const gainVec = gain;
+  ComputeVec const levelVec = level;
+  for (; i + vecSize <= numSamples; i += vecSize) {
+    ComputeVec x = toCompute(InVec().load(input + i));
+    if (applyGain) {
+      x *= gainVec;
+    }
+    if (settings.clamp) {
+      x = min(max(x, -levelVec), levelVec);
+    }
+    toOutput(x).store(output + i);
+  }
+#endif
+  for (; i < numSamples; ++i) {
+    Compute x = static_cast<Compute>(input[i]);
+    if (applyGain) {
+      x *= gain;
+    }
+    if (settings.clamp) {
+      x = std::min(std::max(x, -level), level);
+    }
+    output[i] = static_cast<OutScalar>(x);
+  }
+}
+
+} // namespace detail
+
+/**
+ * Copies the samples of a BufferView into another one, converting them to the
+ * output scalar type, and optionally applying a gain and clamping them. The
+ * channels are processed by an executor, for example over the threads of a
+ * pool for large offline buffers; copyBuffer itself never creates threads.
+ * @param input the view to copy from.
+ * @param output the view to copy to. It must have at least as many channels and
+ * samples as the input.
+ * @param settings the gain and clamping to apply.
+ * @param executor a callable invoked as executor(numChannels, task), which must
+ * call task(channel) once for each channel in [0, numChannels), on any thread,
+ * and return once all the calls have returned.
+ */
+template<typename InScalar, typename OutScalar, class Executor>
+inline void
+copyBuffer(BufferView<InScalar> const& input,
+           BufferView<OutScalar> const& output,
+           CopySettings const& settings,
+           Executor&& executor)
 {
-  if (numChannels < 0) {
-    numChannels = input.getNumChannels();
+  static_assert(!std::is_const<OutScalar>::value,
+                "The output of copyBuffer must not be a read-only view");
+  assert(input.getNumChannels() <= output.getNumChannels());
+  assert(input.getNumSamples() <= output.getNumSamples());
+  if (input.getNumSamples() == 0) {
+    return;
   }
+  executor(input.getNumChannels(), [&](uint32_t c) {
+    detail::convertSamples<typename std::remove_const<InScalar>::type>(
+      input[c], output[c], input.getNumSamples(), settings);
+  });
+}
+
+/**
+ * Copies the samples of a BufferView into another one, converting them to the
+ * output scalar type, and optionally applying a gain and clamping them, one
+ * channel after the other on the calling thread.
+ * @param input the view to copy from.
+ * @param output the view to copy to. It must have at least as many channels and
+ * samples as the input.
+ * @param settings the gain and clamping to apply.
+ */
+template<typename InScalar, typename OutScalar>
+inline void
+copyBuffer(BufferView<InScalar> const& input,
+           BufferView<OutScalar> const& output,
+           CopySettings const& settings = CopySettings{})
+{
+  copyBuffer(input, output, settings, [](uint32_t numChannels, auto&& task) {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      task(c);
+    }
+  });
+}
+
+/**
+ * Copies the first numChannels channels of a Buffer into another one,
+ * converting the samples to the output scalar type, and optionally applying a
+ * gain and clamping them. The output is resized to the number of samples of
+ * the input.
+ * @param input the buffer to copy from.
+ * @param output the buffer to copy to.
+ * @param numChannels the number of channels to copy.
+ * @param settings the gain and clamping to apply.
+ */
+template<typename InScalar,
+         typename OutScalar,
+         std::size_t InAlignment,
+         std::size_t OutAlignment,
+         class InAllocator,
+         class OutAllocator>
+inline void
+copyBuffer(Buffer<InScalar, InAlignment, InAllocator> const& input,
+           Buffer<OutScalar, OutAlignment, OutAllocator>& output,
+           uint32_t numChannels,
+           CopySettings const& settings = CopySettings{})
+{
   assert(input.getNumChannels() >= numChannels);
   assert(output.getNumChannels() >= numChannels);
   output.setNumSamples(input.getNumSamples());
-  for (uint32_t c = 0; c < numChannels; ++c) {
-    std::copy(
-      &input[c][0], &input[c][0] + input.getNumSamples(), &output[c][0]);
-  }
+  copyBuffer(
+    BufferView<InScalar const>(input.get(), numChannels, input.getNumSamples()),
+    BufferView<OutScalar>(output.get(), numChannels, output.getNumSamples()),
+    settings);
 }
 
-template<typename InScalar, typename OutScalar>
+/**
+ * Copies a Buffer into another one with the same number of channels,
+ * converting the samples to the output scalar type, and optionally applying a
+ * gain and clamping them. The output is resized to the number of samples of
+ * the input.
+ * @param input the buffer to copy from.
+ * @param output the buffer to copy to.
+ * @param settings the gain and clamping to apply.
+ */
+template<typename InScalar,
+         typename OutScalar,
+         std::size_t InAlignment,
+         std::size_t OutAlignment,
+         class InAllocator,
+         class OutAllocator>
 inline void
-copyBuffer(Buffer<InScalar> const& input, Buffer<OutScalar>& output)
+copyBuffer(Buffer<InScalar, InAlignment, InAllocator> const& input,
+           Buffer<OutScalar, OutAlignment, OutAllocator>& output,
+           CopySettings const& settings = CopySettings{})
 {
-  auto const numChannels = input.getNumChannels();
   assert(input.getNumChannels() == output.getNumChannels());
   assert(input.getNumSamples() <= output.getCapacity());
-  output.setNumSamples(input.getNumSamples());
-  if (input.getNumSamples() > 0) {
-    for (uint32_t c = 0; c < numChannels; ++c) {
-      std::copy(
-        &input[c][0], &input[c][0] + input.getNumSamples(), &output[c][0]);
-    }
-  }
+  copyBuffer(input, output, input.getNumChannels(), settings);
 }
 
+template<class Float, std::size_t Alignment, class Allocator>
+struct AlignmentOf<Buffer<Float, Alignment, Allocator>>
+{
+  static constexpr std::size_t value = Alignment;
+};
+
 static_assert(std::is_nothrow_move_constructible<Buffer<float>>::value,
               "Buffer should be noexcept move constructable");
 
@@ -0,0 +1,564 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "avec/InterleavedView.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define AVEC_MMAP 1
+#else
+#define AVEC_MMAP 0
+#endif
+
+/*
+ * A simple file format to store a Buffer or an InterleavedBuffer, designed to
+ * be memory mapped and used in place, without copies.
+ *
+ * The file begins with a BufferFileHeader of BUFFER_FILE_ALIGNMENT bytes,
+ * followed by the samples in the native byte order. Each channel of a Buffer,
+ * and each group of channels of an InterleavedBuffer, starts at a multiple of
+ * BUFFER_FILE_ALIGNMENT bytes, and the bytes in between are zero.
+ * The groups of an InterleavedBuffer are stored as in the InterleavedBuffer:
+ * first the groups of 2 channels, then the ones of 4 channels, then the ones of
+ * 8 channels, then the ones of 16 channels. Their number depends on the simd
+ * instruction sets the writer was compiled for, and is recorded in the header.
+ * A file written by a build with a different layout can still be mapped, and
+ * converted with regroup.
+ * The header is validated before the file is used: the groups must hold all
+ * the channels and no more groups than needed, and the sizes are computed with
+ * overflow checks, so that a corrupt file is rejected instead of read past its
+ * end.
+ */
+
+namespace avec {
+
+/**
+ * The alignment of the samples in a buffer file, in bytes.
+ */
+constexpr std::size_t BUFFER_FILE_ALIGNMENT = 64;
+
+namespace detail {
+
+/**
+ * Multiplies two unsigned integers, checking for overflow.
+ * @param a the first factor.
+ * @param b the second factor.
+ * @param product set to a * b, on success.
+ * @return false if the product does not fit in 64 bits.
+ */
+inline bool
+checkedMultiply(uint64_t a, uint64_t b, uint64_t& product)
+{
+  if (b != 0 && a > UINT64_MAX / b) {
+    return false;
+  }
+  product = a * b;
+  return true;
+}
+
+/**
+ * Adds two unsigned integers, checking for overflow.
+ * @param a the first term.
+ * @param b the second term.
+ * @param sum set to a + b, on success.
+ * @return false if the sum does not fit in 64 bits.
+ */
+inline bool
+checkedAdd(uint64_t a, uint64_t b, uint64_t& sum)
+{
+  if (a > UINT64_MAX - b) {
+    return false;
+  }
+  sum = a + b;
+  return true;
+}
+
+} // namespace detail
+
+/**
+ * The layout of the samples in a buffer file.
+ */
+enum class BufferFileLayout : uint32_t
+{
+  /**
+   * One channel after the other, as in a Buffer.
+   */
+  planar = 0,
+  /**
+   * Groups of interleaved channels, as in an InterleavedBuffer.
+   */
+  interleaved = 1
+};
+
+/**
+ * The header of a buffer file.
+ */
+struct BufferFileHeader final
+{
+  static constexpr uint32_t MAGIC = 0x43455641; // "AVEC" in little endian
+  static constexpr uint32_t VERSION = 1;
+  /**
+   * The largest number of channels accepted when a file is mapped. Files with
+   * no samples take no space for their channels, so their number is bounded
+   * here rather than by the size of the file.
+   */
+  static constexpr uint32_t MAX_NUM_CHANNELS = 1u << 16;
+
+  uint32_t magic = MAGIC;
+  uint32_t version = VERSION;
+  BufferFileLayout layout = BufferFileLayout::planar;
+  /**
+   * sizeof(float) or sizeof(double).
+   */
+  uint32_t scalarSize = 0;
+  uint32_t numChannels = 0;
+  uint32_t numSamples = 0;
+  /**
+   * The number of groups of 2, 4, 8 and 16 channels, if the layout is
+   * interleaved. Files written before the groups of 16 channels were
+   * introduced have num16 = 0, as it was reserved.
+   */
+  uint32_t num2 = 0;
+  uint32_t num4 = 0;
+  uint32_t num8 = 0;
+  uint32_t num16 = 0;
+  uint32_t reserved[6] = {};
+
+  /**
+   * @return the number of bytes used by the samples of a channel or of a group
+   * of channels, padding included.
+   */
+  std::size_t getPaddedSize(uint32_t numChannelsInGroup) const
+  {
+    auto const size = (std::size_t)numSamples * numChannelsInGroup * scalarSize;
+    return (size + BUFFER_FILE_ALIGNMENT - 1) & ~(BUFFER_FILE_ALIGNMENT - 1);
+  }
+
+  /**
+   * Computes the size of the file described by the header. The header may come
+   * from an untrusted file, so the arithmetic is checked for overflow.
+   * @param fileSize set to the size of the file in bytes, on success.
+   * @return false if the size does not fit in 64 bits.
+   */
+  bool getFileSize(uint64_t& fileSize) const
+  {
+    auto const addGroups = [&](uint32_t numGroups, uint32_t width) {
+      uint64_t size, paddedSize, groupsSize;
+      return detail::checkedMultiply(
+               numSamples, (uint64_t)width * scalarSize, size) &&
+             detail::checkedAdd(size, BUFFER_FILE_ALIGNMENT - 1, paddedSize) &&
+             detail::checkedMultiply(
+               numGroups,
+               paddedSize & ~(uint64_t)(BUFFER_FILE_ALIGNMENT - 1),
+               groupsSize) &&
+             detail::checkedAdd(fileSize, groupsSize, fileSize);
+    };
+    fileSize = sizeof(BufferFileHeader);
+    if (layout == BufferFileLayout::planar) {
+      return addGroups(numChannels, 1);
+    }
+    return addGroups(num2, 2) && addGroups(num4, 4) && addGroups(num8, 8) &&
+           addGroups(num16, 16);
+  }
+
+  /**
+   * Checks the number of channels and of groups of channels, which may come
+   * from an untrusted file. There can be at most MAX_NUM_CHANNELS channels. In
+   * the interleaved layout the groups must hold all the channels, and they
+   * would not without the narrowest one, as in any InterleavedBuffer.
+   * @return true if the numbers are consistent.
+   */
+  bool hasValidChannels() const
+  {
+    if (numChannels > MAX_NUM_CHANNELS) {
+      return false;
+    }
+    if (layout == BufferFileLayout::planar) {
+      return true;
+    }
+    uint64_t const numLanes = 2 * (uint64_t)num2 + 4 * (uint64_t)num4 +
+                              8 * (uint64_t)num8 + 16 * (uint64_t)num16;
+    uint64_t const narrowest = num2 ? 2 : num4 ? 4 : num8 ? 8 : num16 ? 16 : 0;
+    if (narrowest == 0) {
+      return numChannels == 0;
+    }
+    return numLanes >= numChannels &&
+           numLanes - narrowest < std::max(numChannels, 1u);
+  }
+};
+
+static_assert(sizeof(BufferFileHeader) == BUFFER_FILE_ALIGNMENT,
+              "BufferFileHeader should fill an aligned block");
+
+/**
+ * A file mapped in memory, with copy on write semantics: the memory can be
+ * modified, but the changes are not written back to the file. On platforms
+ * without mmap the file is read into aligned memory.
+ */
+class MappedFile final
+{
+  void* data = nullptr;
+  std::size_t size = 0;
+
+public:
+  MappedFile() = default;
+
+  MappedFile(MappedFile&& other) noexcept
+    : data(other.data)
+    , size(other.size)
+  {
+    other.data = nullptr;
+    other.size = 0;
+  }
+
+  MappedFile& operator=(MappedFile&& other) noexcept
+  {
+    std::swap(data, other.data);
+    std::swap(size, other.size);
+    return *this;
+  }
+
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  ~MappedFile() { close(); }
+
+  /**
+   * Maps a file, unmapping any file previously mapped.
+   * @param path the path of the file.
+   * @return true on success, false if the file could not be opened or mapped,
+   * or if it is empty.
+   */
+  bool open(char const* path)
+  {
+    close();
+#if AVEC_MMAP
+    int const file = ::open(path, O_RDONLY);
+    if (file < 0) {
+      return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size <= 0) {
+      ::close(file);
+      return false;
+    }
+    void* mapped = mmap(nullptr,
+                        (std::size_t)info.st_size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE,
+                        file,
+                        0);
+    ::close(file);
+    if (mapped == MAP_FAILED) {
+      return false;
+    }
+    data = mapped;
+    size = (std::size_t)info.st_size;
+    return true;
+#else
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+      return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long const fileSize = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (fileSize <= 0) {
+      std::fclose(file);
+      return false;
+    }
+    data = boost::alignment::aligned_alloc(BUFFER_FILE_ALIGNMENT, fileSize);
+    size = (std::size_t)fileSize;
+    bool const success =
+      data && std::fread(data, 1, size, file) == size;
+    std::fclose(file);
+    if (!success) {
+      close();
+    }
+    return success;
+#endif
+  }
+
+  /**
+   * Unmaps the file.
+   */
+  void close()
+  {
+    if (!data) {
+      return;
+    }
+#if AVEC_MMAP
+    munmap(data, size);
+#else
+    boost::alignment::aligned_free(data);
+#endif
+    data = nullptr;
+    size = 0;
+  }
+
+  /**
+   * @return a pointer to the mapped memory, nullptr if no file is mapped.
+   */
+  void* getData() const { return data; }
+
+  /**
+   * @return the size of the mapped file, in bytes.
+   */
+  std::size_t getSize() const { return size; }
+};
+
+namespace detail {
+
+inline bool
+writeBufferFileBlock(std::FILE* file, void const* data, std::size_t size)
+{
+  static char const zeros[BUFFER_FILE_ALIGNMENT] = {};
+  auto const padding = (BUFFER_FILE_ALIGNMENT - size % BUFFER_FILE_ALIGNMENT) %
+                       BUFFER_FILE_ALIGNMENT;
+  return (size == 0 || std::fwrite(data, 1, size, file) == size) &&
+         (padding == 0 || std::fwrite(zeros, 1, padding, file) == padding);
+}
+
+template<typename Float>
+inline MappedFile
+mapBufferFile(char const* path,
+              BufferFileLayout layout,
+              BufferFileHeader& header)
+{
+  MappedFile file;
+  if (!file.open(path) || file.getSize() < sizeof(BufferFileHeader)) {
+    return MappedFile{};
+  }
+  std::memcpy(&header, file.getData(), sizeof(BufferFileHeader));
+  uint64_t fileSize;
+  bool const isValid =
+    header.magic == BufferFileHeader::MAGIC &&
+    header.version == BufferFileHeader::VERSION && header.layout == layout &&
+    header.scalarSize == sizeof(Float) && header.hasValidChannels() &&
+    header.getFileSize(fileSize) && file.getSize() >= fileSize;
+  return isValid ? std::move(file) : MappedFile{};
+}
+
+} // namespace detail
+
+/**
+ * Writes the samples of a BufferView to a buffer file, in planar layout.
+ * @param path the path of the file to write.
+ * @param buffer the samples to write.
+ * @return true on success, false if the file could not be written.
+ */
+template<typename Float>
+inline bool
+saveBufferFile(char const* path, BufferView<Float> const& buffer)
+{
+  std::FILE* file = std::fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  BufferFileHeader header;
+  header.layout = BufferFileLayout::planar;
+  header.scalarSize = sizeof(Float);
+  header.numChannels = buffer.getNumChannels();
+  header.numSamples = buffer.getNumSamples();
+  bool success = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  for (uint32_t c = 0; success && c < buffer.getNumChannels(); ++c) {
+    success = detail::writeBufferFileBlock(
+      file, buffer[c], buffer.getNumSamples() * sizeof(Float));
+  }
+  return std::fclose(file) == 0 && success;
+}
+
+/**
+ * Writes the samples of an InterleavedBuffer to a buffer file, in interleaved
+ * layout.
+ * @param path the path of the file to write.
+ * @param buffer the samples to write.
+ * @return true on success, false if the file could not be written.
+ */
+template<typename Float, std::size_t Alignment, class Allocator>
+inline bool
+saveBufferFile(char const* path,
+               InterleavedBuffer<Float, Alignment, Allocator> const& buffer)
+{
+  std::FILE* file = std::fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  BufferFileHeader header;
+  header.layout = BufferFileLayout::interleaved;
+  header.scalarSize = sizeof(Float);
+  header.numChannels = buffer.getNumChannels();
+  header.numSamples = buffer.getNumSamples();
+  header.num2 = buffer.getNumBuffers2();
+  header.num4 = buffer.getNumBuffers4();
+  header.num8 = buffer.getNumBuffers8();
+  header.num16 = buffer.getNumBuffers16();
+  auto const numSamples = buffer.getNumSamples();
+  bool success = std::fwrite(&header, sizeof(header), 1, file) == 1;
+  for (uint32_t i = 0; success && i < header.num2; ++i) {
+    Float const* samples = buffer.getBuffer2(i);
+    success = detail::writeBufferFileBlock(
+      file, samples, numSamples * 2 * sizeof(Float));
+  }
+  for (uint32_t i = 0; success && i < header.num4; ++i) {
+    Float const* samples = buffer.getBuffer4(i);
+    success = detail::writeBufferFileBlock(
+      file, samples, numSamples * 4 * sizeof(Float));
+  }
+  for (uint32_t i = 0; success && i < header.num8; ++i) {
+    Float const* samples = buffer.getBuffer8(i);
+    success = detail::writeBufferFileBlock(
+      file, samples, numSamples * 8 * sizeof(Float));
+  }
+  for (uint32_t i = 0; success && i < header.num16; ++i) {
+    Float const* samples = buffer.getBuffer16(i);
+    success = detail::writeBufferFileBlock(
+      file, samples, numSamples * 16 * sizeof(Float));
+  }
+  return std::fclose(file) == 0 && success;
+}
+
+/**
+ * A buffer file in planar layout, mapped in memory and viewed as a BufferView.
+ * @tparam Float float or double
+ */
+template<typename Float>
+class MappedBuffer final
+{
+  MappedFile file;
+  std::vector<Float*> channels;
+  BufferView<Float> view;
+
+public:
+  /**
+   * Maps a buffer file.
+   * @param path the path of the file.
+   * @return true on success, false if the file could not be mapped, or if it
+   * is not a planar buffer file of Float.
+   */
+  bool open(char const* path)
+  {
+    close();
+    BufferFileHeader header;
+    file =
+      detail::mapBufferFile<Float>(path, BufferFileLayout::planar, header);
+    if (!file.getData()) {
+      return false;
+    }
+    auto* samples = static_cast<char*>(file.getData()) + sizeof(header);
+    channels.resize(header.numChannels);
+    for (auto& channel : channels) {
+      channel = reinterpret_cast<Float*>(samples);
+      samples += header.getPaddedSize(1);
+    }
+    view = BufferView<Float>(
+      channels.data(), header.numChannels, header.numSamples);
+    return true;
+  }
+
+  /**
+   * Unmaps the file.
+   */
+  void close()
+  {
+    view = BufferView<Float>();
+    channels.clear();
+    file.close();
+  }
+
+  /**
+   * @return a view over the samples of the file, valid until the file is
+   * closed. Modifying the samples does not modify the file.
+   */
+  BufferView<Float> const& getView() const { return view; }
+};
+
+/**
+ * A buffer file in interleaved layout, mapped in memory and viewed as an
+ * InterleavedView.
+ * @tparam Float float or double
+ */
+template<typename Float>
+class MappedInterleavedBuffer final
+{
+  MappedFile file;
+  InterleavedView<Float> view;
+
+public:
+  /**
+   * Maps a buffer file.
+   * @param path the path of the file.
+   * @return true on success, false if the file could not be mapped, or if it
+   * is not an interleaved buffer file of Float. Note that the layout of the
+   * file may not be the one of an InterleavedBuffer<Float> in this build, see
+   * InterleavedView::hasNativeLayout and regroup.
+   */
+  bool open(char const* path)
+  {
+    close();
+    BufferFileHeader header;
+    file =
+      detail::mapBufferFile<Float>(path, BufferFileLayout::interleaved, header);
+    if (!file.getData()) {
+      return false;
+    }
+    auto* samples = static_cast<char*>(file.getData()) + sizeof(header);
+    auto const getGroups = [&](uint32_t numGroups, uint32_t width) {
+      std::vector<Float*> groups(numGroups);
+      for (auto& group : groups) {
+        group = reinterpret_cast<Float*>(samples);
+        samples += header.getPaddedSize(width);
+      }
+      return groups;
+    };
+    auto buffers2 = getGroups(header.num2, 2);
+    auto buffers4 = getGroups(header.num4, 4);
+    auto buffers8 = getGroups(header.num8, 8);
+    auto buffers16 = getGroups(header.num16, 16);
+    view = InterleavedView<Float>(header.numChannels,
+                                  header.numSamples,
+                                  std::move(buffers2),
+                                  std::move(buffers4),
+                                  std::move(buffers8),
+                                  std::move(buffers16));
+    return true;
+  }
+
+  /**
+   * Unmaps the file.
+   */
+  void close()
+  {
+    view = InterleavedView<Float>();
+    file.close();
+  }
+
+  /**
+   * @return a view over the samples of the file, valid until the file is
+   * closed. Modifying the samples does not modify the file.
+   */
+  InterleavedView<Float> const& getView() const { return view; }
+};
+
+} // namespace avec
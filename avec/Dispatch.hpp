@@ -0,0 +1,162 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include <cstdint>
+
+// This header must not include the other headers of avec, see
+// dispatch/Kernels.cpp.
+
+namespace avec {
+
+/**
+ * The instruction sets that the kernels of Dispatch.hpp can be compiled for.
+ */
+enum class Isa
+{
+  /**
+   * The baseline of x86-64.
+   */
+  sse2,
+  /**
+   * AVX2, with FMA and F16C.
+   */
+  avx2,
+  /**
+   * AVX-512 F, VL, BW and DQ.
+   */
+  avx512,
+  /**
+   * The baseline of ARM.
+   */
+  neon
+};
+
+/**
+ * A table of kernels compiled for one instruction set. They work on plain
+ * arrays, whose layout does not depend on the instruction set, unlike the one
+ * of InterleavedBuffer. The arrays do not need to be aligned.
+ * @tparam Float float or double
+ */
+template<typename Float>
+struct Kernels final
+{
+  /**
+   * Interleaves the samples of separate channels to frames.
+   */
+  void (*interleave)(Float const* const* input,
+                     Float* output,
+                     uint32_t numChannels,
+                     uint32_t numSamples);
+
+  /**
+   * Deinterleaves frames to the samples of separate channels.
+   */
+  void (*deinterleave)(Float const* input,
+                       Float* const* output,
+                       uint32_t numChannels,
+                       uint32_t numSamples);
+
+  /**
+   * Copies an array applying a gain.
+   */
+  void (*copy)(Float const* input, Float* output, uint32_t size, Float gain);
+
+  /**
+   * Sets all the elements of an array to a value.
+   */
+  void (*fill)(Float* output, uint32_t size, Float value);
+
+  /**
+   * Computes the exponential of each element of an array.
+   */
+  void (*exp)(Float const* input, Float* output, uint32_t size);
+
+  /**
+   * Computes the natural logarithm of each element of an array.
+   */
+  void (*log)(Float const* input, Float* output, uint32_t size);
+
+  /**
+   * Computes the sine of each element of an array.
+   */
+  void (*sin)(Float const* input, Float* output, uint32_t size);
+
+  /**
+   * Computes the cosine of each element of an array.
+   */
+  void (*cos)(Float const* input, Float* output, uint32_t size);
+
+  /**
+   * Computes the hyperbolic tangent of each element of an array.
+   */
+  void (*tanh)(Float const* input, Float* output, uint32_t size);
+};
+
+/**
+ * @return the instruction set of the kernels returned by getKernels. It is
+ * the best one that the kernels were compiled for and that the processor
+ * supports, selected at the first call, unless set with setActiveIsa.
+ */
+Isa
+getActiveIsa();
+
+/**
+ * Sets the instruction set of the kernels returned by getKernels, for
+ * example to test or benchmark all of them.
+ * @param isa the instruction set
+ * @return true on success, false if the kernels were not compiled for isa or
+ * the processor does not support it.
+ */
+bool
+setActiveIsa(Isa isa);
+
+/**
+ * @param isa the instruction set
+ * @return true if the kernels were compiled for isa and the processor
+ * supports it.
+ */
+bool
+isIsaAvailable(Isa isa);
+
+/**
+ * @param isa the instruction set
+ * @return the name of isa, like "avx2".
+ */
+char const*
+getIsaName(Isa isa);
+
+/**
+ * @return the kernels compiled for the active instruction set.
+ * @tparam Float float or double
+ */
+template<typename Float>
+Kernels<Float> const&
+getKernels();
+
+namespace detail {
+
+/**
+ * @return the kernels compiled for an instruction set, defined in
+ * dispatch/Kernels.cpp.
+ */
+template<Isa isa, typename Float>
+Kernels<Float> const&
+getIsaKernels();
+
+} // namespace detail
+
+} // namespace avec
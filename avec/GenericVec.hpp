@@ -0,0 +1,653 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+ * This file implements the vectors of Agner Fog's Vectorclass with the vector
+ * extensions of GCC and Clang, __attribute__((vector_size)), for the targets
+ * that have neither SSE nor NEON, and on any target when AVEC_GENERIC_VEC is
+ * defined to 1, see Simd.hpp.
+ * The floating point vectors have the same surface as the ones in NeonVec.hpp,
+ * and the integer vectors the same as the ones in NeonVecInt.hpp. All the
+ * widths are implemented, the compiler lowers each vector to the registers of
+ * the target, and the math functions are evaluated lane by lane, which the
+ * compiler can vectorize when it has a vector math library.
+ * As with NEON, the mask types are the vector types themselves, with all the
+ * bits of a lane set when it is true.
+ * */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace avec {
+namespace detail {
+
+/**
+ * Static template class with an alias to the signed integer type with a given
+ * number of bytes, used to operate on the bits of the lanes.
+ */
+template<int bytes>
+struct GenericBits;
+
+template<>
+struct GenericBits<1>
+{
+  using type = int8_t;
+};
+
+template<>
+struct GenericBits<2>
+{
+  using type = int16_t;
+};
+
+template<>
+struct GenericBits<4>
+{
+  using type = int32_t;
+};
+
+template<>
+struct GenericBits<8>
+{
+  using type = int64_t;
+};
+
+/**
+ * Static template class with an alias to the vector extension type with a
+ * given number of bytes and elements of type Scalar. It is specialized for
+ * each type, as GCC ignores vector_size when it depends on template parameters
+ * of the enclosing class.
+ */
+template<typename Scalar, int bytes>
+struct GenericRegister;
+
+#define AVEC_GENERIC_REGISTER(Scalar, bytes)                                   \
+  template<>                                                                   \
+  struct GenericRegister<Scalar, bytes>                                        \
+  {                                                                            \
+    typedef Scalar type __attribute__((vector_size(bytes)));                   \
+  };
+
+#define AVEC_GENERIC_REGISTERS(Scalar)                                         \
+  AVEC_GENERIC_REGISTER(Scalar, 8)                                             \
+  AVEC_GENERIC_REGISTER(Scalar, 16)                                            \
+  AVEC_GENERIC_REGISTER(Scalar, 32)                                            \
+  AVEC_GENERIC_REGISTER(Scalar, 64)
+
+AVEC_GENERIC_REGISTERS(float)
+AVEC_GENERIC_REGISTERS(double)
+AVEC_GENERIC_REGISTERS(int8_t)
+AVEC_GENERIC_REGISTERS(uint8_t)
+AVEC_GENERIC_REGISTERS(int16_t)
+AVEC_GENERIC_REGISTERS(uint16_t)
+AVEC_GENERIC_REGISTERS(int32_t)
+AVEC_GENERIC_REGISTERS(uint32_t)
+AVEC_GENERIC_REGISTERS(int64_t)
+AVEC_GENERIC_REGISTERS(uint64_t)
+
+#undef AVEC_GENERIC_REGISTERS
+#undef AVEC_GENERIC_REGISTER
+
+/**
+ * A vector of Size elements, implemented with the vector extensions of GCC and
+ * Clang.
+ * @tparam Scalar the type of the elements, float, double or a fixed width
+ * integer.
+ * @tparam Size the number of elements.
+ */
+template<typename Scalar, int Size>
+class GenericVec
+{
+  using BitScalar = typename GenericBits<sizeof(Scalar)>::type;
+
+  // as in vectorclass, integer vectors can be loaded from and stored to any
+  // memory, floating point vectors only from and to arrays of their elements
+  using Memory = typename std::
+    conditional<std::is_integral<Scalar>::value, void, Scalar>::type;
+
+public:
+  using Register =
+    typename GenericRegister<Scalar, Size * sizeof(Scalar)>::type;
+
+  using Bits = typename GenericRegister<BitScalar, Size * sizeof(Scalar)>::type;
+
+protected:
+  Register vec;
+
+  static Bits toBits(Register const x) { return (Bits)x; }
+
+  static Register fromBits(Bits const x) { return (Register)x; }
+
+  template<class Function>
+  static GenericVec map(GenericVec const a, Function function)
+  {
+    GenericVec result;
+    for (int i = 0; i < Size; ++i) {
+      result.vec[i] = function(a.vec[i]);
+    }
+    return result;
+  }
+
+public:
+  // Default constructor:
+  GenericVec() {}
+
+  // Constructor to broadcast the same value into all elements:
+  GenericVec(Scalar x)
+  {
+    for (int i = 0; i < Size; ++i) {
+      vec[i] = x;
+    }
+  }
+
+  // Constructor to build from all elements:
+  template<typename... Scalars,
+           typename = typename std::enable_if<(sizeof...(Scalars) == Size &&
+                                               Size > 1)>::type>
+  GenericVec(Scalars... x)
+    : vec{ static_cast<Scalar>(x)... }
+  {}
+
+  // Constructor to build from two vectors of half the size:
+  GenericVec(GenericVec<Scalar, Size / 2> const low,
+             GenericVec<Scalar, Size / 2> const high)
+  {
+    low.store(reinterpret_cast<Scalar*>(&vec));
+    high.store(reinterpret_cast<Scalar*>(&vec) + Size / 2);
+  }
+
+  // Constructor to convert from the vector extension type:
+  GenericVec(Register const x) { vec = x; }
+
+  // Assignment operator to convert from the vector extension type:
+  GenericVec& operator=(Register const x)
+  {
+    vec = x;
+    return *this;
+  }
+
+  // Type cast operator to convert to the vector extension type
+  operator Register() const { return vec; }
+
+  // Member function to load from array (unaligned)
+  GenericVec& load(Memory const* p)
+  {
+    std::memcpy(&vec, p, sizeof(vec));
+    return *this;
+  }
+
+  // Member function to load from array, aligned by sizeof(Register)
+  GenericVec& load_a(Memory const* p)
+  {
+    std::memcpy(&vec, __builtin_assume_aligned(p, sizeof(vec)), sizeof(vec));
+    return *this;
+  }
+
+  // Member function to store into array (unaligned)
+  void store(Memory* p) const { std::memcpy(p, &vec, sizeof(vec)); }
+
+  // Member function to store into array, aligned by sizeof(Register)
+  void store_a(Memory* p) const
+  {
+    std::memcpy(__builtin_assume_aligned(p, sizeof(vec)), &vec, sizeof(vec));
+  }
+
+  // Member function extract a single element from vector
+  Scalar extract(int index) const { return vec[index & (Size - 1)]; }
+
+  // Extract a single element. Use store function if extracting more than one
+  // element. Operator [] can only read an element, not write.
+  Scalar operator[](int index) const { return extract(index); }
+
+  // Member functions to get the low and the high half of the vector
+  GenericVec<Scalar, Size / 2> get_low() const
+  {
+    GenericVec<Scalar, Size / 2> x;
+    x.load(reinterpret_cast<Scalar const*>(&vec));
+    return x;
+  }
+
+  GenericVec<Scalar, Size / 2> get_high() const
+  {
+    GenericVec<Scalar, Size / 2> x;
+    x.load(reinterpret_cast<Scalar const*>(&vec) + Size / 2);
+    return x;
+  }
+
+  static constexpr int size() { return Size; }
+
+  typedef Register registertype;
+
+  // operators and functions, defined here so that they are found by argument
+  // dependent lookup, and that scalars are converted to Scalar, as in
+  // vectorclass
+
+  friend GenericVec operator+(GenericVec const a, GenericVec const b)
+  {
+    return a.vec + b.vec;
+  }
+
+  friend GenericVec operator-(GenericVec const a, GenericVec const b)
+  {
+    return a.vec - b.vec;
+  }
+
+  friend GenericVec operator*(GenericVec const a, GenericVec const b)
+  {
+    return a.vec * b.vec;
+  }
+
+  friend GenericVec operator/(GenericVec const a, GenericVec const b)
+  {
+    return a.vec / b.vec;
+  }
+
+  friend GenericVec operator-(GenericVec const a) { return -a.vec; }
+
+  friend GenericVec operator+(GenericVec const a) { return a; }
+
+  friend GenericVec& operator+=(GenericVec& a, GenericVec const b)
+  {
+    a = a + b;
+    return a;
+  }
+
+  friend GenericVec& operator-=(GenericVec& a, GenericVec const b)
+  {
+    a = a - b;
+    return a;
+  }
+
+  friend GenericVec& operator*=(GenericVec& a, GenericVec const b)
+  {
+    a = a * b;
+    return a;
+  }
+
+  friend GenericVec& operator/=(GenericVec& a, GenericVec const b)
+  {
+    a = a / b;
+    return a;
+  }
+
+  // postfix and prefix increment and decrement, as in NeonVec.hpp
+
+  friend GenericVec operator++(GenericVec& a, int)
+  {
+    GenericVec a0 = a;
+    a = a + Scalar(1);
+    return a0;
+  }
+
+  friend GenericVec& operator++(GenericVec& a)
+  {
+    a = a + Scalar(1);
+    return a;
+  }
+
+  friend GenericVec operator--(GenericVec& a, int)
+  {
+    GenericVec a0 = a;
+    a = a - Scalar(1);
+    return a0;
+  }
+
+  friend GenericVec& operator--(GenericVec& a)
+  {
+    a = a - Scalar(1);
+    return a;
+  }
+
+  // comparisons, returning a mask with all the bits set in the true lanes
+
+  friend GenericVec operator==(GenericVec const a, GenericVec const b)
+  {
+    return fromBits((Bits)(a.vec == b.vec));
+  }
+
+  friend GenericVec operator!=(GenericVec const a, GenericVec const b)
+  {
+    return fromBits((Bits)(a.vec != b.vec));
+  }
+
+  friend GenericVec operator<(GenericVec const a, GenericVec const b)
+  {
+    return fromBits((Bits)(a.vec < b.vec));
+  }
+
+  friend GenericVec operator<=(GenericVec const a, GenericVec const b)
+  {
+    return fromBits((Bits)(a.vec <= b.vec));
+  }
+
+  friend GenericVec operator>(GenericVec const a, GenericVec const b)
+  {
+    return fromBits((Bits)(a.vec > b.vec));
+  }
+
+  friend GenericVec operator>=(GenericVec const a, GenericVec const b)
+  {
+    return fromBits((Bits)(a.vec >= b.vec));
+  }
+
+  // bitwise operators, also used as logical operators on masks
+
+  friend GenericVec operator&(GenericVec const a, GenericVec const b)
+  {
+    return fromBits(toBits(a.vec) & toBits(b.vec));
+  }
+
+  friend GenericVec operator|(GenericVec const a, GenericVec const b)
+  {
+    return fromBits(toBits(a.vec) | toBits(b.vec));
+  }
+
+  friend GenericVec operator^(GenericVec const a, GenericVec const b)
+  {
+    return fromBits(toBits(a.vec) ^ toBits(b.vec));
+  }
+
+  friend GenericVec operator~(GenericVec const a)
+  {
+    return fromBits(~toBits(a.vec));
+  }
+
+  friend GenericVec operator&&(GenericVec const a, GenericVec const b)
+  {
+    return a & b;
+  }
+
+  friend GenericVec operator||(GenericVec const a, GenericVec const b)
+  {
+    return a | b;
+  }
+
+  // true in the lanes that are zero, so it is also the negation of a mask
+  friend GenericVec operator!(GenericVec const a) { return a == GenericVec(0); }
+
+  friend GenericVec& operator&=(GenericVec& a, GenericVec const b)
+  {
+    a = a & b;
+    return a;
+  }
+
+  friend GenericVec& operator|=(GenericVec& a, GenericVec const b)
+  {
+    a = a | b;
+    return a;
+  }
+
+  friend GenericVec& operator^=(GenericVec& a, GenericVec const b)
+  {
+    a = a ^ b;
+    return a;
+  }
+
+  // shifts, for integer vectors
+
+  friend GenericVec operator<<(GenericVec const a, int b)
+  {
+    return a.vec << b;
+  }
+
+  friend GenericVec operator>>(GenericVec const a, int b)
+  {
+    return a.vec >> b;
+  }
+
+  friend GenericVec& operator<<=(GenericVec& a, int b)
+  {
+    a = a << b;
+    return a;
+  }
+
+  friend GenericVec& operator>>=(GenericVec& a, int b)
+  {
+    a = a >> b;
+    return a;
+  }
+
+  // select between two vectors, using the bits of a mask
+  friend GenericVec select(GenericVec const s,
+                           GenericVec const a,
+                           GenericVec const b)
+  {
+    Bits const mask = toBits(s.vec);
+    return fromBits((mask & toBits(a.vec)) | (~mask & toBits(b.vec)));
+  }
+
+  // conditional operations, applied where the mask f is true
+  friend GenericVec if_add(GenericVec const f,
+                           GenericVec const a,
+                           GenericVec const b)
+  {
+    return a + (f & b);
+  }
+
+  friend GenericVec if_sub(GenericVec const f,
+                           GenericVec const a,
+                           GenericVec const b)
+  {
+    return a - (f & b);
+  }
+
+  friend GenericVec if_mul(GenericVec const f,
+                           GenericVec const a,
+                           GenericVec const b)
+  {
+    return select(f, a * b, a);
+  }
+
+  friend GenericVec if_div(GenericVec const f,
+                           GenericVec const a,
+                           GenericVec const b)
+  {
+    return select(f, a / b, a);
+  }
+
+  // changes the sign of a where b has the sign bit set
+  friend GenericVec sign_combine(GenericVec const a, GenericVec const b)
+  {
+    Bits const signBit = toBits(GenericVec(Scalar(-0.0)).vec);
+    return fromBits(toBits(a.vec) ^ (toBits(b.vec) & signBit));
+  }
+
+  friend GenericVec max(GenericVec const a, GenericVec const b)
+  {
+    return select(a > b, a, b);
+  }
+
+  friend GenericVec min(GenericVec const a, GenericVec const b)
+  {
+    return select(a < b, a, b);
+  }
+
+  friend GenericVec abs(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return static_cast<Scalar>(std::abs(x)); });
+  }
+
+  friend GenericVec sqrt(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::sqrt(x); });
+  }
+
+  friend GenericVec square(GenericVec const a) { return a * a; }
+
+  // round to the nearest integer, with ties to even, as in vectorclass
+  friend GenericVec round(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::nearbyint(x); });
+  }
+
+  friend GenericVec truncate(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::trunc(x); });
+  }
+
+  friend GenericVec floor(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::floor(x); });
+  }
+
+  friend GenericVec ceil(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::ceil(x); });
+  }
+
+  friend GenericVec approx_recipr(GenericVec const a)
+  {
+    return GenericVec(Scalar(1)) / a;
+  }
+
+  friend GenericVec approx_rsqrt(GenericVec const a)
+  {
+    return GenericVec(Scalar(1)) / sqrt(a);
+  }
+
+  // multiply and add, fused only if the compiler contracts floating point
+  // expressions, as vectorclass without FMA
+  friend GenericVec mul_add(GenericVec const a,
+                            GenericVec const b,
+                            GenericVec const c)
+  {
+    return a.vec * b.vec + c.vec;
+  }
+
+  friend GenericVec mul_sub(GenericVec const a,
+                            GenericVec const b,
+                            GenericVec const c)
+  {
+    return a.vec * b.vec - c.vec;
+  }
+
+  friend GenericVec nmul_add(GenericVec const a,
+                             GenericVec const b,
+                             GenericVec const c)
+  {
+    return c.vec - a.vec * b.vec;
+  }
+
+  friend Scalar horizontal_add(GenericVec const a)
+  {
+    Scalar sum = a.vec[0];
+    for (int i = 1; i < Size; ++i) {
+      sum += a.vec[i];
+    }
+    return sum;
+  }
+
+  // math functions, see NeonMath.hpp for their NEON counterparts
+
+  friend GenericVec exp(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::exp(x); });
+  }
+
+  friend GenericVec log(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::log(x); });
+  }
+
+  friend GenericVec sin(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::sin(x); });
+  }
+
+  friend GenericVec cos(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::cos(x); });
+  }
+
+  friend GenericVec tan(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::tan(x); });
+  }
+
+  friend GenericVec tanh(GenericVec const a)
+  {
+    return map(a, [](Scalar x) { return std::tanh(x); });
+  }
+
+  friend std::pair<GenericVec, GenericVec> sincos(GenericVec const a)
+  {
+    return { sin(a), cos(a) };
+  }
+};
+
+} // namespace detail
+} // namespace avec
+
+using Vec4f = avec::detail::GenericVec<float, 4>;
+using Vec8f = avec::detail::GenericVec<float, 8>;
+using Vec16f = avec::detail::GenericVec<float, 16>;
+using Vec2d = avec::detail::GenericVec<double, 2>;
+using Vec4d = avec::detail::GenericVec<double, 4>;
+using Vec8d = avec::detail::GenericVec<double, 8>;
+
+using Vec4fb = Vec4f;
+using Vec8fb = Vec8f;
+using Vec16fb = Vec16f;
+using Vec2db = Vec2d;
+using Vec4db = Vec4d;
+using Vec8db = Vec8d;
+
+using Vec16c = avec::detail::GenericVec<int8_t, 16>;
+using Vec16uc = avec::detail::GenericVec<uint8_t, 16>;
+using Vec8s = avec::detail::GenericVec<int16_t, 8>;
+using Vec8us = avec::detail::GenericVec<uint16_t, 8>;
+using Vec4i = avec::detail::GenericVec<int32_t, 4>;
+using Vec4ui = avec::detail::GenericVec<uint32_t, 4>;
+using Vec2q = avec::detail::GenericVec<int64_t, 2>;
+using Vec2uq = avec::detail::GenericVec<uint64_t, 2>;
+
+using Vec32c = avec::detail::GenericVec<int8_t, 32>;
+using Vec32uc = avec::detail::GenericVec<uint8_t, 32>;
+using Vec16s = avec::detail::GenericVec<int16_t, 16>;
+using Vec16us = avec::detail::GenericVec<uint16_t, 16>;
+using Vec8i = avec::detail::GenericVec<int32_t, 8>;
+using Vec8ui = avec::detail::GenericVec<uint32_t, 8>;
+using Vec4q = avec::detail::GenericVec<int64_t, 4>;
+using Vec4uq = avec::detail::GenericVec<uint64_t, 4>;
+
+using Vec64c = avec::detail::GenericVec<int8_t, 64>;
+using Vec64uc = avec::detail::GenericVec<uint8_t, 64>;
+using Vec32s = avec::detail::GenericVec<int16_t, 32>;
+using Vec32us = avec::detail::GenericVec<uint16_t, 32>;
+using Vec16i = avec::detail::GenericVec<int32_t, 16>;
+using Vec16ui = avec::detail::GenericVec<uint32_t, 16>;
+using Vec8q = avec::detail::GenericVec<int64_t, 8>;
+using Vec8uq = avec::detail::GenericVec<uint64_t, 8>;
+
+using Vec16cb = Vec16c;
+using Vec8sb = Vec8s;
+using Vec4ib = Vec4i;
+using Vec2qb = Vec2q;
+
+using Vec32cb = Vec32c;
+using Vec16sb = Vec16s;
+using Vec8ib = Vec8i;
+using Vec4qb = Vec4q;
+
+using Vec64cb = Vec64c;
+using Vec32sb = Vec32s;
+using Vec16ib = Vec16i;
+using Vec8qb = Vec8q;
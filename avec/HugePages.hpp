@@ -0,0 +1,364 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "avec/Alignment.hpp"
+
+#if defined(__linux__)
+#include <cstdio>
+#include <sys/mman.h>
+#include <unistd.h>
+#define AVEC_HUGE_PAGES 1
+#else
+#define AVEC_HUGE_PAGES 0
+#endif
+
+namespace avec {
+
+/**
+ * How to back memory allocated with allocateHugePages.
+ */
+enum class HugePagePolicy
+{
+  /**
+   * Regular pages.
+   */
+  regular,
+  /**
+   * Transparent huge pages, requested with madvise(MADV_HUGEPAGE).
+   */
+  transparent,
+  /**
+   * Explicit huge pages, requested with mmap(MAP_HUGETLB), falling back to
+   * transparent huge pages if none is available.
+   */
+  hugeTlb
+};
+
+/**
+ * The kind of pages backing a piece of memory.
+ */
+enum class PageBacking
+{
+  /**
+   * Regular pages.
+   */
+  regular,
+  /**
+   * Transparent huge pages. When reported by allocateHugePages, it means that
+   * the kernel accepted the request, which it fulfills on a best effort basis,
+   * see queryPageBacking.
+   */
+  transparent,
+  /**
+   * Explicit huge pages, from the hugetlbfs pool.
+   */
+  hugeTlb
+};
+
+namespace detail {
+
+inline std::size_t
+readHugePageSize()
+{
+  std::size_t size = 2 * 1024 * 1024;
+#if AVEC_HUGE_PAGES
+  std::FILE* meminfo = std::fopen("/proc/meminfo", "r");
+  if (!meminfo) {
+    return size;
+  }
+  char line[256];
+  while (std::fgets(line, sizeof(line), meminfo)) {
+    unsigned long long value = 0;
+    if (std::sscanf(line, "Hugepagesize: %llu kB", &value) == 1) {
+      // a power of two, at least as large as a regular page
+      if (value > 0 && (value & (value - 1)) == 0 &&
+          value * 1024 >= (unsigned long long)sysconf(_SC_PAGESIZE)) {
+        size = (std::size_t)value * 1024;
+      }
+      break;
+    }
+  }
+  std::fclose(meminfo);
+#endif
+  return size;
+}
+
+} // namespace detail
+
+/**
+ * Gets the size of a huge page: the default huge page size of the kernel, read
+ * from /proc/meminfo on Linux the first time this function is called. It is 2
+ * MiB on most x86 systems, but it can be 1 GiB, or 512 MiB on arm64 kernels
+ * with 64 KiB pages. Where it is not available, it is 2 MiB.
+ * @return the size of a huge page, in bytes.
+ */
+inline std::size_t
+getHugePageSize()
+{
+  static std::size_t const size = detail::readHugePageSize();
+  return size;
+}
+
+namespace detail {
+
+inline std::size_t
+roundUpToHugePageSize(std::size_t size)
+{
+  auto const hugePageSize = getHugePageSize();
+  return (size + hugePageSize - 1) & ~(hugePageSize - 1);
+}
+
+} // namespace detail
+
+/**
+ * Allocates memory backed by huge pages, if possible. On Linux the memory is
+ * mapped with mmap and aligned to getHugePageSize(), on other platforms it is
+ * just allocated with boost::alignment::aligned_alloc.
+ * @param size the size of the memory to allocate, in bytes.
+ * @param policy how to back the memory.
+ * @param backing if not null, it is set to the backing actually obtained.
+ * @return a pointer to the allocated memory, or nullptr on failure. It must be
+ * released with freeHugePages.
+ */
+inline void*
+allocateHugePages(std::size_t size,
+                  HugePagePolicy policy,
+                  PageBacking* backing = nullptr)
+{
+  if (backing) {
+    *backing = PageBacking::regular;
+  }
+  if (size == 0) {
+    return nullptr;
+  }
+#if AVEC_HUGE_PAGES
+  auto const hugePageSize = getHugePageSize();
+  auto const mappedSize = detail::roundUpToHugePageSize(size);
+#ifdef MAP_HUGETLB
+  if (policy == HugePagePolicy::hugeTlb) {
+    void* ptr = mmap(nullptr,
+                     mappedSize,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                     -1,
+                     0);
+    if (ptr != MAP_FAILED) {
+      if (backing) {
+        *backing = PageBacking::hugeTlb;
+      }
+      return ptr;
+    }
+  }
+#endif
+  // over-allocate by a huge page, then trim to a huge page aligned region
+  void* mapped = mmap(nullptr,
+                      mappedSize + hugePageSize,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+  if (mapped == MAP_FAILED) {
+    return nullptr;
+  }
+  auto const begin = reinterpret_cast<std::uintptr_t>(mapped);
+  auto const alignedBegin =
+    (begin + hugePageSize - 1) & ~(std::uintptr_t)(hugePageSize - 1);
+  auto const head = alignedBegin - begin;
+  auto const tail = hugePageSize - head;
+  if (head > 0) {
+    munmap(mapped, head);
+  }
+  if (tail > 0) {
+    munmap(reinterpret_cast<void*>(alignedBegin + mappedSize), tail);
+  }
+  void* ptr = reinterpret_cast<void*>(alignedBegin);
+#ifdef MADV_HUGEPAGE
+  if (policy != HugePagePolicy::regular) {
+    if (madvise(ptr, mappedSize, MADV_HUGEPAGE) == 0 && backing) {
+      *backing = PageBacking::transparent;
+    }
+  }
+#endif
+  return ptr;
+#else
+  (void)policy;
+  return boost::alignment::aligned_alloc(ALIGNMENT, size);
+#endif
+}
+
+/**
+ * Releases memory allocated with allocateHugePages.
+ * @param ptr pointer to the memory to release.
+ * @param size the size that was requested to allocateHugePages, in bytes.
+ */
+inline void
+freeHugePages(void* ptr, std::size_t size)
+{
+  if (!ptr) {
+    return;
+  }
+#if AVEC_HUGE_PAGES
+  munmap(ptr, detail::roundUpToHugePageSize(size));
+#else
+  (void)size;
+  boost::alignment::aligned_free(ptr);
+#endif
+}
+
+/**
+ * Asks the operating system what kind of pages are backing some memory. On
+ * Linux it parses /proc/self/smaps, so it is slow and should not be called on a
+ * real-time thread. On other platforms it always returns PageBacking::regular.
+ * Note that transparent huge pages are only reported once the memory has been
+ * touched.
+ * @param ptr pointer to the memory to query.
+ * @return the kind of pages backing the memory.
+ */
+inline PageBacking
+queryPageBacking(void const* ptr)
+{
+#if AVEC_HUGE_PAGES
+  auto const address = reinterpret_cast<std::uintptr_t>(ptr);
+  std::FILE* smaps = std::fopen("/proc/self/smaps", "r");
+  if (!smaps) {
+    return PageBacking::regular;
+  }
+  auto backing = PageBacking::regular;
+  bool isInMapping = false;
+  char line[512];
+  while (std::fgets(line, sizeof(line), smaps)) {
+    unsigned long long begin = 0, end = 0;
+    unsigned long long value = 0;
+    if (std::sscanf(line, "%llx-%llx ", &begin, &end) == 2) {
+      if (isInMapping) {
+        break;
+      }
+      isInMapping = address >= begin && address < end;
+    }
+    else if (isInMapping) {
+      if (std::sscanf(line, "KernelPageSize: %llu kB", &value) == 1 &&
+          value * 1024 > (unsigned long long)sysconf(_SC_PAGESIZE)) {
+        backing = PageBacking::hugeTlb;
+        break;
+      }
+      if (std::sscanf(line, "AnonHugePages: %llu kB", &value) == 1 &&
+          value > 0) {
+        backing = PageBacking::transparent;
+      }
+    }
+  }
+  std::fclose(smaps);
+  return backing;
+#else
+  (void)ptr;
+  return PageBacking::regular;
+#endif
+}
+
+/**
+ * Allocator that backs allocations of at least getHugePageSize() bytes with
+ * huge pages, using allocateHugePages, and smaller ones with
+ * boost::alignment::aligned_alloc, aligned to the width of a cache line. To be
+ * used with Buffer and VecBuffer holding hundreds of MB, to avoid dTLB misses.
+ * It remembers the backing obtained by its last allocation, so the backing of
+ * a container can be read from the copy returned by its get_allocator(), for
+ * example buffer[channel].get_allocator().getPageBacking() for a Buffer.
+ * @tparam T type of the elements to allocate.
+ * @tparam Policy how to back large allocations.
+ */
+template<class T, HugePagePolicy Policy = HugePagePolicy::transparent>
+class HugePageAllocator
+{
+  PageBacking backing = PageBacking::regular;
+
+public:
+  typedef T value_type;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type is_always_equal;
+
+  template<class U>
+  struct rebind
+  {
+    typedef HugePageAllocator<U, Policy> other;
+  };
+
+  HugePageAllocator() = default;
+
+  template<class U>
+  HugePageAllocator(HugePageAllocator<U, Policy> const& other) noexcept
+    : backing(other.getPageBacking())
+  {}
+
+  T* allocate(size_type size)
+  {
+    if (size == 0) {
+      return nullptr;
+    }
+    auto const numBytes = sizeof(T) * size;
+    backing = PageBacking::regular;
+    void* p = numBytes >= getHugePageSize()
+                ? allocateHugePages(numBytes, Policy, &backing)
+                : boost::alignment::aligned_alloc(
+                    std::max(ALIGNMENT, std::alignment_of<T>::value),
+                    numBytes);
+    if (!p) {
+#ifndef BOOST_NO_EXCEPTIONS
+      throw std::bad_alloc();
+#endif
+    }
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* ptr, size_type size)
+  {
+    auto const numBytes = sizeof(T) * size;
+    if (numBytes >= getHugePageSize()) {
+      freeHugePages(ptr, numBytes);
+    }
+    else {
+      boost::alignment::aligned_free(ptr);
+    }
+  }
+
+  /**
+   * @return the backing obtained by the last allocation made with this
+   * allocator, or by the allocator it was copied from: PageBacking::regular
+   * for the allocations smaller than getHugePageSize(), otherwise the backing
+   * reported by allocateHugePages.
+   */
+  PageBacking getPageBacking() const { return backing; }
+};
+
+template<class T, class U, HugePagePolicy Policy>
+inline bool
+operator==(HugePageAllocator<T, Policy> const&,
+           HugePageAllocator<U, Policy> const&) noexcept
+{
+  return true;
+}
+
+template<class T, class U, HugePagePolicy Policy>
+inline bool
+operator!=(HugePageAllocator<T, Policy> const&,
+           HugePageAllocator<U, Policy> const&) noexcept
+{
+  return false;
+}
+
+} // namespace avec
@@ -22,32 +22,202 @@ limitations under the License.
 
 namespace avec {
 
+namespace detail {
+
+// The copies between the channel groups of an InterleavedBuffer and other
+// layouts. A group of width channels holds the first sample of each of them,
+// then the second one, and so on. They only use the functions of avec and of
+// the simd vectors, so that dispatch/Kernels.cpp can compile them for each
+// instruction set.
+
+/**
+ * Copies numSamples samples of numLanes channels to the first lanes of a
+ * group, leaving the other lanes untouched.
+ * @tparam width the number of channels of the group.
+ * @param channels the channels to copy, lane i is taken from
+ * channels[firstChannel + i].
+ */
+template<uint32_t width, typename Float, class Channels>
+inline void
+channelsToGroup(Channels const& channels,
+                uint32_t firstChannel,
+                uint32_t numLanes,
+                uint32_t numSamples,
+                Float* group)
+{
+  for (uint32_t i = 0; i < numLanes; ++i) {
+    Float const* const in = channels[firstChannel + i];
+    for (uint32_t j = 0; j < numSamples; ++j) {
+      group[j * width + i] = in[j];
+    }
+  }
+}
+
+/**
+ * Copies numSamples samples of the first numLanes lanes of a group to
+ * channels[firstChannel], channels[firstChannel + 1], and so on.
+ * @tparam width the number of channels of the group.
+ */
+template<uint32_t width, typename Float, class Channels>
+inline void
+groupToChannels(Float const* group,
+                uint32_t numLanes,
+                uint32_t numSamples,
+                Channels const& channels,
+                uint32_t firstChannel)
+{
+  for (uint32_t i = 0; i < numLanes; ++i) {
+    Float* const out = channels[firstChannel + i];
+    for (uint32_t j = 0; j < numSamples; ++j) {
+      out[j] = group[j * width + i];
+    }
+  }
+}
+
+/**
+ * Copies numSamples frames of numLanes channels to a group, setting its other
+ * lanes to zero.
+ * @param frames pointer to the first channel to copy in the first frame.
+ * @param numChannels the number of channels of each frame.
+ * @param group the group, aligned to size<Vec>() * sizeof(Float).
+ */
+template<class Vec, typename Float>
+inline void
+framesToGroup(Float const* frames,
+              uint32_t numChannels,
+              uint32_t numLanes,
+              uint32_t numSamples,
+              Float* group)
+{
+  constexpr uint32_t width = size<Vec>();
+  if (numLanes == width) {
+    for (uint32_t j = 0; j < numSamples; ++j) {
+      Vec v;
+      v.load(frames);
+      v.store_a(group + j * width);
+      frames += numChannels;
+    }
+  }
+  else {
+    for (uint32_t j = 0; j < numSamples; ++j) {
+      for (uint32_t i = 0; i < numLanes; ++i) {
+        group[j * width + i] = frames[i];
+      }
+      for (uint32_t i = numLanes; i < width; ++i) {
+        group[j * width + i] = 0.f;
+      }
+      frames += numChannels;
+    }
+  }
+}
+
+/**
+ * Copies numSamples samples of the first numLanes lanes of a group to frames.
+ * @param group the group, aligned to size<Vec>() * sizeof(Float).
+ * @param frames pointer to the first channel to copy to in the first frame.
+ * @param numChannels the number of channels of each frame.
+ */
+template<class Vec, typename Float>
+inline void
+groupToFrames(Float const* group,
+              uint32_t numLanes,
+              uint32_t numSamples,
+              Float* frames,
+              uint32_t numChannels)
+{
+  constexpr uint32_t width = size<Vec>();
+  if (numLanes == width) {
+    for (uint32_t j = 0; j < numSamples; ++j) {
+      Vec v;
+      v.load_a(group + j * width);
+      v.store(frames);
+      frames += numChannels;
+    }
+  }
+  else {
+    for (uint32_t j = 0; j < numSamples; ++j) {
+      for (uint32_t i = 0; i < numLanes; ++i) {
+        frames[i] = group[j * width + i];
+      }
+      frames += numChannels;
+    }
+  }
+}
+
+} // namespace detail
+
 /**
  * A multi channel buffer holding interleaved data to be used with simd
  * vector functions from vectorclass.
  * @tparam Float float or double
+ * @tparam Alignment the alignment of the memory of each VecBuffer, in bytes. It
+ * must be at least the size of the widest simd vector type used.
+ * @tparam Allocator the allocator used for the memory of each VecBuffer. It
+ * must be default constructible and provide memory aligned to Alignment.
  */
 
-template<typename Float>
+template<typename Float,
+         std::size_t Alignment = ALIGNMENT,
+         class Allocator =
+           boost::alignment::aligned_allocator<Float, Alignment>>
 class InterleavedBuffer final
 {
+  static constexpr bool VEC16_AVAILABLE = SimdTypes<Float>::VEC16_AVAILABLE;
+
+  // only used if VEC16_AVAILABLE, otherwise it would require an Alignment of
+  // 64 bytes even when the widest vector used is 32 bytes
+  using Vec16 = typename std::conditional<VEC16_AVAILABLE,
+                                          typename SimdTypes<Float>::Vec16,
+                                          typename SimdTypes<Float>::Vec8>::type;
   using Vec8 = typename SimdTypes<Float>::Vec8;
   using Vec4 = typename SimdTypes<Float>::Vec4;
   using Vec2 = typename SimdTypes<Float>::Vec2;
 
+  template<class Vec>
+  using VecBuffer = avec::VecBuffer<Vec, Alignment, Allocator>;
+
   static constexpr bool VEC8_AVAILABLE = SimdTypes<Float>::VEC8_AVAILABLE;
   static constexpr bool VEC4_AVAILABLE = SimdTypes<Float>::VEC4_AVAILABLE;
   static constexpr bool VEC2_AVAILABLE = SimdTypes<Float>::VEC2_AVAILABLE;
 
+  std::vector<VecBuffer<Vec16>> buffers16;
   std::vector<VecBuffer<Vec8>> buffers8;
   std::vector<VecBuffer<Vec4>> buffers4;
   std::vector<VecBuffer<Vec2>> buffers2;
 
+  using Mask16 = typename MaskTypes<Vec16>::Mask;
+  using Mask8 = typename MaskTypes<Vec8>::Mask;
+  using Mask4 = typename MaskTypes<Vec4>::Mask;
+  using Mask2 = typename MaskTypes<Vec2>::Mask;
+
+  std::vector<bool> activeChannels;
+  std::vector<Mask16> masks16;
+  std::vector<Mask8> masks8;
+  std::vector<Mask4> masks4;
+  std::vector<Mask2> masks2;
+
+  // the bits of the active channels among width channels from firstChannel
+  uint64_t getActiveLanes(uint32_t firstChannel, uint32_t width) const;
+  // recomputes all the masks, sized by setNumChannels
+  void updateMasks();
+  // recomputes in place the mask of the group of a channel, without allocating
+  void updateMask(uint32_t channel);
+
   uint32_t numChannels = 0;
   uint32_t capacity = 0;
   uint32_t numSamples = 0;
 
 public:
+  /**
+   * The alignment of the memory of each VecBuffer, in bytes.
+   */
+  static constexpr std::size_t alignment = Alignment;
+
+  /**
+   * @return the i-th VecBuffer of 16 channel, by reference
+   */
+  VecBuffer<Vec16>& getBuffer16(uint32_t i) { return buffers16[i]; }
+
   /**
    * @return the i-th VecBuffer of 8 channel, by reference
    */
@@ -63,6 +233,14 @@ public:
    */
   VecBuffer<Vec2>& getBuffer2(uint32_t i) { return buffers2[i]; }
 
+  /**
+   * @return the i-th VecBuffer of 16 channel, by const reference
+   */
+  VecBuffer<Vec16> const& getBuffer16(uint32_t i) const
+  {
+    return buffers16[i];
+  }
+
   /**
    * @return the i-th VecBuffer of 8 channel, by const reference
    */
@@ -78,6 +256,11 @@ public:
    */
   VecBuffer<Vec2> const& getBuffer2(uint32_t i) const { return buffers2[i]; }
 
+  /**
+   * @return the number of 16 channels VecBuffers
+   */
+  uint32_t getNumBuffers16() const { return (uint32_t)buffers16.size(); }
+
   /**
    * @return the number of 8 channels VecBuffers
    */
@@ -93,6 +276,51 @@ public:
    */
   uint32_t getNumBuffers2() const { return (uint32_t)buffers2.size(); }
 
+  /**
+   * @return the mask of the active channels of the i-th VecBuffer of 16
+   * channels, to be used with VecView::masked. The lanes past the last
+   * channel are never active.
+   */
+  Mask16 const& getMask16(uint32_t i) const { return masks16[i]; }
+
+  /**
+   * @return the mask of the active channels of the i-th VecBuffer of 8
+   * channels, to be used with VecView::masked. The lanes past the last
+   * channel are never active.
+   */
+  Mask8 const& getMask8(uint32_t i) const { return masks8[i]; }
+
+  /**
+   * @return the mask of the active channels of the i-th VecBuffer of 4
+   * channels, to be used with VecView::masked. The lanes past the last
+   * channel are never active.
+   */
+  Mask4 const& getMask4(uint32_t i) const { return masks4[i]; }
+
+  /**
+   * @return the mask of the active channels of the i-th VecBuffer of 2
+   * channels, to be used with VecView::masked. The lanes past the last
+   * channel are never active.
+   */
+  Mask2 const& getMask2(uint32_t i) const { return masks2[i]; }
+
+  /**
+   * Sets whether a channel is active, for example to bypass or mute it,
+   * updating the mask of its VecBuffer in place. It does not allocate, so it
+   * can be called from the audio thread. All channels are active by default.
+   * @param channel the channel
+   * @param isActive true to activate the channel, false to deactivate it
+   */
+  void setChannelActive(uint32_t channel, bool isActive);
+
+  /**
+   * @return true if the channel is active, see setChannelActive
+   */
+  bool isChannelActive(uint32_t channel) const
+  {
+    return activeChannels[channel];
+  }
+
   /**
    * @return the numSamples of each VecBuffer
    */
@@ -157,7 +385,23 @@ public:
    */
   bool deinterleave(Float** output,
                     uint32_t numOutputChannels,
-                    uint32_t numSamples) const;
+                    uint32_t numSamples) const
+  {
+    return deinterleaveChannels(output, numOutputChannels, numSamples);
+  }
+
+  /**
+   * Deinterleaves the data to an output.
+   * @param output view over the memory in which to store the deinterleaved
+   * data, its number of channels and samples are the ones to deinterleave.
+   * @return true if deinterleaving was successfull, false if the number of
+   * channel of the output is greater to the numChannel of the InterleavedBuffer
+   */
+  bool deinterleave(BufferView<Float> const& output) const
+  {
+    return deinterleaveChannels(
+      output, output.getNumChannels(), output.getNumSamples());
+  }
 
   /**
    * Deinterleaves the data to an output.
@@ -165,7 +409,9 @@ public:
    * @return true if deinterleaving was successfull, false if the number of
    * channel of the output is greater to the numChannel of the InterleavedBuffer
    */
-  bool deinterleave(Buffer<Float>& output) const
+  template<std::size_t BufferAlignment, class BufferAllocator>
+  bool deinterleave(
+    Buffer<Float, BufferAlignment, BufferAllocator>& output) const
   {
     return deinterleave(
       output.get(), output.getNumChannels(), output.getNumSamples());
@@ -183,7 +429,23 @@ public:
    */
   bool interleave(Float* const* input,
                   uint32_t numInputChannels,
-                  uint32_t numInputSamples);
+                  uint32_t numInputSamples)
+  {
+    return interleaveChannels(input, numInputChannels, numInputSamples);
+  }
+
+  /**
+   * Interleaves input data to the VecBuffers.
+   * @param input view over the data to interleave, its number of channels and
+   * samples are the ones to interleave.
+   * @return true if interleaving was successful, false if the number of
+   * channels of the input is greater to the numChannel of the InterleavedBuffer
+   */
+  bool interleave(BufferView<Float const> const& input)
+  {
+    return interleaveChannels(
+      input, input.getNumChannels(), input.getNumSamples());
+  }
 
   /**
    * Interleaves input data to the VecBuffers.
@@ -193,7 +455,9 @@ public:
    * @return true if interleaving was successful, false if numInputChannels
    * is greater to the numChannel of the InterleavedBuffer
    */
-  bool interleave(Buffer<Float> const& input, uint32_t numInputChannels)
+  template<std::size_t BufferAlignment, class BufferAllocator>
+  bool interleave(Buffer<Float, BufferAlignment, BufferAllocator> const& input,
+                  uint32_t numInputChannels)
   {
     if (numInputChannels > input.getNumChannels()) {
       return false;
@@ -207,12 +471,44 @@ public:
    * @return true if interleaving was successful, false if numInputChannels
    * is greater to the numChannel of the InterleavedBuffer
    */
-  bool interleave(Buffer<Float> const& input)
+  template<std::size_t BufferAlignment, class BufferAllocator>
+  bool interleave(Buffer<Float, BufferAlignment, BufferAllocator> const& input)
   {
     return interleave(
       input.get(), input.getNumChannels(), input.getNumSamples());
   }
 
+  /**
+   * Interleaves frame interleaved input data to the VecBuffers: the input
+   * holds all the channels of the first sample, then all the channels of the
+   * second sample, and so on. Any channel of the InterleavedBuffer after the
+   * ones of the input is set to zero.
+   * @param input pointer to the frame interleaved data.
+   * @param numInputChannels number of channels of each frame of the input,
+   * should be less or equal to the numChannel of the InterleavedBuffer
+   * @param numInputSamples number of frames to interleave
+   * @return true if interleaving was successful, false if numInputChannels
+   * is greater to the numChannel of the InterleavedBuffer
+   */
+  bool interleaveFrames(Float const* input,
+                        uint32_t numInputChannels,
+                        uint32_t numInputSamples);
+
+  /**
+   * Deinterleaves the data to frame interleaved output: all the channels of
+   * the first sample, then all the channels of the second sample, and so on.
+   * @param output pointer to the memory in which to store the frame
+   * interleaved data.
+   * @param numOutputChannels number of channels of each frame of the output,
+   * should be less or equal to the numChannel of the InterleavedBuffer
+   * @param numOutputSamples number of frames to deinterleave
+   * @return true if deinterleaving was successful, false if numOutputChannels
+   * is greater to the numChannel of the InterleavedBuffer
+   */
+  bool deinterleaveFrames(Float* output,
+                          uint32_t numOutputChannels,
+                          uint32_t numOutputSamples) const;
+
   /**
    * Returns the value of a a specific sample of a specific channel of the
    * buffer. cosnt version
@@ -253,6 +549,39 @@ public:
   {
     copyFrom(other, other.getNumSamples(), other.getNumChannels());
   }
+
+private:
+  // Channels can be Float* const*, BufferView<Float> or BufferView<Float const>
+  template<class Channels>
+  bool deinterleaveChannels(Channels const& output,
+                            uint32_t numOutputChannels,
+                            uint32_t numOutputSamples) const;
+
+  template<class Channels>
+  bool interleaveChannels(Channels const& input,
+                          uint32_t numInputChannels,
+                          uint32_t numInputSamples);
+
+  // each group holds the channels [firstChannel, firstChannel + size<Vec>())
+  template<class Vec>
+  static void framesToGroups(std::vector<VecBuffer<Vec>>& buffers,
+                             Float const* input,
+                             uint32_t numInputChannels,
+                             uint32_t numInputSamples,
+                             uint32_t& firstChannel);
+
+  template<class Vec>
+  static void groupsToFrames(std::vector<VecBuffer<Vec>> const& buffers,
+                             Float* output,
+                             uint32_t numOutputChannels,
+                             uint32_t numOutputSamples,
+                             uint32_t& firstChannel);
+};
+
+template<typename Float, std::size_t Alignment, class Allocator>
+struct AlignmentOf<InterleavedBuffer<Float, Alignment, Allocator>>
+{
+  static constexpr std::size_t value = Alignment;
 };
 
 static_assert(
@@ -263,24 +592,42 @@ static_assert(std::is_nothrow_move_assignable<InterleavedBuffer<float>>::value,
               "InterleavedBuffer should be noexcept move assignable");
 
 /**
- * Computes the number of VecBuffer of sizes 2, 4, and 8 used by an
+ * Computes the number of VecBuffer of sizes 2, 4, 8 and 16 used by an
  * InterleavedBuffer the supplied number of channels.
  * @param numChannels the total number of channels
  * @param num2 the number of VecBuffer<Vec2> used
  * @param num4 the number of VecBuffer<Vec4> used
  * @param num8 the number of VecBuffer<Vec8> used
+ * @param num16 the number of VecBuffer<Vec16> used
  */
 template<typename Float>
 inline void
 getNumOfVecBuffersUsedByInterleavedBuffer(uint32_t numChannels,
                                           uint32_t& num2,
                                           uint32_t& num4,
-                                          uint32_t& num8)
+                                          uint32_t& num8,
+                                          uint32_t& num16)
 {
+  constexpr bool VEC16_AVAILABLE = SimdTypes<Float>::VEC16_AVAILABLE;
   constexpr bool VEC8_AVAILABLE = SimdTypes<Float>::VEC8_AVAILABLE;
   constexpr bool VEC4_AVAILABLE = SimdTypes<Float>::VEC4_AVAILABLE;
   constexpr bool VEC2_AVAILABLE = SimdTypes<Float>::VEC2_AVAILABLE;
-  if constexpr (VEC8_AVAILABLE) {
+  num16 = 0;
+  if constexpr (VEC16_AVAILABLE) {
+    if (numChannels <= 4) {
+      num4 = 1;
+      num16 = num8 = num2 = 0;
+    }
+    else {
+      auto const quot = numChannels / 16;
+      auto const rem = numChannels % 16;
+      num16 = (uint32_t)quot + (rem > 8 ? 1 : 0);
+      num8 = (rem > 4 && rem <= 8) ? 1 : 0;
+      num4 = (rem > 0 && rem <= 4) ? 1 : 0;
+      num2 = 0;
+    }
+  }
+  else if constexpr (VEC8_AVAILABLE) {
     if (numChannels <= 4) {
       num4 = 1;
       num8 = num2 = 0;
@@ -321,6 +668,32 @@ getNumOfVecBuffersUsedByInterleavedBuffer(uint32_t numChannels,
   }
 }
 
+/**
+ * Computes the number of VecBuffer of sizes 2, 4, and 8 used by an
+ * InterleavedBuffer the supplied number of channels, for code written before
+ * the VecBuffers of size 16. When 16 elements vectors are available, each
+ * VecBuffer<Vec16> is counted as two VecBuffer<Vec8>, which hold the same
+ * channels but not in the same memory layout.
+ * @param numChannels the total number of channels
+ * @param num2 the number of VecBuffer<Vec2> used
+ * @param num4 the number of VecBuffer<Vec4> used
+ * @param num8 the number of VecBuffer<Vec8> used, plus two for each
+ * VecBuffer<Vec16> used
+ */
+template<typename Float>
+[[deprecated("use the overload that also computes the number of "
+             "VecBuffer<Vec16>")]] inline void
+getNumOfVecBuffersUsedByInterleavedBuffer(uint32_t numChannels,
+                                          uint32_t& num2,
+                                          uint32_t& num4,
+                                          uint32_t& num8)
+{
+  uint32_t num16;
+  getNumOfVecBuffersUsedByInterleavedBuffer<Float>(
+    numChannels, num2, num4, num8, num16);
+  num8 += 2 * num16;
+}
+
 /**
  * Consider the at(uint32_t channel, uint32_t sample) method of the
  * InterleavedBuffer. It has to find in what VecBuffer the speficied channel is
@@ -332,6 +705,43 @@ getNumOfVecBuffersUsedByInterleavedBuffer(uint32_t numChannels,
 template<typename Float>
 struct InterleavedChannel final
 {
+  /**
+   * Executes a functor on a specific channel of a structure layed out as the
+   * InterleavedBuffer, including the VecBuffers of size 16.
+   * @param the channel to execute the functor on
+   * @param v2 the container of the Vec2 objects
+   * @param v4 the container of the Vec4 objects
+   * @param v8 the container of the Vec8 objects
+   * @param v16 the container of the Vec16 objects
+   * @param action the functor to execute
+   */
+  template<class Action, class T2, class T4, class T8, class T16>
+  static auto doAtChannel(uint32_t channel,
+                          T2& v2,
+                          T4& v4,
+                          T8& v8,
+                          T16& v16,
+                          Action action)
+  {
+    if constexpr (SimdTypes<Float>::VEC16_AVAILABLE) {
+      // at most a Vec4 and a Vec8 for the first channels, then the Vec16
+      auto const lanes4 = 4 * (uint32_t)v4.size();
+      if (channel < lanes4) {
+        return action(v4[0], channel, 4);
+      }
+      channel -= lanes4;
+      auto const lanes8 = 8 * (uint32_t)v8.size();
+      if (channel < lanes8) {
+        return action(v8[0], channel, 8);
+      }
+      channel -= lanes8;
+      return action(v16[channel / 16], channel % 16, 16);
+    }
+    else {
+      return doAtChannel(channel, v2, v4, v8, action);
+    }
+  }
+
   /**
    * Executes a functor on a specific channel of a structure layed out as the
    * InterleavedBuffer.
@@ -405,14 +815,17 @@ struct InterleavedChannel final
 
 // implementation
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
 void
-InterleavedBuffer<Float>::reserve(uint32_t value)
+InterleavedBuffer<Float, Alignment, Allocator>::reserve(uint32_t value)
 {
   if (capacity >= value) {
     return;
   }
   capacity = value;
+  for (auto& b16 : buffers16) {
+    b16.reserveVec(value);
+  }
   for (auto& b8 : buffers8) {
     b8.reserveVec(value);
   }
@@ -424,12 +837,15 @@ InterleavedBuffer<Float>::reserve(uint32_t value)
   }
 }
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
 inline void
-InterleavedBuffer<Float>::setNumSamples(uint32_t value)
+InterleavedBuffer<Float, Alignment, Allocator>::setNumSamples(uint32_t value)
 {
   numSamples = value;
   reserve(value);
+  for (auto& b16 : buffers16) {
+    b16.setNumSamples(value);
+  }
   for (auto& b8 : buffers8) {
     b8.setNumSamples(value);
   }
@@ -441,27 +857,148 @@ InterleavedBuffer<Float>::setNumSamples(uint32_t value)
   }
 }
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
 void
-InterleavedBuffer<Float>::setNumChannels(uint32_t value)
+InterleavedBuffer<Float, Alignment, Allocator>::setNumChannels(uint32_t value)
 {
   if (numChannels == value)
     return;
   numChannels = value;
-  uint32_t num2, num4, num8;
+  uint32_t num2, num4, num8, num16;
   getNumOfVecBuffersUsedByInterleavedBuffer<Float>(
-    numChannels, num2, num4, num8);
+    numChannels, num2, num4, num8, num16);
+  buffers16.resize(num16);
   buffers8.resize(num8);
   buffers4.resize(num4);
   buffers2.resize(num2);
   reserve(capacity);
   setNumSamples(numSamples);
+  activeChannels.resize(numChannels, true);
+  // the vectors that are not available may not be implemented, as on NEON,
+  // and there are no buffers of them anyway
+  if constexpr (VEC16_AVAILABLE) {
+    masks16.resize(num16);
+  }
+  if constexpr (VEC8_AVAILABLE) {
+    masks8.resize(num8);
+  }
+  if constexpr (VEC4_AVAILABLE) {
+    masks4.resize(num4);
+  }
+  if constexpr (std::is_same<Float, float>::value || supportsDoublePrecision) {
+    masks2.resize(num2);
+  }
+  updateMasks();
 }
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
 void
-InterleavedBuffer<Float>::fill(Float value)
+InterleavedBuffer<Float, Alignment, Allocator>::setChannelActive(
+  uint32_t channel,
+  bool isActive)
 {
+  assert(channel < numChannels);
+  if (activeChannels[channel] != isActive) {
+    activeChannels[channel] = isActive;
+    updateMask(channel);
+  }
+}
+
+template<typename Float, std::size_t Alignment, class Allocator>
+uint64_t
+InterleavedBuffer<Float, Alignment, Allocator>::getActiveLanes(
+  uint32_t firstChannel,
+  uint32_t width) const
+{
+  auto const end = std::min(firstChannel + width, numChannels);
+  uint64_t bits = 0;
+  for (uint32_t channel = firstChannel; channel < end; ++channel) {
+    if (activeChannels[channel]) {
+      bits |= uint64_t(1) << (channel - firstChannel);
+    }
+  }
+  return bits;
+}
+
+template<typename Float, std::size_t Alignment, class Allocator>
+void
+InterleavedBuffer<Float, Alignment, Allocator>::updateMasks()
+{
+  // the groups hold the channels in order of width, as in doAtChannel
+  uint32_t firstChannel = 0;
+  if constexpr (std::is_same<Float, float>::value || supportsDoublePrecision) {
+    for (auto& mask : masks2) {
+      mask = laneMask<Vec2>(getActiveLanes(firstChannel, 2));
+      firstChannel += 2;
+    }
+  }
+  if constexpr (VEC4_AVAILABLE) {
+    for (auto& mask : masks4) {
+      mask = laneMask<Vec4>(getActiveLanes(firstChannel, 4));
+      firstChannel += 4;
+    }
+  }
+  if constexpr (VEC8_AVAILABLE) {
+    for (auto& mask : masks8) {
+      mask = laneMask<Vec8>(getActiveLanes(firstChannel, 8));
+      firstChannel += 8;
+    }
+  }
+  if constexpr (VEC16_AVAILABLE) {
+    for (auto& mask : masks16) {
+      mask = laneMask<Vec16>(getActiveLanes(firstChannel, 16));
+      firstChannel += 16;
+    }
+  }
+}
+
+template<typename Float, std::size_t Alignment, class Allocator>
+void
+InterleavedBuffer<Float, Alignment, Allocator>::updateMask(uint32_t channel)
+{
+  InterleavedChannel<Float>::doAtChannel(
+    channel,
+    buffers2,
+    buffers4,
+    buffers8,
+    buffers16,
+    [&](auto& buffer, uint32_t lane, uint32_t width) {
+      using Buffer = std::decay_t<decltype(buffer)>;
+      auto const bits = getActiveLanes(channel - lane, width);
+      // the vectors of the widths that are not available can be the same type
+      // as the ones of other widths, so the width is checked too
+      if constexpr (std::is_same<Buffer, VecBuffer<Vec16>>::value) {
+        if (width == 16) {
+          masks16[&buffer - buffers16.data()] = laneMask<Vec16>(bits);
+        }
+      }
+      if constexpr (std::is_same<Buffer, VecBuffer<Vec8>>::value) {
+        if (width == 8) {
+          masks8[&buffer - buffers8.data()] = laneMask<Vec8>(bits);
+        }
+      }
+      if constexpr (std::is_same<Buffer, VecBuffer<Vec4>>::value) {
+        if (width == 4) {
+          masks4[&buffer - buffers4.data()] = laneMask<Vec4>(bits);
+        }
+      }
+      if constexpr (std::is_same<Buffer, VecBuffer<Vec2>>::value &&
+                    (std::is_same<Float, float>::value ||
+                     supportsDoublePrecision)) {
+        if (width == 2) {
+          masks2[&buffer - buffers2.data()] = laneMask<Vec2>(bits);
+        }
+      }
+    });
+}
+
+template<typename Float, std::size_t Alignment, class Allocator>
+void
+InterleavedBuffer<Float, Alignment, Allocator>::fill(Float value)
+{
+  for (auto& b16 : buffers16) {
+    b16.fill(value);
+  }
   for (auto& b8 : buffers8) {
     b8.fill(value);
   }
@@ -473,11 +1010,13 @@ InterleavedBuffer<Float>::fill(Float value)
   }
 }
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
+template<class Channels>
 bool
-InterleavedBuffer<Float>::deinterleave(Float** output,
-                                        uint32_t numOutputChannels,
-                                        uint32_t numOutputSamples) const
+InterleavedBuffer<Float, Alignment, Allocator>::deinterleaveChannels(
+  Channels const& output,
+  uint32_t numOutputChannels,
+  uint32_t numOutputSamples) const
 {
   if (numOutputChannels > numChannels || numOutputSamples > numSamples) {
     return false;
@@ -494,12 +1033,11 @@ InterleavedBuffer<Float>::deinterleave(Float** output,
            ++b) {
         auto const r =
           std::min(numOutputChannels - processedChannels, (uint32_t)2);
-        for (uint32_t i = 0; i < r; ++i) {
-          auto c = i + processedChannels;
-          for (uint32_t j = 0; j < numOutputSamples; ++j) {
-            output[c][j] = buffers2[b](j * 2 + i);
-          }
-        }
+        detail::groupToChannels<2>(static_cast<Float const*>(buffers2[b]),
+                                   r,
+                                   numOutputSamples,
+                                   output,
+                                   processedChannels);
         processedChannels += r;
         assert(processedChannels <= numOutputChannels);
         if (processedChannels == numOutputChannels) {
@@ -517,12 +1055,11 @@ InterleavedBuffer<Float>::deinterleave(Float** output,
            ++b) {
         auto const r =
           std::min((uint32_t)4, numOutputChannels - processedChannels);
-        for (uint32_t i = 0; i < r; ++i) {
-          auto c = i + processedChannels;
-          for (uint32_t j = 0; j < numOutputSamples; ++j) {
-            output[c][j] = buffers4[b](j * 4 + i);
-          }
-        }
+        detail::groupToChannels<4>(static_cast<Float const*>(buffers4[b]),
+                                   r,
+                                   numOutputSamples,
+                                   output,
+                                   processedChannels);
         processedChannels += r;
         assert(processedChannels <= numOutputChannels);
         if (processedChannels == numOutputChannels) {
@@ -540,12 +1077,33 @@ InterleavedBuffer<Float>::deinterleave(Float** output,
            ++b) {
         auto const r =
           std::min((uint32_t)8, numOutputChannels - processedChannels);
-        for (uint32_t i = 0; i < r; ++i) {
-          auto c = i + processedChannels;
-          for (uint32_t j = 0; j < numOutputSamples; ++j) {
-            output[c][j] = buffers8[b](j * 8 + i);
-          }
+        detail::groupToChannels<8>(static_cast<Float const*>(buffers8[b]),
+                                   r,
+                                   numOutputSamples,
+                                   output,
+                                   processedChannels);
+        processedChannels += r;
+        assert(processedChannels <= numOutputChannels);
+        if (processedChannels == numOutputChannels) {
+          return true;
         }
+      }
+    }
+  }
+  if constexpr (VEC16_AVAILABLE) {
+    if (buffers16.size() > 0) {
+      auto const quot = numOutputChannels / 16;
+      auto const rem = numOutputChannels % 16;
+      for (uint32_t b = 0;
+           b < std::min(quot + (rem > 0), (uint32_t)buffers16.size());
+           ++b) {
+        auto const r =
+          std::min((uint32_t)16, numOutputChannels - processedChannels);
+        detail::groupToChannels<16>(static_cast<Float const*>(buffers16[b]),
+                                    r,
+                                    numOutputSamples,
+                                    output,
+                                    processedChannels);
         processedChannels += r;
         assert(processedChannels <= numOutputChannels);
         if (processedChannels == numOutputChannels) {
@@ -558,16 +1116,23 @@ InterleavedBuffer<Float>::deinterleave(Float** output,
   return false;
 }
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
+template<class Channels>
 bool
-InterleavedBuffer<Float>::interleave(Float* const* input,
-                                      uint32_t numInputChannels,
-                                      uint32_t numInputSamples)
+InterleavedBuffer<Float, Alignment, Allocator>::interleaveChannels(
+  Channels const& input,
+  uint32_t numInputChannels,
+  uint32_t numInputSamples)
 {
   assert(numInputChannels <= numChannels);
   assert(numInputSamples <= numSamples);
 
-  if (VEC8_AVAILABLE && buffers8.size() > 0) {
+  if (VEC16_AVAILABLE && buffers16.size() > 0) {
+    if (numInputChannels % 16 != 0) {
+      fill(0.f);
+    }
+  }
+  else if (VEC8_AVAILABLE && buffers8.size() > 0) {
     if (numInputChannels % 8 != 0) {
       fill(0.f);
     }
@@ -594,12 +1159,11 @@ InterleavedBuffer<Float>::interleave(Float* const* input,
            ++b) {
         auto const r =
           std::min((uint32_t)2, numInputChannels - processedChannels);
-        for (uint32_t i = 0; i < r; ++i) {
-          auto c = i + processedChannels;
-          for (uint32_t j = 0; j < numInputSamples; ++j) {
-            buffers2[b](j * 2 + i) = input[c][j];
-          }
-        }
+        detail::channelsToGroup<2>(input,
+                                   processedChannels,
+                                   r,
+                                   numInputSamples,
+                                   static_cast<Float*>(buffers2[b]));
         processedChannels += r;
         assert(processedChannels <= numInputChannels);
         if (processedChannels == numInputChannels) {
@@ -617,12 +1181,11 @@ InterleavedBuffer<Float>::interleave(Float* const* input,
            ++b) {
         auto const r =
           std::min((uint32_t)4, numInputChannels - processedChannels);
-        for (uint32_t i = 0; i < r; ++i) {
-          auto c = i + processedChannels;
-          for (uint32_t j = 0; j < numInputSamples; ++j) {
-            buffers4[b](j * 4 + i) = input[c][j];
-          }
-        }
+        detail::channelsToGroup<4>(input,
+                                   processedChannels,
+                                   r,
+                                   numInputSamples,
+                                   static_cast<Float*>(buffers4[b]));
         processedChannels += r;
         assert(processedChannels <= numInputChannels);
         if (processedChannels == numInputChannels) {
@@ -640,12 +1203,33 @@ InterleavedBuffer<Float>::interleave(Float* const* input,
            ++b) {
         auto const r =
           std::min((uint32_t)8, numInputChannels - processedChannels);
-        for (uint32_t i = 0; i < r; ++i) {
-          auto c = i + processedChannels;
-          for (uint32_t j = 0; j < numInputSamples; ++j) {
-            buffers8[b](j * 8 + i) = input[c][j];
-          }
+        detail::channelsToGroup<8>(input,
+                                   processedChannels,
+                                   r,
+                                   numInputSamples,
+                                   static_cast<Float*>(buffers8[b]));
+        processedChannels += r;
+        assert(processedChannels <= numInputChannels);
+        if (processedChannels == numInputChannels) {
+          return true;
         }
+      }
+    }
+  }
+  if constexpr (VEC16_AVAILABLE) {
+    if (buffers16.size() > 0) {
+      auto const quot = numInputChannels / 16;
+      auto const rem = numInputChannels % 16;
+      for (uint32_t b = 0;
+           b < std::min(quot + (rem > 0), (uint32_t)buffers16.size());
+           ++b) {
+        auto const r =
+          std::min((uint32_t)16, numInputChannels - processedChannels);
+        detail::channelsToGroup<16>(input,
+                                    processedChannels,
+                                    r,
+                                    numInputSamples,
+                                    static_cast<Float*>(buffers16[b]));
         processedChannels += r;
         assert(processedChannels <= numInputChannels);
         if (processedChannels == numInputChannels) {
@@ -658,33 +1242,148 @@ InterleavedBuffer<Float>::interleave(Float* const* input,
   return false;
 }
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
+template<class Vec>
+inline void
+InterleavedBuffer<Float, Alignment, Allocator>::framesToGroups(
+  std::vector<VecBuffer<Vec>>& buffers,
+  Float const* input,
+  uint32_t numInputChannels,
+  uint32_t numInputSamples,
+  uint32_t& firstChannel)
+{
+  constexpr uint32_t width = size<Vec>();
+  for (auto& buffer : buffers) {
+    auto const numLanes =
+      firstChannel < numInputChannels
+        ? std::min(width, numInputChannels - firstChannel)
+        : 0;
+    detail::framesToGroup<Vec>(input + firstChannel,
+                               numInputChannels,
+                               numLanes,
+                               numInputSamples,
+                               static_cast<Float*>(buffer));
+    firstChannel += width;
+  }
+}
+
+template<typename Float, std::size_t Alignment, class Allocator>
+template<class Vec>
+inline void
+InterleavedBuffer<Float, Alignment, Allocator>::groupsToFrames(
+  std::vector<VecBuffer<Vec>> const& buffers,
+  Float* output,
+  uint32_t numOutputChannels,
+  uint32_t numOutputSamples,
+  uint32_t& firstChannel)
+{
+  constexpr uint32_t width = size<Vec>();
+  for (auto const& buffer : buffers) {
+    if (firstChannel >= numOutputChannels) {
+      return;
+    }
+    auto const numLanes = std::min(width, numOutputChannels - firstChannel);
+    detail::groupToFrames<Vec>(static_cast<Float const*>(buffer),
+                               numLanes,
+                               numOutputSamples,
+                               output + firstChannel,
+                               numOutputChannels);
+    firstChannel += width;
+  }
+}
+
+template<typename Float, std::size_t Alignment, class Allocator>
+bool
+InterleavedBuffer<Float, Alignment, Allocator>::interleaveFrames(
+  Float const* input,
+  uint32_t numInputChannels,
+  uint32_t numInputSamples)
+{
+  if (numInputChannels > numChannels || numInputSamples > numSamples) {
+    return false;
+  }
+  // same order of the channels as interleave: groups of 2, 4, 8 and 16
+  uint32_t firstChannel = 0;
+  if constexpr (VEC2_AVAILABLE) {
+    framesToGroups(
+      buffers2, input, numInputChannels, numInputSamples, firstChannel);
+  }
+  if constexpr (VEC4_AVAILABLE) {
+    framesToGroups(
+      buffers4, input, numInputChannels, numInputSamples, firstChannel);
+  }
+  if constexpr (VEC8_AVAILABLE) {
+    framesToGroups(
+      buffers8, input, numInputChannels, numInputSamples, firstChannel);
+  }
+  if constexpr (VEC16_AVAILABLE) {
+    framesToGroups(
+      buffers16, input, numInputChannels, numInputSamples, firstChannel);
+  }
+  return true;
+}
+
+template<typename Float, std::size_t Alignment, class Allocator>
+bool
+InterleavedBuffer<Float, Alignment, Allocator>::deinterleaveFrames(
+  Float* output,
+  uint32_t numOutputChannels,
+  uint32_t numOutputSamples) const
+{
+  if (numOutputChannels > numChannels || numOutputSamples > numSamples) {
+    return false;
+  }
+  uint32_t firstChannel = 0;
+  if constexpr (VEC2_AVAILABLE) {
+    groupsToFrames(
+      buffers2, output, numOutputChannels, numOutputSamples, firstChannel);
+  }
+  if constexpr (VEC4_AVAILABLE) {
+    groupsToFrames(
+      buffers4, output, numOutputChannels, numOutputSamples, firstChannel);
+  }
+  if constexpr (VEC8_AVAILABLE) {
+    groupsToFrames(
+      buffers8, output, numOutputChannels, numOutputSamples, firstChannel);
+  }
+  if constexpr (VEC16_AVAILABLE) {
+    groupsToFrames(
+      buffers16, output, numOutputChannels, numOutputSamples, firstChannel);
+  }
+  return true;
+}
+
+template<typename Float, std::size_t Alignment, class Allocator>
 Float const*
-InterleavedBuffer<Float>::at(uint32_t channel, uint32_t sample) const
+InterleavedBuffer<Float, Alignment, Allocator>::at(uint32_t channel,
+                                                   uint32_t sample) const
 {
   return const_cast<Float const*>(
-    const_cast<InterleavedBuffer<Float>*>(this)->at(channel, sample));
+    const_cast<InterleavedBuffer*>(this)->at(channel, sample));
 }
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
 Float*
-InterleavedBuffer<Float>::at(uint32_t channel, uint32_t sample)
+InterleavedBuffer<Float, Alignment, Allocator>::at(uint32_t channel,
+                                                   uint32_t sample)
 {
   return InterleavedChannel<Float>::doAtChannel(
     channel,
     buffers2,
     buffers4,
     buffers8,
+    buffers16,
     [sample](auto& buffer, uint32_t channel, uint32_t numChannels) {
       return &buffer(numChannels * sample + channel);
     });
 }
 
-template<typename Float>
+template<typename Float, std::size_t Alignment, class Allocator>
 inline void
-InterleavedBuffer<Float>::copyFrom(InterleavedBuffer const& other,
-                                    uint32_t numSamplesToCopy,
-                                    uint32_t numChannelsToCopy)
+InterleavedBuffer<Float, Alignment, Allocator>::copyFrom(
+  InterleavedBuffer const& other,
+  uint32_t numSamplesToCopy,
+  uint32_t numChannelsToCopy)
 {
   if (numChannelsToCopy < 0) {
     numChannelsToCopy = other.getNumChannels();
@@ -692,6 +1391,17 @@ InterleavedBuffer<Float>::copyFrom(InterleavedBuffer const& other,
   assert (numChannels >= numChannelsToCopy);
   assert(numSamplesToCopy <= other.getNumSamples());
   assert(numSamplesToCopy <= getNumSamples());
+  if constexpr (VEC16_AVAILABLE) {
+    for (std::size_t i = 0; i < buffers16.size(); ++i) {
+      std::copy(&other.buffers16[i](0),
+                &other.buffers16[i](0) + 16 * numSamples,
+                &buffers16[i](0));
+      numChannelsToCopy -= 16;
+      if (numChannelsToCopy <= 0) {
+        return;
+      }
+    }
+  }
   if constexpr (VEC8_AVAILABLE) {
     for (std::size_t i = 0; i < buffers8.size(); ++i) {
       std::copy(&other.buffers8[i](0),
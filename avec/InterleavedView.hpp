@@ -0,0 +1,426 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include "avec/InterleavedBuffer.hpp"
+
+namespace avec {
+
+/**
+ * A non-owning view over memory layed out as the VecBuffers of an
+ * InterleavedBuffer: groups of 2, 4, 8 and 16 channels, each storing the
+ * samples of its channels interleaved. The groups of 2 channels come first,
+ * then the ones of 4, 8 and 16 channels, and each group holds the
+ * channels following the ones of the previous group. The number of groups of
+ * each width can be the one used by an InterleavedBuffer in this build, see
+ * hasNativeLayout, or the one used by a build for different simd instruction
+ * sets, see regroup. It can view an InterleavedBuffer or memory mapped from a
+ * file, see MappedInterleavedBuffer.
+ * @tparam Float float or double
+ */
+template<typename Float>
+class InterleavedView final
+{
+  std::vector<Float*> buffers16;
+  std::vector<Float*> buffers8;
+  std::vector<Float*> buffers4;
+  std::vector<Float*> buffers2;
+
+  uint32_t numChannels = 0;
+  uint32_t numSamples = 0;
+
+public:
+  /**
+   * Constructor.
+   * @param numChannels the number of channels to view.
+   * @param numSamples the number of samples of each channel.
+   * @param buffers2 pointers to the groups of 2 channels.
+   * @param buffers4 pointers to the groups of 4 channels.
+   * @param buffers8 pointers to the groups of 8 channels.
+   * @param buffers16 pointers to the groups of 16 channels.
+   */
+  InterleavedView(uint32_t numChannels,
+                  uint32_t numSamples,
+                  std::vector<Float*> buffers2,
+                  std::vector<Float*> buffers4,
+                  std::vector<Float*> buffers8,
+                  std::vector<Float*> buffers16 = {})
+    : buffers16(std::move(buffers16))
+    , buffers8(std::move(buffers8))
+    , buffers4(std::move(buffers4))
+    , buffers2(std::move(buffers2))
+    , numChannels(numChannels)
+    , numSamples(numSamples)
+  {
+    assert(getNumLanes() >= numChannels);
+  }
+
+  /**
+   * Constructor. Views all the channels and samples of an InterleavedBuffer.
+   * @param buffer the InterleavedBuffer to view.
+   */
+  template<std::size_t Alignment, class Allocator>
+  InterleavedView(InterleavedBuffer<Float, Alignment, Allocator>& buffer)
+    : numChannels(buffer.getNumChannels())
+    , numSamples(buffer.getNumSamples())
+  {
+    for (uint32_t i = 0; i < buffer.getNumBuffers16(); ++i) {
+      buffers16.push_back(buffer.getBuffer16(i));
+    }
+    for (uint32_t i = 0; i < buffer.getNumBuffers8(); ++i) {
+      buffers8.push_back(buffer.getBuffer8(i));
+    }
+    for (uint32_t i = 0; i < buffer.getNumBuffers4(); ++i) {
+      buffers4.push_back(buffer.getBuffer4(i));
+    }
+    for (uint32_t i = 0; i < buffer.getNumBuffers2(); ++i) {
+      buffers2.push_back(buffer.getBuffer2(i));
+    }
+  }
+
+  InterleavedView() = default;
+
+  /**
+   * @return the samples of the i-th group of 16 channels, interleaved
+   */
+  Float* getBuffer16(uint32_t i) const { return buffers16[i]; }
+
+  /**
+   * @return the samples of the i-th group of 8 channels, interleaved
+   */
+  Float* getBuffer8(uint32_t i) const { return buffers8[i]; }
+
+  /**
+   * @return the samples of the i-th group of 4 channels, interleaved
+   */
+  Float* getBuffer4(uint32_t i) const { return buffers4[i]; }
+
+  /**
+   * @return the samples of the i-th group of 2 channels, interleaved
+   */
+  Float* getBuffer2(uint32_t i) const { return buffers2[i]; }
+
+  /**
+   * @return the number of groups of 16 channels
+   */
+  uint32_t getNumBuffers16() const { return (uint32_t)buffers16.size(); }
+
+  /**
+   * @return the number of groups of 8 channels
+   */
+  uint32_t getNumBuffers8() const { return (uint32_t)buffers8.size(); }
+
+  /**
+   * @return the number of groups of 4 channels
+   */
+  uint32_t getNumBuffers4() const { return (uint32_t)buffers4.size(); }
+
+  /**
+   * @return the number of groups of 2 channels
+   */
+  uint32_t getNumBuffers2() const { return (uint32_t)buffers2.size(); }
+
+  /**
+   * @return the number of samples of each channel
+   */
+  uint32_t getNumSamples() const { return numSamples; }
+
+  /**
+   * @return the number of channels
+   */
+  uint32_t getNumChannels() const { return numChannels; }
+
+  /**
+   * @param channel
+   * @param sample
+   * @return a pointer to the value of the sample of the channel, same as
+   * InterleavedBuffer::at
+   */
+  Float* at(uint32_t channel, uint32_t sample) const
+  {
+    assert(channel < numChannels && sample < numSamples);
+    return doAtChannel(
+      channel, [sample](Float* buffer, uint32_t channel, uint32_t width) {
+        return buffer + width * sample + channel;
+      });
+  }
+
+  /**
+   * Deinterleaves the data to an output.
+   * @param output view over the memory in which to store the deinterleaved
+   * data, its number of channels and samples are the ones to deinterleave.
+   * @return true if deinterleaving was successfull, false if the output has
+   * more channels or samples than the view
+   */
+  bool deinterleave(BufferView<Float> const& output) const
+  {
+    if (output.getNumChannels() > numChannels ||
+        output.getNumSamples() > numSamples) {
+      return false;
+    }
+    for (uint32_t c = 0; c < output.getNumChannels(); ++c) {
+      Float* const out = output[c];
+      doAtChannel(c, [&](Float const* in, uint32_t channel, uint32_t width) {
+        for (uint32_t s = 0; s < output.getNumSamples(); ++s) {
+          out[s] = in[s * width + channel];
+        }
+      });
+    }
+    return true;
+  }
+
+  /**
+   * @return the total number of lanes of the groups, which can be greater than
+   * the number of channels.
+   */
+  uint32_t getNumLanes() const
+  {
+    return 2 * getNumBuffers2() + 4 * getNumBuffers4() +
+           8 * getNumBuffers8() + 16 * getNumBuffers16();
+  }
+
+  /**
+   * @return the total number of groups.
+   */
+  uint32_t getNumGroups() const
+  {
+    return getNumBuffers2() + getNumBuffers4() + getNumBuffers8() +
+           getNumBuffers16();
+  }
+
+  /**
+   * Gets a group of channels by its position in the layout.
+   * @param index the position of the group, groups of 2 channels first, then
+   * the ones of 4, 8 and 16 channels.
+   * @param width set to the number of channels of the group.
+   * @return the samples of the group, interleaved
+   */
+  Float* getGroup(uint32_t index, uint32_t& width) const
+  {
+    if (index < buffers2.size()) {
+      width = 2;
+      return buffers2[index];
+    }
+    index -= (uint32_t)buffers2.size();
+    if (index < buffers4.size()) {
+      width = 4;
+      return buffers4[index];
+    }
+    index -= (uint32_t)buffers4.size();
+    if (index < buffers8.size()) {
+      width = 8;
+      return buffers8[index];
+    }
+    index -= (uint32_t)buffers8.size();
+    width = 16;
+    return buffers16[index];
+  }
+
+  /**
+   * @return true if the number of groups of each width is the one used by an
+   * InterleavedBuffer<Float> with the same number of channels, which depends
+   * on the simd instruction sets the code is compiled for.
+   */
+  bool hasNativeLayout() const
+  {
+    return isNativeLayout(numChannels,
+                          getNumBuffers2(),
+                          getNumBuffers4(),
+                          getNumBuffers8(),
+                          getNumBuffers16());
+  }
+
+  /**
+   * Checks whether a number of groups of each width is the one used by an
+   * InterleavedBuffer<Float> with the same number of channels, see
+   * getNumOfVecBuffersUsedByInterleavedBuffer.
+   * @return true if the layout is the one of an InterleavedBuffer in this build
+   */
+  static bool isNativeLayout(uint32_t numChannels,
+                             uint32_t num2,
+                             uint32_t num4,
+                             uint32_t num8,
+                             uint32_t num16 = 0)
+  {
+    uint32_t expected2, expected4, expected8, expected16;
+    getNumOfVecBuffersUsedByInterleavedBuffer<Float>(
+      numChannels, expected2, expected4, expected8, expected16);
+    return num2 == expected2 && num4 == expected4 && num8 == expected8 &&
+           num16 == expected16;
+  }
+
+private:
+  template<class Action>
+  auto doAtChannel(uint32_t channel, Action action) const
+  {
+    auto const lanes2 = 2 * getNumBuffers2();
+    if (channel < lanes2) {
+      return action(buffers2[channel / 2], channel % 2, 2);
+    }
+    channel -= lanes2;
+    auto const lanes4 = 4 * getNumBuffers4();
+    if (channel < lanes4) {
+      return action(buffers4[channel / 4], channel % 4, 4);
+    }
+    channel -= lanes4;
+    auto const lanes8 = 8 * getNumBuffers8();
+    if (channel < lanes8) {
+      return action(buffers8[channel / 8], channel % 8, 8);
+    }
+    channel -= lanes8;
+    return action(buffers16[channel / 16], channel % 16, 16);
+  }
+};
+
+namespace detail {
+
+template<typename Float>
+inline void
+copyLanes(Float const* input,
+          uint32_t inputWidth,
+          Float* output,
+          uint32_t outputWidth,
+          uint32_t numLanes,
+          uint32_t numSamples)
+{
+  using Vec16 = typename SimdTypes<Float>::Vec16;
+  using Vec8 = typename SimdTypes<Float>::Vec8;
+  using Vec4 = typename SimdTypes<Float>::Vec4;
+  using Vec2 = typename SimdTypes<Float>::Vec2;
+  auto const copyVec = [&](auto vec) {
+    for (uint32_t j = 0; j < numSamples; ++j) {
+      vec.load(input + j * inputWidth);
+      vec.store(output + j * outputWidth);
+    }
+  };
+  if constexpr (SimdTypes<Float>::VEC16_AVAILABLE) {
+    if (numLanes == 16) {
+      copyVec(Vec16());
+      return;
+    }
+  }
+  if constexpr (SimdTypes<Float>::VEC8_AVAILABLE) {
+    if (numLanes == 8) {
+      copyVec(Vec8());
+      return;
+    }
+  }
+  if constexpr (SimdTypes<Float>::VEC4_AVAILABLE) {
+    if (numLanes == 4) {
+      copyVec(Vec4());
+      return;
+    }
+  }
+  if constexpr (SimdTypes<Float>::VEC2_AVAILABLE) {
+    if (numLanes == 2) {
+      copyVec(Vec2());
+      return;
+    }
+  }
+  for (uint32_t j = 0; j < numSamples; ++j) {
+    for (uint32_t i = 0; i < numLanes; ++i) {
+      output[j * outputWidth + i] = input[j * inputWidth + i];
+    }
+  }
+}
+
+} // namespace detail
+
+/**
+ * Copies the samples of an InterleavedView to another one with a different
+ * layout, for example from the layout of an InterleavedBuffer<float> built for
+ * SSE, which only uses groups of 4 channels, to the one of a build for AVX,
+ * which also uses groups of 8 channels. The samples are moved between the
+ * groups a whole group, or half a group, at a time, without going through
+ * planar memory. The lanes of the output after the channels of the input are
+ * set to zero.
+ * @param input the view to copy from.
+ * @param output the view to copy to. It must have at least as many channels
+ * and samples as the input.
+ * @return true on success, false if the output has less channels or samples
+ * than the input.
+ */
+template<typename Float>
+inline bool
+regroup(InterleavedView<Float> const& input,
+        InterleavedView<Float> const& output)
+{
+  if (output.getNumChannels() < input.getNumChannels() ||
+      output.getNumSamples() < input.getNumSamples()) {
+    return false;
+  }
+  auto const numSamples = input.getNumSamples();
+  auto const numChannels = input.getNumChannels();
+  uint32_t inputGroup = 0;
+  uint32_t inputFirstChannel = 0;
+  uint32_t outputFirstChannel = 0;
+  for (uint32_t outputGroup = 0; outputGroup < output.getNumGroups();
+       ++outputGroup) {
+    uint32_t outputWidth;
+    Float* const out = output.getGroup(outputGroup, outputWidth);
+    auto const outputEnd = outputFirstChannel + outputWidth;
+    // the overlaps with the groups of the input
+    auto channel = outputFirstChannel;
+    while (channel < std::min(outputEnd, numChannels)) {
+      uint32_t inputWidth;
+      Float const* const in = input.getGroup(inputGroup, inputWidth);
+      auto const end = std::min(inputFirstChannel + inputWidth, outputEnd);
+      detail::copyLanes(in + (channel - inputFirstChannel),
+                        inputWidth,
+                        out + (channel - outputFirstChannel),
+                        outputWidth,
+                        end - channel,
+                        numSamples);
+      channel = end;
+      if (end == inputFirstChannel + inputWidth) {
+        inputFirstChannel = end;
+        ++inputGroup;
+      }
+    }
+    // lanes after the channels of the input
+    auto const numLanes = channel - outputFirstChannel;
+    if (numLanes < outputWidth) {
+      for (uint32_t j = 0; j < numSamples; ++j) {
+        std::fill(out + j * outputWidth + numLanes,
+                  out + (j + 1) * outputWidth,
+                  (Float)0.f);
+      }
+    }
+    outputFirstChannel = outputEnd;
+  }
+  return true;
+}
+
+/**
+ * Copies the samples of an InterleavedView to an InterleavedBuffer, converting
+ * them from the layout of the view to the one of the InterleavedBuffer, see
+ * regroup(InterleavedView const&, InterleavedView const&).
+ * @param input the view to copy from.
+ * @param output the InterleavedBuffer to copy to. It must have at least as
+ * many channels and samples as the input.
+ * @return true on success, false if the output has less channels or samples
+ * than the input.
+ */
+template<typename Float, std::size_t Alignment, class Allocator>
+inline bool
+regroup(InterleavedView<Float> const& input,
+        InterleavedBuffer<Float, Alignment, Allocator>& output)
+{
+  return regroup(input, InterleavedView<Float>(output));
+}
+
+} // namespace avec
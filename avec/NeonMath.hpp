@@ -18,6 +18,7 @@ limitations under the License.
 #include "NeonMathDouble.hpp"
 #include "NeonMathFloat.hpp"
 #include "NeonVec.hpp"
+#include "NeonVecInt.hpp"
 #include <utility>
 
 
@@ -61,6 +62,65 @@ tan(Vec4f const x)
   return Vec4f(s) / Vec4f(c);
 }
 
+// as in Cephes, a polynomial for small arguments and exp for the others
+inline Vec4f
+tanh(Vec4f const x)
+{
+  Vec4f const z = x * x;
+  Vec4f p = -5.70498872745e-3f;
+  p = p * z + 2.06390887954e-2f;
+  p = p * z - 5.37397155531e-2f;
+  p = p * z + 1.33314422036e-1f;
+  p = p * z - 3.33332819422e-1f;
+  Vec4f const small = p * z * x + x;
+  Vec4f const large = 1.f - 2.f / (exp(x + x) + 1.f);
+  return select(abs(x) < 0.625f, small, large);
+}
+
+inline Vec8f
+sin(Vec8f const x)
+{
+  return Vec8f(sin(x.get_low()), sin(x.get_high()));
+}
+
+inline Vec8f
+cos(Vec8f const x)
+{
+  return Vec8f(cos(x.get_low()), cos(x.get_high()));
+}
+
+inline Vec8f
+log(Vec8f const x)
+{
+  return Vec8f(log(x.get_low()), log(x.get_high()));
+}
+
+inline Vec8f
+exp(Vec8f const x)
+{
+  return Vec8f(exp(x.get_low()), exp(x.get_high()));
+}
+
+inline std::pair<Vec8f, Vec8f>
+sincos(Vec8f const x)
+{
+  auto const low = sincos(x.get_low());
+  auto const high = sincos(x.get_high());
+  return { Vec8f(low.first, high.first), Vec8f(low.second, high.second) };
+}
+
+inline Vec8f
+tan(Vec8f const x)
+{
+  return Vec8f(tan(x.get_low()), tan(x.get_high()));
+}
+
+inline Vec8f
+tanh(Vec8f const x)
+{
+  return Vec8f(tanh(x.get_low()), tanh(x.get_high()));
+}
+
 #if defined(__aarch64__)
 
 inline Vec2d
@@ -103,5 +163,65 @@ tan(Vec2d const x)
   return Vec2d(s) / Vec2d(c);
 }
 
+// as in Cephes, a rational function for small arguments and exp for the others
+inline Vec2d
+tanh(Vec2d const x)
+{
+  Vec2d const z = x * x;
+  Vec2d const p =
+    (-9.64399179425052238628e-1 * z - 9.92877231001918586564e1) * z -
+    1.61468768441708447952e3;
+  Vec2d const q =
+    ((z + 1.12811678491632931402e2) * z + 2.23548839060100448583e3) * z +
+    4.84406305325125486048e3;
+  Vec2d const small = x + x * z * p / q;
+  Vec2d const large = 1.0 - 2.0 / (exp(x + x) + 1.0);
+  return select(abs(x) < 0.625, small, large);
+}
+
+inline Vec4d
+sin(Vec4d const x)
+{
+  return Vec4d(sin(x.get_low()), sin(x.get_high()));
+}
+
+inline Vec4d
+cos(Vec4d const x)
+{
+  return Vec4d(cos(x.get_low()), cos(x.get_high()));
+}
+
+inline Vec4d
+log(Vec4d const x)
+{
+  return Vec4d(log(x.get_low()), log(x.get_high()));
+}
+
+inline Vec4d
+exp(Vec4d const x)
+{
+  return Vec4d(exp(x.get_low()), exp(x.get_high()));
+}
+
+inline std::pair<Vec4d, Vec4d>
+sincos(Vec4d const x)
+{
+  auto const low = sincos(x.get_low());
+  auto const high = sincos(x.get_high());
+  return { Vec4d(low.first, high.first), Vec4d(low.second, high.second) };
+}
+
+inline Vec4d
+tan(Vec4d const x)
+{
+  return Vec4d(tan(x.get_low()), tan(x.get_high()));
+}
+
+inline Vec4d
+tanh(Vec4d const x)
+{
+  return Vec4d(tanh(x.get_low()), tanh(x.get_high()));
+}
+
 #endif
 
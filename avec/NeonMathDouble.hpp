@@ -40,6 +40,11 @@ typedef float64x2_t v2sd; // vector of 2 double
 typedef uint64x2_t v2su;  // vector of 2 uint64
 typedef int64x2_t v2si;   // vector of 2 uint64
 
+// the exponent of double precision values has 11 bits and a bias of 1023
+#define c_inv_mant_mask_pd ~0x7ff0000000000000ll
+#define c_exp_hi_pd 708.396418532264
+#define c_exp_lo_pd -708.396418532264
+
 inline v2sd
 log_pd(v2sd x)
 {
@@ -50,14 +55,14 @@ log_pd(v2sd x)
 
   v2si ux = vreinterpretq_s64_f64(x);
 
-  v2si emm0 = vshrq_n_s64(ux, 23);
+  v2si emm0 = vshrq_n_s64(ux, 52);
 
   /* keep only the fractional part */
-  ux = vandq_s64(ux, vdupq_n_s64(c_inv_mant_mask));
+  ux = vandq_s64(ux, vdupq_n_s64(c_inv_mant_mask_pd));
   ux = vorrq_s64(ux, vreinterpretq_s64_f64(vdupq_n_f64(0.5)));
   x = vreinterpretq_f64_s64(ux);
 
-  emm0 = vsubq_s64(emm0, vdupq_n_s64(0x7f));
+  emm0 = vsubq_s64(emm0, vdupq_n_s64(0x3ff));
   v2sd e = vcvtq_f64_s64(emm0);
 
   e = vaddq_f64(e, one);
@@ -118,8 +123,8 @@ exp_pd(v2sd x)
   v2sd tmp, fx;
 
   v2sd one = vdupq_n_f64(1);
-  x = vminq_f64(x, vdupq_n_f64(c_exp_hi));
-  x = vmaxq_f64(x, vdupq_n_f64(c_exp_lo));
+  x = vminq_f64(x, vdupq_n_f64(c_exp_hi_pd));
+  x = vmaxq_f64(x, vdupq_n_f64(c_exp_lo_pd));
 
   /* express exp(x) as exp(g + n*log(2)) */
   fx = vmlaq_f64(vdupq_n_f64(0.5), x, vdupq_n_f64(c_cephes_LOG2EF));
@@ -167,8 +172,8 @@ exp_pd(v2sd x)
   /* build 2^n */
   int64x2_t mm;
   mm = vcvtq_s64_f64(fx);
-  mm = vaddq_s64(mm, vdupq_n_s64(0x7f));
-  mm = vshlq_n_s64(mm, 23);
+  mm = vaddq_s64(mm, vdupq_n_s64(0x3ff));
+  mm = vshlq_n_s64(mm, 52);
   v2sd pow2n = vreinterpretq_f64_s64(mm);
 
   y = vmulq_f64(y, pow2n);
@@ -260,6 +265,10 @@ cos_pd(v2sd x)
   return ycos;
 }
 
+#undef c_inv_mant_mask_pd
+#undef c_exp_hi_pd
+#undef c_exp_lo_pd
+
 } // namespace detail
 } // namespace avec
 
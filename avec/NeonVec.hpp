@@ -18,7 +18,8 @@ limitations under the License.
  * This file implements some of the functionality of  Agner Fog's Vectorclass
  * for NEON.
  * The classes Vec2d and Vec4f are implemented with most of their operators and
- * functions, as in the file vectorf128.h.
+ * functions, as in the file vectorf128.h. Vec8f and Vec4d are implemented as
+ * pairs of Vec4f and Vec2d, with the same operators and functions.
  * Overloads for exp, log, sin and cos are implemented in the NeonMath* files
  * using Julien Pommier's neon_mathfun.
  * Some code has been adapted from https://github.com/DLTcollab/sse2neon
@@ -919,6 +920,240 @@ change_sign(Vec4f const a)
     vreinterpretq_s32_f32(a), vreinterpretq_s32_f32(_mm_castsi128_ps(mask))));
 }
 
+/*****************************************************************************
+ *
+ *          Vectors made of pairs of registers
+ *
+ *****************************************************************************/
+
+// NEON has no registers wider than 128 bits, so the wider vectors hold a pair
+// of registers, and their operators and functions are applied to the two
+// halves. The two instructions are independent, so the core can execute them
+// in parallel in its floating point pipelines.
+
+#define AVEC_NEON_PAIR_OPERATOR(Pair, op)                                      \
+  static inline Pair operator op(Pair const a, Pair const b)                   \
+  {                                                                            \
+    return Pair(a.get_low() op b.get_low(), a.get_high() op b.get_high());     \
+  }
+
+#define AVEC_NEON_PAIR_SCALAR_OPERATOR(Pair, Scalar, op)                       \
+  static inline Pair operator op(Pair const a, Scalar b)                       \
+  {                                                                            \
+    return a op Pair(b);                                                       \
+  }                                                                            \
+  static inline Pair operator op(Scalar a, Pair const b)                       \
+  {                                                                            \
+    return Pair(a) op b;                                                       \
+  }
+
+#define AVEC_NEON_PAIR_ASSIGNMENT(Pair, op)                                    \
+  static inline Pair& operator op##=(Pair& a, Pair const b)                    \
+  {                                                                            \
+    a = a op b;                                                                \
+    return a;                                                                  \
+  }
+
+#define AVEC_NEON_PAIR_FUNCTION1(Pair, function)                               \
+  static inline Pair function(Pair const a)                                    \
+  {                                                                            \
+    return Pair(function(a.get_low()), function(a.get_high()));                \
+  }
+
+#define AVEC_NEON_PAIR_FUNCTION2(Pair, function)                               \
+  static inline Pair function(Pair const a, Pair const b)                      \
+  {                                                                            \
+    return Pair(function(a.get_low(), b.get_low()),                            \
+                function(a.get_high(), b.get_high()));                         \
+  }
+
+#define AVEC_NEON_PAIR_FUNCTION3(Pair, function)                               \
+  static inline Pair function(Pair const a, Pair const b, Pair const c)        \
+  {                                                                            \
+    return Pair(function(a.get_low(), b.get_low(), c.get_low()),               \
+                function(a.get_high(), b.get_high(), c.get_high()));           \
+  }
+
+// the operators and functions that Vec4f and Vec2d have in common
+#define AVEC_NEON_PAIR_OPERATORS(Pair, Scalar)                                 \
+  AVEC_NEON_PAIR_OPERATOR(Pair, +)                                             \
+  AVEC_NEON_PAIR_SCALAR_OPERATOR(Pair, Scalar, +)                              \
+  AVEC_NEON_PAIR_ASSIGNMENT(Pair, +)                                           \
+  AVEC_NEON_PAIR_OPERATOR(Pair, -)                                             \
+  AVEC_NEON_PAIR_SCALAR_OPERATOR(Pair, Scalar, -)                              \
+  AVEC_NEON_PAIR_ASSIGNMENT(Pair, -)                                           \
+  AVEC_NEON_PAIR_OPERATOR(Pair, *)                                             \
+  AVEC_NEON_PAIR_SCALAR_OPERATOR(Pair, Scalar, *)                              \
+  AVEC_NEON_PAIR_ASSIGNMENT(Pair, *)                                           \
+  AVEC_NEON_PAIR_OPERATOR(Pair, /)                                             \
+  AVEC_NEON_PAIR_SCALAR_OPERATOR(Pair, Scalar, /)                              \
+  AVEC_NEON_PAIR_ASSIGNMENT(Pair, /)                                           \
+  AVEC_NEON_PAIR_OPERATOR(Pair, ==)                                            \
+  AVEC_NEON_PAIR_OPERATOR(Pair, !=)                                            \
+  AVEC_NEON_PAIR_OPERATOR(Pair, <)                                             \
+  AVEC_NEON_PAIR_OPERATOR(Pair, <=)                                            \
+  AVEC_NEON_PAIR_OPERATOR(Pair, >)                                             \
+  AVEC_NEON_PAIR_OPERATOR(Pair, >=)                                            \
+  AVEC_NEON_PAIR_OPERATOR(Pair, &&)                                            \
+  AVEC_NEON_PAIR_OPERATOR(Pair, &)                                             \
+  AVEC_NEON_PAIR_ASSIGNMENT(Pair, &)                                           \
+  AVEC_NEON_PAIR_OPERATOR(Pair, |)                                             \
+  AVEC_NEON_PAIR_ASSIGNMENT(Pair, |)                                           \
+  AVEC_NEON_PAIR_OPERATOR(Pair, ^)                                             \
+  AVEC_NEON_PAIR_ASSIGNMENT(Pair, ^)                                           \
+  static inline Pair operator-(Pair const a)                                   \
+  {                                                                            \
+    return Pair(-a.get_low(), -a.get_high());                                  \
+  }                                                                            \
+  static inline Pair operator!(Pair const a)                                   \
+  {                                                                            \
+    return Pair(!a.get_low(), !a.get_high());                                  \
+  }                                                                            \
+  static inline Pair operator++(Pair& a, int)                                  \
+  {                                                                            \
+    Pair a0 = a;                                                               \
+    a = a + Scalar(1);                                                         \
+    return a0;                                                                 \
+  }                                                                            \
+  static inline Pair& operator++(Pair& a)                                      \
+  {                                                                            \
+    a = a + Scalar(1);                                                         \
+    return a;                                                                  \
+  }                                                                            \
+  static inline Pair operator--(Pair& a, int)                                  \
+  {                                                                            \
+    Pair a0 = a;                                                               \
+    a = a - Scalar(1);                                                         \
+    return a0;                                                                 \
+  }                                                                            \
+  static inline Pair& operator--(Pair& a)                                      \
+  {                                                                            \
+    a = a - Scalar(1);                                                         \
+    return a;                                                                  \
+  }                                                                            \
+  AVEC_NEON_PAIR_FUNCTION3(Pair, select)                                       \
+  AVEC_NEON_PAIR_FUNCTION3(Pair, if_add)                                       \
+  AVEC_NEON_PAIR_FUNCTION3(Pair, if_sub)                                       \
+  AVEC_NEON_PAIR_FUNCTION3(Pair, if_mul)                                       \
+  AVEC_NEON_PAIR_FUNCTION3(Pair, if_div)                                       \
+  AVEC_NEON_PAIR_FUNCTION3(Pair, mul_add)                                      \
+  AVEC_NEON_PAIR_FUNCTION3(Pair, mul_sub)                                      \
+  AVEC_NEON_PAIR_FUNCTION3(Pair, nmul_add)                                     \
+  AVEC_NEON_PAIR_FUNCTION2(Pair, sign_combine)                                 \
+  AVEC_NEON_PAIR_FUNCTION2(Pair, max)                                          \
+  AVEC_NEON_PAIR_FUNCTION2(Pair, min)                                          \
+  AVEC_NEON_PAIR_FUNCTION1(Pair, abs)                                          \
+  AVEC_NEON_PAIR_FUNCTION1(Pair, sqrt)                                         \
+  AVEC_NEON_PAIR_FUNCTION1(Pair, square)                                       \
+  AVEC_NEON_PAIR_FUNCTION1(Pair, round)                                        \
+  AVEC_NEON_PAIR_FUNCTION1(Pair, truncate)                                     \
+  AVEC_NEON_PAIR_FUNCTION1(Pair, floor)                                        \
+  AVEC_NEON_PAIR_FUNCTION1(Pair, ceil)
+
+/*****************************************************************************
+ *
+ *          Vec8f: a pair of Vec4f
+ *
+ *****************************************************************************/
+
+class Vec8f
+{
+protected:
+  float32x4x2_t vec; // Pair of float vectors
+public:
+  // Default constructor:
+  Vec8f() {}
+
+  // Constructor to broadcast the same value into all elements:
+  Vec8f(float f)
+  {
+    vec.val[0] = vdupq_n_f32(f);
+    vec.val[1] = vec.val[0];
+  }
+
+  // Constructor to build from all elements:
+  Vec8f(float f0,
+        float f1,
+        float f2,
+        float f3,
+        float f4,
+        float f5,
+        float f6,
+        float f7)
+  {
+    vec.val[0] = Vec4f(f0, f1, f2, f3);
+    vec.val[1] = Vec4f(f4, f5, f6, f7);
+  }
+
+  // Constructor to build from two Vec4f:
+  Vec8f(Vec4f const a0, Vec4f const a1)
+  {
+    vec.val[0] = a0;
+    vec.val[1] = a1;
+  }
+
+  // Constructor to convert from type float32x4x2_t used in intrinsics:
+  Vec8f(float32x4x2_t const x) { vec = x; }
+
+  // Assignment operator to convert from type float32x4x2_t used in intrinsics:
+  Vec8f& operator=(float32x4x2_t const x)
+  {
+    vec = x;
+    return *this;
+  }
+
+  // Type cast operator to convert to float32x4x2_t used in intrinsics
+  operator float32x4x2_t() const { return vec; }
+
+  // Member function to load from array
+  Vec8f& load(float const* p)
+  {
+    vec.val[0] = vld1q_f32(p);
+    vec.val[1] = vld1q_f32(p + 4);
+    return *this;
+  }
+
+  Vec8f& load_a(float const* p) { return load(p); }
+
+  // Member function to store into array
+  void store(float* p) const
+  {
+    vst1q_f32(p, vec.val[0]);
+    vst1q_f32(p + 4, vec.val[1]);
+  }
+
+  void store_a(float* p) const { store(p); }
+
+  // Member function extract a single element from vector
+  float extract(int index) const
+  {
+    float x[8];
+    store(x);
+    return x[index & 7];
+  }
+
+  // Extract a single element. Use store function if extracting more than one
+  // element. Operator [] can only read an element, not write.
+  float operator[](int index) const { return extract(index); }
+
+  // Member functions to split into two Vec4f:
+  Vec4f get_low() const { return vec.val[0]; }
+
+  Vec4f get_high() const { return vec.val[1]; }
+
+  static constexpr int size() { return 8; }
+
+  static constexpr int elementtype() { return 16; }
+
+  typedef float32x4x2_t registertype;
+};
+
+using Vec8fb = Vec8f;
+
+AVEC_NEON_PAIR_OPERATORS(Vec8f, float)
+AVEC_NEON_PAIR_FUNCTION1(Vec8f, approx_recipr)
+AVEC_NEON_PAIR_FUNCTION1(Vec8f, approx_rsqrt)
+
 #if defined(__aarch64__)
 
 /*****************************************************************************
@@ -1370,6 +1605,115 @@ static inline Vec2d permute2(Vec2d const in)
   }
 }
 
+/*****************************************************************************
+ *
+ *          Vec4d: a pair of Vec2d
+ *
+ *****************************************************************************/
+
+class Vec4d
+{
+protected:
+  float64x2x2_t vec; // Pair of double vectors
+public:
+  // Default constructor:
+  Vec4d() {}
+
+  // Constructor to broadcast the same value into all elements:
+  Vec4d(double d)
+  {
+    vec.val[0] = vdupq_n_f64(d);
+    vec.val[1] = vec.val[0];
+  }
+
+  // Constructor to build from all elements:
+  Vec4d(double d0, double d1, double d2, double d3)
+  {
+    vec.val[0] = Vec2d(d0, d1);
+    vec.val[1] = Vec2d(d2, d3);
+  }
+
+  // Constructor to build from two Vec2d:
+  Vec4d(Vec2d const a0, Vec2d const a1)
+  {
+    vec.val[0] = a0;
+    vec.val[1] = a1;
+  }
+
+  // Constructor to convert from type float64x2x2_t used in intrinsics:
+  Vec4d(float64x2x2_t const x) { vec = x; }
+
+  // Assignment operator to convert from type float64x2x2_t used in intrinsics:
+  Vec4d& operator=(float64x2x2_t const x)
+  {
+    vec = x;
+    return *this;
+  }
+
+  // Type cast operator to convert to float64x2x2_t used in intrinsics
+  operator float64x2x2_t() const { return vec; }
+
+  // Member function to load from array
+  Vec4d& load(double const* p)
+  {
+    vec.val[0] = vld1q_f64(p);
+    vec.val[1] = vld1q_f64(p + 2);
+    return *this;
+  }
+
+  Vec4d& load_a(double const* p) { return load(p); }
+
+  // Member function to store into array
+  void store(double* p) const
+  {
+    vst1q_f64(p, vec.val[0]);
+    vst1q_f64(p + 2, vec.val[1]);
+  }
+
+  void store_a(double* p) const { store(p); }
+
+  // Member function extract a single element from vector
+  double extract(int index) const
+  {
+    double x[4];
+    store(x);
+    return x[index & 3];
+  }
+
+  // Extract a single element. Use store function if extracting more than one
+  // element. Operator [] can only read an element, not write.
+  double operator[](int index) const { return extract(index); }
+
+  // Member functions to split into two Vec2d:
+  Vec2d get_low() const { return vec.val[0]; }
+
+  Vec2d get_high() const { return vec.val[1]; }
+
+  static constexpr int size() { return 4; }
+
+  static constexpr int elementtype() { return 17; }
+
+  typedef float64x2x2_t registertype;
+};
+
+using Vec4db = Vec4d;
+
+AVEC_NEON_PAIR_OPERATORS(Vec4d, double)
+
+// Conversions between Vec4f and Vec4d
+static inline Vec4d
+to_double(Vec4f const a)
+{
+  float32x4_t const x = a;
+  return Vec4d(vcvt_f64_f32(vget_low_f32(x)), vcvt_high_f64_f32(x));
+}
+
+static inline Vec4f
+to_float(Vec4d const a)
+{
+  return vcvt_high_f32_f64(vcvt_f32_f64(a.get_low()), a.get_high());
+}
+
 #endif // defined(__aarch64__)
 
 //
@@ -1378,6 +1722,8 @@ static inline Vec2d permute2(Vec2d const in)
  *  NOT IMPLEMENTED, these are just here for compatibility with vectorclass
  *
  *****************************************************************************/
+#if !defined(__aarch64__)
+
 class Vec4d final
 {
   Vec4d() = default;
@@ -1388,15 +1734,7 @@ public:
 
 using Vec4db = Vec4d;
 
-class Vec8f final
-{
-  Vec8f() = default;
-
-public:
-  static constexpr int size() { return 8; }
-};
-
-using Vec8fb = Vec8f;
+#endif
 
 class Vec8d final
 {
@@ -1417,3 +1755,11 @@ public:
 };
 
 using Vec16fb = Vec16f;
+
+#undef AVEC_NEON_PAIR_OPERATORS
+#undef AVEC_NEON_PAIR_FUNCTION3
+#undef AVEC_NEON_PAIR_FUNCTION2
+#undef AVEC_NEON_PAIR_FUNCTION1
+#undef AVEC_NEON_PAIR_ASSIGNMENT
+#undef AVEC_NEON_PAIR_SCALAR_OPERATOR
+#undef AVEC_NEON_PAIR_OPERATOR
@@ -0,0 +1,370 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+ * This file implements the 128 bit integer vectors of Agner Fog's Vectorclass
+ * for NEON: Vec16c, Vec16uc, Vec8s, Vec8us, Vec4i, Vec4ui, Vec2q and Vec2uq,
+ * with loads, stores and the basic arithmetic and bitwise operators, enough to
+ * use them with VecBuffer and VecView.
+ * The wider integer vectors are only declared, for compatibility with
+ * vectorclass, like Vec8f and Vec4d in NeonVec.hpp.
+ * */
+
+#pragma once
+
+#include <arm_neon.h>
+#include <cstdint>
+
+namespace avec {
+namespace detail {
+
+#define AVEC_NEON_INT_OPS(Scalar, Register, suffix)                            \
+  inline Register neonLoad(Scalar const* p)                                    \
+  {                                                                            \
+    return vld1q_##suffix(p);                                                  \
+  }                                                                            \
+  inline void neonStore(Scalar* p, Register x)                                 \
+  {                                                                            \
+    vst1q_##suffix(p, x);                                                      \
+  }                                                                            \
+  inline Register neonBroadcast(Scalar x)                                      \
+  {                                                                            \
+    return vdupq_n_##suffix(x);                                                \
+  }                                                                            \
+  inline Register neonAdd(Register a, Register b)                              \
+  {                                                                            \
+    return vaddq_##suffix(a, b);                                               \
+  }                                                                            \
+  inline Register neonSub(Register a, Register b)                              \
+  {                                                                            \
+    return vsubq_##suffix(a, b);                                               \
+  }                                                                            \
+  inline Register neonAnd(Register a, Register b)                              \
+  {                                                                            \
+    return vandq_##suffix(a, b);                                               \
+  }                                                                            \
+  inline Register neonOr(Register a, Register b)                               \
+  {                                                                            \
+    return vorrq_##suffix(a, b);                                               \
+  }                                                                            \
+  inline Register neonXor(Register a, Register b)                              \
+  {                                                                            \
+    return veorq_##suffix(a, b);                                               \
+  }
+
+AVEC_NEON_INT_OPS(int8_t, int8x16_t, s8)
+AVEC_NEON_INT_OPS(uint8_t, uint8x16_t, u8)
+AVEC_NEON_INT_OPS(int16_t, int16x8_t, s16)
+AVEC_NEON_INT_OPS(uint16_t, uint16x8_t, u16)
+AVEC_NEON_INT_OPS(int32_t, int32x4_t, s32)
+AVEC_NEON_INT_OPS(uint32_t, uint32x4_t, u32)
+AVEC_NEON_INT_OPS(int64_t, int64x2_t, s64)
+AVEC_NEON_INT_OPS(uint64_t, uint64x2_t, u64)
+
+#undef AVEC_NEON_INT_OPS
+
+// shifts by a signed amount: left if positive, right if negative, arithmetic
+// for signed elements and logical for unsigned ones, as in vectorclass
+
+#define AVEC_NEON_INT_SHIFT(Register, SignedScalar, suffix, signedSuffix)      \
+  inline Register neonShift(Register a, int b)                                 \
+  {                                                                            \
+    return vshlq_##suffix(a, vdupq_n_##signedSuffix((SignedScalar)b));         \
+  }
+
+AVEC_NEON_INT_SHIFT(int8x16_t, int8_t, s8, s8)
+AVEC_NEON_INT_SHIFT(uint8x16_t, int8_t, u8, s8)
+AVEC_NEON_INT_SHIFT(int16x8_t, int16_t, s16, s16)
+AVEC_NEON_INT_SHIFT(uint16x8_t, int16_t, u16, s16)
+AVEC_NEON_INT_SHIFT(int32x4_t, int32_t, s32, s32)
+AVEC_NEON_INT_SHIFT(uint32x4_t, int32_t, u32, s32)
+AVEC_NEON_INT_SHIFT(int64x2_t, int64_t, s64, s64)
+AVEC_NEON_INT_SHIFT(uint64x2_t, int64_t, u64, s64)
+
+#undef AVEC_NEON_INT_SHIFT
+
+// there is no 64 bit integer multiplication in NEON
+
+#define AVEC_NEON_INT_MUL(Register, suffix)                                    \
+  inline Register neonMul(Register a, Register b)                              \
+  {                                                                            \
+    return vmulq_##suffix(a, b);                                               \
+  }
+
+AVEC_NEON_INT_MUL(int8x16_t, s8)
+AVEC_NEON_INT_MUL(uint8x16_t, u8)
+AVEC_NEON_INT_MUL(int16x8_t, s16)
+AVEC_NEON_INT_MUL(uint16x8_t, u16)
+AVEC_NEON_INT_MUL(int32x4_t, s32)
+AVEC_NEON_INT_MUL(uint32x4_t, u32)
+
+#undef AVEC_NEON_INT_MUL
+
+template<class Register, typename Scalar>
+inline Register
+neonMulLanes(Register a, Register b)
+{
+  Scalar x[2], y[2];
+  neonStore(x, a);
+  neonStore(y, b);
+  x[0] *= y[0];
+  x[1] *= y[1];
+  return neonLoad(x);
+}
+
+inline int64x2_t
+neonMul(int64x2_t a, int64x2_t b)
+{
+  return neonMulLanes<int64x2_t, int64_t>(a, b);
+}
+
+inline uint64x2_t
+neonMul(uint64x2_t a, uint64x2_t b)
+{
+  return neonMulLanes<uint64x2_t, uint64_t>(a, b);
+}
+
+/**
+ * A 128 bit vector of integers, implemented with NEON.
+ * @tparam Scalar the type of the elements.
+ * @tparam Register the NEON type of the vector.
+ */
+template<typename Scalar, class Register>
+class NeonIntVec
+{
+protected:
+  Register vec;
+
+public:
+  // Default constructor:
+  NeonIntVec() {}
+
+  // Constructor to broadcast the same value into all elements:
+  NeonIntVec(Scalar x) { vec = neonBroadcast(x); }
+
+  // Constructor to convert from the type used in intrinsics:
+  NeonIntVec(Register const x) { vec = x; }
+
+  // Assignment operator to convert from the type used in intrinsics:
+  NeonIntVec& operator=(Register const x)
+  {
+    vec = x;
+    return *this;
+  }
+
+  // Type cast operator to convert to the type used in intrinsics
+  operator Register() const { return vec; }
+
+  // Member function to load from array
+  NeonIntVec& load(void const* p)
+  {
+    vec = neonLoad(static_cast<Scalar const*>(p));
+    return *this;
+  }
+
+  NeonIntVec& load_a(void const* p)
+  {
+    vec = neonLoad(static_cast<Scalar const*>(p));
+    return *this;
+  }
+
+  // Member function to store into array
+  void store(void* p) const { neonStore(static_cast<Scalar*>(p), vec); }
+
+  void store_a(void* p) const { neonStore(static_cast<Scalar*>(p), vec); }
+
+  // Member function extract a single element from vector
+  Scalar extract(int index) const
+  {
+    Scalar x[size()];
+    store(x);
+    return x[index & (size() - 1)];
+  }
+
+  // Extract a single element. Use store function if extracting more than one
+  // element. Operator [] can only read an element, not write.
+  Scalar operator[](int index) const { return extract(index); }
+
+  static constexpr int size() { return 16 / sizeof(Scalar); }
+
+  typedef Register registertype;
+
+  // operators, defined here so that scalars of any integer type are converted
+  // to Scalar, as in vectorclass
+
+  friend NeonIntVec operator+(NeonIntVec const a, NeonIntVec const b)
+  {
+    return neonAdd(a.vec, b.vec);
+  }
+
+  friend NeonIntVec operator-(NeonIntVec const a, NeonIntVec const b)
+  {
+    return neonSub(a.vec, b.vec);
+  }
+
+  friend NeonIntVec operator*(NeonIntVec const a, NeonIntVec const b)
+  {
+    return neonMul(a.vec, b.vec);
+  }
+
+  friend NeonIntVec operator&(NeonIntVec const a, NeonIntVec const b)
+  {
+    return neonAnd(a.vec, b.vec);
+  }
+
+  friend NeonIntVec operator|(NeonIntVec const a, NeonIntVec const b)
+  {
+    return neonOr(a.vec, b.vec);
+  }
+
+  friend NeonIntVec operator^(NeonIntVec const a, NeonIntVec const b)
+  {
+    return neonXor(a.vec, b.vec);
+  }
+
+  friend NeonIntVec operator~(NeonIntVec const a)
+  {
+    return neonXor(a.vec, neonBroadcast((Scalar)~Scalar(0)));
+  }
+
+  friend NeonIntVec operator-(NeonIntVec const a)
+  {
+    return NeonIntVec(Scalar(0)) - a;
+  }
+
+  friend NeonIntVec operator<<(NeonIntVec const a, int b)
+  {
+    return neonShift(a.vec, b);
+  }
+
+  friend NeonIntVec operator>>(NeonIntVec const a, int b)
+  {
+    return neonShift(a.vec, -b);
+  }
+
+  friend NeonIntVec& operator+=(NeonIntVec& a, NeonIntVec const b)
+  {
+    a = a + b;
+    return a;
+  }
+
+  friend NeonIntVec& operator-=(NeonIntVec& a, NeonIntVec const b)
+  {
+    a = a - b;
+    return a;
+  }
+
+  friend NeonIntVec& operator*=(NeonIntVec& a, NeonIntVec const b)
+  {
+    a = a * b;
+    return a;
+  }
+
+  friend NeonIntVec& operator&=(NeonIntVec& a, NeonIntVec const b)
+  {
+    a = a & b;
+    return a;
+  }
+
+  friend NeonIntVec& operator|=(NeonIntVec& a, NeonIntVec const b)
+  {
+    a = a | b;
+    return a;
+  }
+
+  friend NeonIntVec& operator^=(NeonIntVec& a, NeonIntVec const b)
+  {
+    a = a ^ b;
+    return a;
+  }
+
+  friend NeonIntVec& operator<<=(NeonIntVec& a, int b)
+  {
+    a = a << b;
+    return a;
+  }
+
+  friend NeonIntVec& operator>>=(NeonIntVec& a, int b)
+  {
+    a = a >> b;
+    return a;
+  }
+};
+
+/**
+ * NOT IMPLEMENTED, a vector of integers wider than 128 bits, just here for
+ * compatibility with vectorclass.
+ */
+template<typename Scalar, int Size>
+class NeonIntVecStub final
+{
+  NeonIntVecStub() = default;
+
+public:
+  static constexpr int size() { return Size; }
+};
+
+} // namespace detail
+} // namespace avec
+
+using Vec16c = avec::detail::NeonIntVec<int8_t, int8x16_t>;
+using Vec16uc = avec::detail::NeonIntVec<uint8_t, uint8x16_t>;
+using Vec8s = avec::detail::NeonIntVec<int16_t, int16x8_t>;
+using Vec8us = avec::detail::NeonIntVec<uint16_t, uint16x8_t>;
+using Vec4i = avec::detail::NeonIntVec<int32_t, int32x4_t>;
+using Vec4ui = avec::detail::NeonIntVec<uint32_t, uint32x4_t>;
+using Vec2q = avec::detail::NeonIntVec<int64_t, int64x2_t>;
+using Vec2uq = avec::detail::NeonIntVec<uint64_t, uint64x2_t>;
+
+using Vec16cb = Vec16c;
+using Vec8sb = Vec8s;
+using Vec4ib = Vec4i;
+using Vec2qb = Vec2q;
+
+//
+/*****************************************************************************
+ *
+ *  NOT IMPLEMENTED, these are just here for compatibility with vectorclass
+ *
+ *****************************************************************************/
+
+using Vec32c = avec::detail::NeonIntVecStub<int8_t, 32>;
+using Vec32uc = avec::detail::NeonIntVecStub<uint8_t, 32>;
+using Vec16s = avec::detail::NeonIntVecStub<int16_t, 16>;
+using Vec16us = avec::detail::NeonIntVecStub<uint16_t, 16>;
+using Vec8i = avec::detail::NeonIntVecStub<int32_t, 8>;
+using Vec8ui = avec::detail::NeonIntVecStub<uint32_t, 8>;
+using Vec4q = avec::detail::NeonIntVecStub<int64_t, 4>;
+using Vec4uq = avec::detail::NeonIntVecStub<uint64_t, 4>;
+
+using Vec64c = avec::detail::NeonIntVecStub<int8_t, 64>;
+using Vec64uc = avec::detail::NeonIntVecStub<uint8_t, 64>;
+using Vec32s = avec::detail::NeonIntVecStub<int16_t, 32>;
+using Vec32us = avec::detail::NeonIntVecStub<uint16_t, 32>;
+using Vec16i = avec::detail::NeonIntVecStub<int32_t, 16>;
+using Vec16ui = avec::detail::NeonIntVecStub<uint32_t, 16>;
+using Vec8q = avec::detail::NeonIntVecStub<int64_t, 8>;
+using Vec8uq = avec::detail::NeonIntVecStub<uint64_t, 8>;
+
+using Vec32cb = Vec32c;
+using Vec16sb = Vec16s;
+using Vec8ib = Vec8i;
+using Vec4qb = Vec4q;
+
+using Vec64cb = Vec64c;
+using Vec32sb = Vec32s;
+using Vec16ib = Vec16i;
+using Vec8qb = Vec8q;
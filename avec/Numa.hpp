@@ -0,0 +1,232 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "avec/InterleavedBuffer.hpp"
+
+#if defined(__linux__)
+#include <cstdio>
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define AVEC_NUMA 1
+#else
+#define AVEC_NUMA 0
+#endif
+
+/*
+ * NUMA placement of buffers, implemented with the mbind and getcpu system calls
+ * on Linux, so that it does not depend on libnuma. On other platforms the
+ * functions in this file do nothing.
+ *
+ * Linux places each page on the NUMA node of the thread that first touches it.
+ * There are two ways to make the memory of a buffer local to the threads that
+ * process it:
+ * - bind it to a node with bindToNumaNode, which also migrates the pages that
+ *   have already been touched;
+ * - use FirstTouchAllocator, which does not touch the memory when a container
+ *   is constructed or resized, and let each worker thread initialize the
+ *   VecBuffers it owns, for example calling VecBuffer::fill.
+ */
+
+namespace avec {
+
+/**
+ * @return the number of NUMA nodes of the system, 1 if it is not a NUMA system
+ * or if it can not be queried.
+ */
+inline int
+getNumNumaNodes()
+{
+#if AVEC_NUMA
+  std::FILE* file = std::fopen("/sys/devices/system/node/online", "r");
+  if (!file) {
+    return 1;
+  }
+  // the format is a list of ranges, like 0-1,3
+  int numNodes = 1;
+  int first = 0, last = 0;
+  char separator = 0;
+  while (std::fscanf(file, "%d", &first) == 1) {
+    last = first;
+    if (std::fscanf(file, "%c", &separator) == 1 && separator == '-') {
+      if (std::fscanf(file, "%d", &last) != 1) {
+        break;
+      }
+      (void)std::fscanf(file, "%c", &separator);
+    }
+    numNodes = std::max(numNodes, last + 1);
+  }
+  std::fclose(file);
+  return numNodes;
+#else
+  return 1;
+#endif
+}
+
+/**
+ * @return the NUMA node of the cpu running the calling thread, 0 if it can not
+ * be queried.
+ */
+inline int
+getCurrentNumaNode()
+{
+#if AVEC_NUMA
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    return 0;
+  }
+  return (int)node;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Binds a piece of memory to a NUMA node, moving any page of it that is
+ * already on an other node. The binding is applied to all the pages that
+ * overlap with the memory, so it also affects any other data sharing them.
+ * @param ptr pointer to the memory to bind.
+ * @param numBytes the size of the memory to bind.
+ * @param node the NUMA node to bind the memory to.
+ * @return true on success, false on failure or if NUMA is not supported.
+ */
+inline bool
+bindToNumaNode(void const* ptr, std::size_t numBytes, int node)
+{
+#if AVEC_NUMA
+  if (!ptr || numBytes == 0 || node < 0 ||
+      node >= (int)(sizeof(unsigned long) * CHAR_BIT)) {
+    return false;
+  }
+  auto const pageSize = (std::uintptr_t)sysconf(_SC_PAGESIZE);
+  auto const address = reinterpret_cast<std::uintptr_t>(ptr);
+  auto const begin = address & ~(pageSize - 1);
+  auto const end = (address + numBytes + pageSize - 1) & ~(pageSize - 1);
+  unsigned long nodeMask = 1ul << node;
+  return syscall(SYS_mbind,
+                 begin,
+                 end - begin,
+                 MPOL_BIND,
+                 &nodeMask,
+                 sizeof(nodeMask) * CHAR_BIT,
+                 MPOL_MF_MOVE) == 0;
+#else
+  (void)ptr;
+  (void)numBytes;
+  (void)node;
+  return false;
+#endif
+}
+
+/**
+ * Binds the memory allocated by a VecBuffer to a NUMA node, see
+ * bindToNumaNode(void const*, std::size_t, int).
+ * @param buffer the VecBuffer to bind.
+ * @param node the NUMA node to bind the memory to.
+ * @return true on success, false on failure or if NUMA is not supported.
+ */
+template<class Vec, std::size_t Alignment, class Allocator>
+inline bool
+bindToNumaNode(VecBuffer<Vec, Alignment, Allocator> const& buffer, int node)
+{
+  using Float = typename ScalarTypes<Vec>::Float;
+  if (buffer.getScalarCapacity() == 0) {
+    return false;
+  }
+  return bindToNumaNode(
+    &buffer(0), buffer.getScalarCapacity() * sizeof(Float), node);
+}
+
+/**
+ * Binds the memory of all the VecBuffers of an InterleavedBuffer to a NUMA
+ * node. To spread the channel groups of an InterleavedBuffer across nodes,
+ * bind each VecBuffer, obtained with getBuffer16, getBuffer8, getBuffer4 and
+ * getBuffer2, separately.
+ * @param buffer the InterleavedBuffer to bind.
+ * @param node the NUMA node to bind the memory to.
+ * @return true on success, false on failure or if NUMA is not supported.
+ */
+template<typename Float, std::size_t Alignment, class Allocator>
+inline bool
+bindToNumaNode(InterleavedBuffer<Float, Alignment, Allocator> const& buffer,
+               int node)
+{
+  bool success = true;
+  for (uint32_t i = 0; i < buffer.getNumBuffers16(); ++i) {
+    success = bindToNumaNode(buffer.getBuffer16(i), node) && success;
+  }
+  for (uint32_t i = 0; i < buffer.getNumBuffers8(); ++i) {
+    success = bindToNumaNode(buffer.getBuffer8(i), node) && success;
+  }
+  for (uint32_t i = 0; i < buffer.getNumBuffers4(); ++i) {
+    success = bindToNumaNode(buffer.getBuffer4(i), node) && success;
+  }
+  for (uint32_t i = 0; i < buffer.getNumBuffers2(); ++i) {
+    success = bindToNumaNode(buffer.getBuffer2(i), node) && success;
+  }
+  return success;
+}
+
+/**
+ * Allocator that works as boost::alignment::aligned_allocator, but that
+ * default-initializes the elements, so that resizing a container of scalars
+ * does not touch its memory. The pages of the memory are then placed on the
+ * NUMA node of the thread that first writes to them.
+ * Note that VecBuffer(numSamples, value) and VecBuffer::fill do write to the
+ * memory.
+ * @tparam T type of the elements to allocate.
+ */
+template<class T>
+class FirstTouchAllocator
+  : public boost::alignment::aligned_allocator<T, ALIGNMENT>
+{
+public:
+  template<class U>
+  struct rebind
+  {
+    typedef FirstTouchAllocator<U> other;
+  };
+
+  FirstTouchAllocator() = default;
+
+  template<class U>
+  FirstTouchAllocator(FirstTouchAllocator<U> const&) noexcept
+  {}
+
+  template<class U, class... Args>
+  void construct(U* ptr, Args&&... args)
+  {
+    ::new ((void*)ptr) U(std::forward<Args>(args)...);
+  }
+
+  template<class U>
+  void construct(U* ptr)
+  {
+    ::new ((void*)ptr) U;
+  }
+};
+
+/**
+ * An InterleavedBuffer that does not touch its memory when it is constructed or
+ * resized, see FirstTouchAllocator.
+ * @tparam Float float or double
+ */
+template<typename Float>
+using FirstTouchInterleavedBuffer =
+  InterleavedBuffer<Float, ALIGNMENT, FirstTouchAllocator<Float>>;
+
+} // namespace avec
@@ -0,0 +1,680 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "avec/Traits.hpp"
+#include <cstring>
+
+namespace avec {
+
+/**
+ * Storage format for PackedVecBuffer and PackedVecView: IEEE 754 half
+ * precision floating point numbers, stored as uint16_t. The conversions round
+ * to the nearest even value, and use F16C on x86 and the NEON half precision
+ * conversions on ARM, when available.
+ */
+struct Half final
+{
+  /**
+   * The type used to store each value.
+   */
+  using Storage = uint16_t;
+
+  /**
+   * Converts a single precision value to half precision, rounding to the
+   * nearest even value. Values too large for half precision become infinity.
+   * NaNs keep the high bits of their payload and become quiet, as with F16C.
+   * @param value the value to convert.
+   * @return the half precision value.
+   */
+  static uint16_t fromFloat(float value)
+  {
+    constexpr uint32_t infinity = 255u << 23;
+    constexpr uint32_t halfOverflow = (127u + 16u) << 23;
+    constexpr uint32_t subnormalMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    uint32_t const sign = x & 0x80000000u;
+    x ^= sign;
+    uint32_t half;
+    if (x >= halfOverflow) {
+      // infinity or NaN
+      half = x > infinity ? 0x7E00u | ((x >> 13) & 0x3FFu) : 0x7C00u;
+    }
+    else if (x < (113u << 23)) {
+      // subnormal or zero: let the floating point addition do the rounding
+      float f, magic;
+      std::memcpy(&f, &x, sizeof(f));
+      std::memcpy(&magic, &subnormalMagic, sizeof(magic));
+      f += magic;
+      std::memcpy(&half, &f, sizeof(half));
+      half -= subnormalMagic;
+    }
+    else {
+      uint32_t const isMantissaOdd = (x >> 13) & 1u;
+      x += ((15u - 127u) << 23) + 0xFFFu + isMantissaOdd;
+      half = x >> 13;
+    }
+    return (uint16_t)(half | (sign >> 16));
+  }
+
+  /**
+   * Converts a half precision value to single precision, exactly. NaNs keep
+   * their payload and become quiet, as with F16C.
+   * @param half the value to convert.
+   * @return the single precision value.
+   */
+  static float toFloat(uint16_t half)
+  {
+    constexpr uint32_t exponentMask = 0x7C00u << 13;
+    constexpr uint32_t subnormalMagic = 113u << 23;
+    uint32_t x = (half & 0x7FFFu) << 13;
+    uint32_t const exponent = x & exponentMask;
+    x += (127u - 15u) << 23;
+    if (exponent == exponentMask) {
+      // infinity or NaN
+      x += (128u - 16u) << 23;
+      if (x & 0x7FFFFFu) {
+        x |= 0x400000u;
+      }
+    }
+    else if (exponent == 0) {
+      // subnormal or zero: renormalize with a floating point subtraction
+      x += 1u << 23;
+      float f, magic;
+      std::memcpy(&f, &x, sizeof(f));
+      std::memcpy(&magic, &subnormalMagic, sizeof(magic));
+      f -= magic;
+      std::memcpy(&x, &f, sizeof(x));
+    }
+    x |= (uint32_t)(half & 0x8000u) << 16;
+    float value;
+    std::memcpy(&value, &x, sizeof(value));
+    return value;
+  }
+
+  /**
+   * Loads size<Vec>() half precision values and widens them.
+   * @tparam Vec Vec4f, Vec8f or Vec16f.
+   * @param input the values to load.
+   * @return the values as single precision simd vector.
+   */
+  template<class Vec>
+  static Vec load(uint16_t const* input)
+  {
+#if AVEC_F16C
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      return _mm_cvtph_ps(
+        _mm_loadl_epi64(reinterpret_cast<__m128i const*>(input)));
+    }
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      return _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(input)));
+    }
+#if AVEC_AVX512
+    if constexpr (std::is_same<Vec, Vec16f>::value) {
+      // the maskz variants avoid a spurious -Wmaybe-uninitialized in GCC
+      return _mm512_maskz_cvtph_ps(
+        0xFFFF, _mm256_loadu_si256(reinterpret_cast<__m256i const*>(input)));
+    }
+#endif
+#elif AVEC_NEON_FP16
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(input)));
+    }
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      return Vec8f(load<Vec4f>(input), load<Vec4f>(input + 4));
+    }
+#endif
+    float values[size<Vec>()];
+    for (uint32_t i = 0; i < size<Vec>(); ++i) {
+      values[i] = toFloat(input[i]);
+    }
+    Vec v;
+    v.load(values);
+    return v;
+  }
+
+  /**
+   * Narrows a single precision simd vector to half precision and stores it.
+   * @tparam Vec Vec4f, Vec8f or Vec16f.
+   * @param v the values to store.
+   * @param output the memory to store them to.
+   */
+  template<class Vec>
+  static void store(Vec const& v, uint16_t* output)
+  {
+#if AVEC_F16C
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(output),
+                       _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+      return;
+    }
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                       _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+      return;
+    }
+#if AVEC_AVX512
+    if constexpr (std::is_same<Vec, Vec16f>::value) {
+      _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(output),
+        _mm512_maskz_cvtps_ph(0xFFFF, v, _MM_FROUND_TO_NEAREST_INT));
+      return;
+    }
+#endif
+#elif AVEC_NEON_FP16
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      vst1_u16(output, vreinterpret_u16_f16(vcvt_f16_f32(v)));
+      return;
+    }
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      store(v.get_low(), output);
+      store(v.get_high(), output + 4);
+      return;
+    }
+#endif
+    float values[size<Vec>()];
+    v.store(values);
+    for (uint32_t i = 0; i < size<Vec>(); ++i) {
+      output[i] = fromFloat(values[i]);
+    }
+  }
+};
+
+namespace detail {
+
+#if AVEC_X86
+
+/**
+ * Narrows 4 single precision values to bfloat16, rounding to the nearest even
+ * value, and keeping NaNs quiet. The results are in the low 16 bits of each
+ * 32 bit lane, sign extended so that they can be packed with _mm_packs_epi32.
+ */
+inline __m128i
+floatToBFloat16Lanes(__m128 v)
+{
+  __m128i const x = _mm_castps_si128(v);
+  __m128i const rounding =
+    _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(x, 16), _mm_set1_epi32(1)),
+                  _mm_set1_epi32(0x7FFF));
+  __m128i const rounded = _mm_srli_epi32(_mm_add_epi32(x, rounding), 16);
+  __m128i const quiet =
+    _mm_srli_epi32(_mm_or_si128(x, _mm_set1_epi32(0x400000)), 16);
+  __m128i const isNan = _mm_castps_si128(_mm_cmpunord_ps(v, v));
+  __m128i const result = _mm_or_si128(_mm_and_si128(isNan, quiet),
+                                      _mm_andnot_si128(isNan, rounded));
+  return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+}
+
+#endif
+
+} // namespace detail
+
+/**
+ * Storage format for PackedVecBuffer and PackedVecView: bfloat16, the upper 16
+ * bits of a single precision value, stored as uint16_t. It has the range of
+ * single precision and 8 bits of precision, which is enough for analysis data
+ * like spectrograms and features. Widening is exact and is done with integer
+ * shifts. Narrowing rounds to the nearest even value, using AVX-512 BF16 when
+ * available, which flushes subnormal values to zero, and integer simd
+ * instructions otherwise.
+ */
+struct BFloat16 final
+{
+  /**
+   * The type used to store each value.
+   */
+  using Storage = uint16_t;
+
+  /**
+   * Converts a single precision value to bfloat16, rounding to the nearest
+   * even value.
+   * @param value the value to convert.
+   * @return the bfloat16 value.
+   */
+  static uint16_t fromFloat(float value)
+  {
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    if ((x & 0x7FFFFFFFu) > 0x7F800000u) {
+      // NaN, keep it quiet
+      return (uint16_t)((x | 0x400000u) >> 16);
+    }
+    x += 0x7FFFu + ((x >> 16) & 1u);
+    return (uint16_t)(x >> 16);
+  }
+
+  /**
+   * Converts a bfloat16 value to single precision, exactly.
+   * @param value the value to convert.
+   * @return the single precision value.
+   */
+  static float toFloat(uint16_t value)
+  {
+    uint32_t const x = (uint32_t)value << 16;
+    float result;
+    std::memcpy(&result, &x, sizeof(result));
+    return result;
+  }
+
+  /**
+   * Loads size<Vec>() bfloat16 values and widens them.
+   * @tparam Vec Vec4f, Vec8f or Vec16f.
+   * @param input the values to load.
+   * @return the values as single precision simd vector.
+   */
+  template<class Vec>
+  static Vec load(uint16_t const* input)
+  {
+#if AVEC_X86
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      __m128i const x =
+        _mm_loadl_epi64(reinterpret_cast<__m128i const*>(input));
+      return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), x));
+    }
+#if AVEC_AVX
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      __m128i const x =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(input));
+      __m128 const low =
+        _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), x));
+      __m128 const high =
+        _mm_castsi128_ps(_mm_unpackhi_epi16(_mm_setzero_si128(), x));
+      return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+    }
+    if constexpr (std::is_same<Vec, Vec16f>::value) {
+      return Vec16f(load<Vec8f>(input), load<Vec8f>(input + 8));
+    }
+#endif
+#elif AVEC_NEON
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      return vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(input), 16));
+    }
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      return Vec8f(load<Vec4f>(input), load<Vec4f>(input + 4));
+    }
+#endif
+    float values[size<Vec>()];
+    for (uint32_t i = 0; i < size<Vec>(); ++i) {
+      values[i] = toFloat(input[i]);
+    }
+    Vec v;
+    v.load(values);
+    return v;
+  }
+
+  /**
+   * Narrows a single precision simd vector to bfloat16 and stores it.
+   * @tparam Vec Vec4f, Vec8f or Vec16f.
+   * @param v the values to store.
+   * @param output the memory to store them to.
+   */
+  template<class Vec>
+  static void store(Vec const& v, uint16_t* output)
+  {
+#if AVEC_AVX512BF16
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(output),
+                       (__m128i)_mm_cvtneps_pbh(v));
+      return;
+    }
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                       (__m128i)_mm256_cvtneps_pbh(v));
+      return;
+    }
+    if constexpr (std::is_same<Vec, Vec16f>::value) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(output),
+                          (__m256i)_mm512_cvtneps_pbh(v));
+      return;
+    }
+#elif AVEC_X86
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      __m128i const lanes = detail::floatToBFloat16Lanes(v);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(output),
+                       _mm_packs_epi32(lanes, lanes));
+      return;
+    }
+#if AVEC_AVX
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      __m256 const x = v;
+      __m128i const low =
+        detail::floatToBFloat16Lanes(_mm256_castps256_ps128(x));
+      __m128i const high =
+        detail::floatToBFloat16Lanes(_mm256_extractf128_ps(x, 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                       _mm_packs_epi32(low, high));
+      return;
+    }
+    if constexpr (std::is_same<Vec, Vec16f>::value) {
+      store(v.get_low(), output);
+      store(v.get_high(), output + 8);
+      return;
+    }
+#endif
+#elif AVEC_NEON
+    if constexpr (std::is_same<Vec, Vec4f>::value) {
+      float32x4_t const f = v;
+      uint32x4_t const x = vreinterpretq_u32_f32(f);
+      uint32x4_t const rounding = vaddq_u32(
+        vandq_u32(vshrq_n_u32(x, 16), vdupq_n_u32(1)), vdupq_n_u32(0x7FFF));
+      uint16x4_t const rounded = vshrn_n_u32(vaddq_u32(x, rounding), 16);
+      uint16x4_t const quiet =
+        vshrn_n_u32(vorrq_u32(x, vdupq_n_u32(0x400000)), 16);
+      uint16x4_t const isNan = vmovn_u32(vmvnq_u32(vceqq_f32(f, f)));
+      vst1_u16(output, vbsl_u16(isNan, quiet, rounded));
+      return;
+    }
+    if constexpr (std::is_same<Vec, Vec8f>::value) {
+      store(v.get_low(), output);
+      store(v.get_high(), output + 4);
+      return;
+    }
+#endif
+    float values[size<Vec>()];
+    v.store(values);
+    for (uint32_t i = 0; i < size<Vec>(); ++i) {
+      output[i] = fromFloat(values[i]);
+    }
+  }
+};
+
+/**
+ * A view over a simd sized and aligned piece of memory that stores single
+ * precision values in a narrower Format, such as Half or BFloat16. It is
+ * converted to and from the single precision vector type, widening on load and
+ * narrowing on store.
+ * @tparam Vec the single precision vector type: Vec4f, Vec8f or Vec16f.
+ * @tparam Format the storage format, see Half and BFloat16.
+ */
+template<class Vec, class Format>
+class PackedVecView final
+{
+  static_assert(std::is_same<typename ScalarTypes<Vec>::Float, float>::value,
+                "PackedVecView only works with single precision vectors.");
+
+public:
+  /**
+   * The type used to store each value.
+   */
+  using Storage = typename Format::Storage;
+
+  /**
+   * The alignment required for the viewed memory, in bytes.
+   */
+  static constexpr std::size_t alignment = size<Vec>() * sizeof(Storage);
+
+private:
+  Storage* ptr;
+
+public:
+  /**
+   * Constructor.
+   * @param ptr pointer to the memory to view. It must be aligned to
+   * alignment.
+   */
+  PackedVecView(Storage* ptr)
+    : ptr(ptr)
+  {
+    assert(boost::alignment::is_aligned(ptr, alignment));
+  }
+
+  /**
+   * Narrows and stores a simd vector.
+   * @param v the simd vector object.
+   */
+  PackedVecView& operator=(Vec const& v)
+  {
+    Format::store(v, ptr);
+    return *this;
+  }
+
+  /**
+   * Set all elements of the viewed memory to a value.
+   * @param value the value to set the elements to.
+   */
+  PackedVecView& operator=(float value)
+  {
+    std::fill(ptr, ptr + size<Vec>(), Format::fromFloat(value));
+    return *this;
+  }
+
+  /**
+   * Implicit conversion to a simd vector object.
+   * @returns simd vector object initialized with the viewed memory, widened.
+   */
+  operator Vec() const { return Format::template load<Vec>(ptr); }
+
+  /**
+   * @returns the pointer to the viewed memory.
+   */
+  Storage* getPtr() { return ptr; }
+
+  /**
+   * @returns the pointer to the viewed memory.
+   */
+  Storage const* getPtr() const { return ptr; }
+};
+
+/**
+ * A VecBuffer that stores single precision values in a narrower Format, such
+ * as Half or BFloat16, to halve the memory and the bandwidth used by large
+ * buffers, like delay lines, at the cost of precision. The values are
+ * converted when they are loaded and stored through a PackedVecView.
+ * @tparam Vec the single precision vector type: Vec4f, Vec8f or Vec16f.
+ * @tparam Format the storage format, see Half and BFloat16.
+ * @tparam Alignment the alignment of the memory of the buffer, in bytes.
+ * @tparam Allocator the allocator used for the memory of the buffer.
+ */
+template<class Vec,
+         class Format,
+         std::size_t Alignment = ALIGNMENT,
+         class Allocator =
+           boost::alignment::aligned_allocator<typename Format::Storage,
+                                               Alignment>>
+class PackedVecBuffer final
+{
+public:
+  /**
+   * The type used to store each value.
+   */
+  using Storage = typename Format::Storage;
+
+  /**
+   * The alignment of the memory of the buffer, in bytes.
+   */
+  static constexpr std::size_t alignment = Alignment;
+
+  static_assert(std::is_same<typename Allocator::value_type, Storage>::value,
+                "The Allocator must allocate elements of type Storage");
+
+  static_assert(Alignment >= PackedVecView<Vec, Format>::alignment,
+                "The Alignment must be at least size<Vec>() * sizeof(Storage)");
+
+private:
+  std::vector<Storage, Allocator> data;
+
+public:
+  /**
+   * Constructor
+   * @param numSamples the number of samples to initialize the buffer with
+   * @param value value to initialize the memory to
+   * @param allocator the allocator to use
+   */
+  PackedVecBuffer(uint32_t numSamples = 0,
+                  float value = 0.f,
+                  Allocator const& allocator = Allocator())
+    : data(allocator)
+  {
+    setNumSamples(numSamples);
+    fill(value);
+  }
+
+  /**
+   * @return the size of the buffer measured in number of scalar elements
+   */
+  uint32_t getScalarSize() const { return (uint32_t)data.size(); }
+
+  /**
+   * @return the size of the buffer measured in number of Vec elements
+   */
+  uint32_t getNumSamples() const
+  {
+    return (uint32_t)data.size() / size<Vec>();
+  }
+
+  /**
+   * @return the capacity of the buffer measured in number of scalar elements
+   */
+  uint32_t getScalarCapacity() const { return (uint32_t)data.capacity(); }
+
+  /**
+   * @return the capacity of the buffer measured in number of Vec elements
+   */
+  uint32_t getVecCapacity() const
+  {
+    return getScalarCapacity() / size<Vec>();
+  }
+
+  /**
+   * Resize the buffer
+   * @param newSize the new size measured in number of scalar elements
+   */
+  void setScalarSize(uint32_t newSize) { data.resize(newSize); }
+
+  /**
+   * Resize the buffer
+   * @param newSize the new size measured in number of Vec elements
+   */
+  void setNumSamples(uint32_t newSize)
+  {
+    setScalarSize(newSize * size<Vec>());
+  }
+
+  /**
+   * Set the capacity of the buffer
+   * @param newCapacity the new capacity measured in number of scalar elements
+   */
+  void reserveScalar(uint32_t newCapacity) { data.reserve(newCapacity); }
+
+  /**
+   * Set the capacity of the buffer
+   * @param newCapacity the new capacity measured in number of Vec elements
+   */
+  void reserveVec(uint32_t newCapacity)
+  {
+    reserveScalar(newCapacity * size<Vec>());
+  }
+
+  /**
+   * Fills the buffer with the supplied value
+   * @param value value to set all the elements of the buffer to.
+   */
+  void fill(float value = 0.f)
+  {
+    std::fill(data.begin(), data.end(), Format::fromFloat(value));
+  }
+
+  /**
+   * @return the i-th scalar element of the buffer, widened.
+   */
+  float get(uint32_t i) const { return Format::toFloat(data[i]); }
+
+  /**
+   * Sets the i-th scalar element of the buffer.
+   * @param i the index of the element.
+   * @param value the value to narrow and store.
+   */
+  void set(uint32_t i, float value) { data[i] = Format::fromFloat(value); }
+
+  /**
+   * @return a PackedVecView to the memory corresponding to the i-th vector
+   * elements of the buffer.
+   */
+  PackedVecView<Vec, Format> operator[](uint32_t i)
+  {
+    assert(i < data.size() / size<Vec>());
+    return PackedVecView<Vec, Format>(&data[i * size<Vec>()]);
+  }
+
+  /**
+   * @return a PackedVecView to the memory corresponding to the i-th vector
+   * elements of the buffer.
+   */
+  PackedVecView<Vec, Format> const operator[](uint32_t i) const
+  {
+    assert(i < data.size() / size<Vec>());
+    return PackedVecView<Vec, Format>(
+      const_cast<Storage*>(&data[i * size<Vec>()]));
+  }
+
+  /**
+   * @return a pointer to the buffer's memory, aligned to Alignment.
+   */
+  Storage* getData()
+  {
+    Storage* ptr = data.data();
+    BOOST_ALIGN_ASSUME_ALIGNED(ptr, Alignment);
+    return ptr;
+  }
+
+  /**
+   * @return a pointer to the buffer's memory, aligned to Alignment.
+   */
+  Storage const* getData() const
+  {
+    Storage const* ptr = data.data();
+    BOOST_ALIGN_ASSUME_ALIGNED(ptr, Alignment);
+    return ptr;
+  }
+};
+
+template<class Vec, class Format, std::size_t Alignment, class Allocator>
+struct AlignmentOf<PackedVecBuffer<Vec, Format, Alignment, Allocator>>
+{
+  static constexpr std::size_t value = Alignment;
+};
+
+/**
+ * A VecBuffer that stores half precision values, see PackedVecBuffer.
+ * @tparam Vec the single precision vector type: Vec4f, Vec8f or Vec16f.
+ */
+template<class Vec, std::size_t Alignment = ALIGNMENT>
+using HalfVecBuffer = PackedVecBuffer<Vec, Half, Alignment>;
+
+/**
+ * A VecView over half precision values, see PackedVecView.
+ * @tparam Vec the single precision vector type: Vec4f, Vec8f or Vec16f.
+ */
+template<class Vec>
+using HalfVecView = PackedVecView<Vec, Half>;
+
+/**
+ * A VecBuffer that stores bfloat16 values, see PackedVecBuffer.
+ * @tparam Vec the single precision vector type: Vec4f, Vec8f or Vec16f.
+ */
+template<class Vec, std::size_t Alignment = ALIGNMENT>
+using BFloat16VecBuffer = PackedVecBuffer<Vec, BFloat16, Alignment>;
+
+/**
+ * A VecView over bfloat16 values, see PackedVecView.
+ * @tparam Vec the single precision vector type: Vec4f, Vec8f or Vec16f.
+ */
+template<class Vec>
+using BFloat16VecView = PackedVecView<Vec, BFloat16>;
+
+} // namespace avec
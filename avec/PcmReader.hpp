@@ -0,0 +1,399 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "avec/BufferFile.hpp"
+
+namespace avec {
+
+/**
+ * Sample formats of frame interleaved PCM files, in little endian byte order.
+ */
+enum class PcmFormat
+{
+  int16,
+  int24,
+  int32,
+  float32,
+  float64
+};
+
+/**
+ * @return the size of a sample in a PcmFormat, in bytes.
+ */
+constexpr uint32_t
+getPcmSampleSize(PcmFormat format)
+{
+  switch (format) {
+    case PcmFormat::int16:
+      return 2;
+    case PcmFormat::int24:
+      return 3;
+    case PcmFormat::int32:
+    case PcmFormat::float32:
+      return 4;
+    case PcmFormat::float64:
+      return 8;
+  }
+  return 0;
+}
+
+/**
+ * Reads a WAV or raw PCM file block by block, converting its frame interleaved
+ * samples directly into the VecBuffers of an InterleavedBuffer, without going
+ * through a Buffer. The file is memory mapped, and on each read the kernel is
+ * asked to prefetch the next block with madvise(MADV_WILLNEED), so that the
+ * I/O of the next block overlaps with the conversion of the current one.
+ * On platforms without mmap the whole file is read into memory when opened.
+ * Only little endian platforms are supported.
+ * @tparam Float float or double
+ */
+template<typename Float>
+class PcmReader final
+{
+  MappedFile file;
+  unsigned char const* samples = nullptr;
+  uint64_t numFrames = 0;
+  uint64_t position = 0;
+  uint32_t numChannels = 0;
+  uint32_t frameSize = 0;
+  PcmFormat format = PcmFormat::float32;
+
+  template<PcmFormat Format>
+  static Float convertSample(unsigned char const* in)
+  {
+    if constexpr (Format == PcmFormat::int16) {
+      int16_t x;
+      std::memcpy(&x, in, 2);
+      return (Float)x * (Float)(1.0 / 32768.0);
+    }
+    else if constexpr (Format == PcmFormat::int24) {
+      int32_t const x =
+        (int32_t)((uint32_t)in[0] << 8 | (uint32_t)in[1] << 16 |
+                  (uint32_t)in[2] << 24) >>
+        8;
+      return (Float)x * (Float)(1.0 / 8388608.0);
+    }
+    else if constexpr (Format == PcmFormat::int32) {
+      int32_t x;
+      std::memcpy(&x, in, 4);
+      return (Float)((double)x * (1.0 / 2147483648.0));
+    }
+    else if constexpr (Format == PcmFormat::float32) {
+      float x;
+      std::memcpy(&x, in, 4);
+      return (Float)x;
+    }
+    else {
+      double x;
+      std::memcpy(&x, in, 8);
+      return (Float)x;
+    }
+  }
+
+  template<PcmFormat Format, class GroupBuffer>
+  void convertGroup(GroupBuffer& buffer,
+                    uint32_t width,
+                    uint32_t& firstChannel,
+                    unsigned char const* input,
+                    uint32_t numFramesToRead) const;
+
+  template<PcmFormat Format, std::size_t Alignment, class Allocator>
+  void convertFrames(InterleavedBuffer<Float, Alignment, Allocator>& output,
+                     unsigned char const* input,
+                     uint32_t numFramesToRead) const;
+
+  void prefetch(uint64_t firstFrame, uint64_t numFramesToPrefetch) const
+  {
+#if AVEC_MMAP && defined(MADV_WILLNEED)
+    if (firstFrame >= numFrames) {
+      return;
+    }
+    numFramesToPrefetch = std::min(numFramesToPrefetch, numFrames - firstFrame);
+    auto const pageSize = (std::uintptr_t)sysconf(_SC_PAGESIZE);
+    auto const begin =
+      reinterpret_cast<std::uintptr_t>(samples + firstFrame * frameSize);
+    auto const end = begin + numFramesToPrefetch * frameSize;
+    auto const alignedBegin = begin & ~(pageSize - 1);
+    madvise(reinterpret_cast<void*>(alignedBegin),
+            end - alignedBegin,
+            MADV_WILLNEED);
+#else
+    (void)firstFrame;
+    (void)numFramesToPrefetch;
+#endif
+  }
+
+  bool setup(std::size_t dataOffset, std::size_t dataSize)
+  {
+    if (numChannels == 0 || dataOffset > file.getSize()) {
+      close();
+      return false;
+    }
+    frameSize = numChannels * getPcmSampleSize(format);
+    dataSize = std::min(dataSize, file.getSize() - dataOffset);
+    samples = static_cast<unsigned char const*>(file.getData()) + dataOffset;
+    numFrames = dataSize / frameSize;
+    position = 0;
+#if AVEC_MMAP && defined(MADV_SEQUENTIAL)
+    madvise(file.getData(), file.getSize(), MADV_SEQUENTIAL);
+#endif
+    return true;
+  }
+
+public:
+  /**
+   * Opens a raw PCM file.
+   * @param path the path of the file.
+   * @param numChannels_ the number of channels of the file.
+   * @param format_ the format of the samples.
+   * @param dataOffset the position of the first sample in the file, in bytes.
+   * @return true on success, false if the file could not be opened.
+   */
+  bool openRaw(char const* path,
+               uint32_t numChannels_,
+               PcmFormat format_,
+               std::size_t dataOffset = 0)
+  {
+    close();
+    if (!file.open(path)) {
+      return false;
+    }
+    numChannels = numChannels_;
+    format = format_;
+    return setup(dataOffset, file.getSize());
+  }
+
+  /**
+   * Opens a WAV file, with integer samples of 16, 24 or 32 bits, or floating
+   * point samples of 32 or 64 bits.
+   * @param path the path of the file.
+   * @return true on success, false if the file could not be opened or if its
+   * format is not supported.
+   */
+  bool openWav(char const* path);
+
+  /**
+   * Closes the file.
+   */
+  void close()
+  {
+    file.close();
+    samples = nullptr;
+    numFrames = position = 0;
+    numChannels = frameSize = 0;
+  }
+
+  /**
+   * Reads the next block of frames into an InterleavedBuffer. The number of
+   * frames read is the number of samples of the output, or the number of
+   * frames left in the file if smaller. The samples of the output after the
+   * ones read, and the unused lanes of its VecBuffers, are set to zero.
+   * @param output the InterleavedBuffer to read into. It must have as many
+   * channels as the file.
+   * @return the number of frames read, 0 at the end of the file or if the
+   * number of channels of the output is wrong.
+   */
+  template<std::size_t Alignment, class Allocator>
+  uint32_t read(InterleavedBuffer<Float, Alignment, Allocator>& output);
+
+  /**
+   * Moves the read position.
+   * @param frame the frame to read next.
+   */
+  void seek(uint64_t frame) { position = std::min(frame, numFrames); }
+
+  /**
+   * @return the number of channels of the file.
+   */
+  uint32_t getNumChannels() const { return numChannels; }
+
+  /**
+   * @return the number of frames of the file.
+   */
+  uint64_t getNumFrames() const { return numFrames; }
+
+  /**
+   * @return the next frame to be read.
+   */
+  uint64_t getPosition() const { return position; }
+
+  /**
+   * @return the format of the samples of the file.
+   */
+  PcmFormat getFormat() const { return format; }
+};
+
+// implementation
+
+template<typename Float>
+inline bool
+PcmReader<Float>::openWav(char const* path)
+{
+  close();
+  if (!file.open(path) || file.getSize() < 12) {
+    close();
+    return false;
+  }
+  auto const* data = static_cast<unsigned char const*>(file.getData());
+  auto const readUint = [&](std::size_t offset, uint32_t numBytes) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < numBytes; ++i) {
+      value |= (uint32_t)data[offset + i] << (8 * i);
+    }
+    return value;
+  };
+  if (std::memcmp(data, "RIFF", 4) != 0 ||
+      std::memcmp(data + 8, "WAVE", 4) != 0) {
+    close();
+    return false;
+  }
+  bool hasFormat = false;
+  std::size_t offset = 12;
+  while (offset + 8 <= file.getSize()) {
+    auto const chunkSize = (std::size_t)readUint(offset + 4, 4);
+    auto const chunkData = offset + 8;
+    if (std::memcmp(data + offset, "fmt ", 4) == 0 && chunkSize >= 16 &&
+        chunkData + chunkSize <= file.getSize()) {
+      auto formatTag = readUint(chunkData, 2);
+      numChannels = readUint(chunkData + 2, 2);
+      auto const bitsPerSample = readUint(chunkData + 14, 2);
+      // WAVE_FORMAT_EXTENSIBLE stores the format in its sub format guid
+      if (formatTag == 0xFFFE && chunkSize >= 40) {
+        formatTag = readUint(chunkData + 24, 2);
+      }
+      if (formatTag == 1 && bitsPerSample == 16) {
+        format = PcmFormat::int16;
+      }
+      else if (formatTag == 1 && bitsPerSample == 24) {
+        format = PcmFormat::int24;
+      }
+      else if (formatTag == 1 && bitsPerSample == 32) {
+        format = PcmFormat::int32;
+      }
+      else if (formatTag == 3 && bitsPerSample == 32) {
+        format = PcmFormat::float32;
+      }
+      else if (formatTag == 3 && bitsPerSample == 64) {
+        format = PcmFormat::float64;
+      }
+      else {
+        break;
+      }
+      hasFormat = true;
+    }
+    else if (std::memcmp(data + offset, "data", 4) == 0) {
+      if (!hasFormat) {
+        break;
+      }
+      return setup(chunkData, chunkSize);
+    }
+    // chunks are padded to an even size
+    offset = chunkData + chunkSize + (chunkSize & 1);
+  }
+  close();
+  return false;
+}
+
+template<typename Float>
+template<PcmFormat Format, class GroupBuffer>
+inline void
+PcmReader<Float>::convertGroup(GroupBuffer& buffer,
+                               uint32_t width,
+                               uint32_t& firstChannel,
+                               unsigned char const* input,
+                               uint32_t numFramesToRead) const
+{
+  constexpr uint32_t sampleSize = getPcmSampleSize(Format);
+  auto const numLanes = std::min(width, numChannels - firstChannel);
+  Float* const out = buffer;
+  unsigned char const* in = input + firstChannel * sampleSize;
+  for (uint32_t j = 0; j < numFramesToRead; ++j) {
+    for (uint32_t i = 0; i < numLanes; ++i) {
+      out[j * width + i] = convertSample<Format>(in + i * sampleSize);
+    }
+    for (uint32_t i = numLanes; i < width; ++i) {
+      out[j * width + i] = 0.f;
+    }
+    in += frameSize;
+  }
+  std::fill(
+    out + numFramesToRead * width, out + buffer.getScalarSize(), (Float)0.f);
+  firstChannel += numLanes;
+}
+
+template<typename Float>
+template<PcmFormat Format, std::size_t Alignment, class Allocator>
+inline void
+PcmReader<Float>::convertFrames(
+  InterleavedBuffer<Float, Alignment, Allocator>& output,
+  unsigned char const* input,
+  uint32_t numFramesToRead) const
+{
+  // same order as the channels of InterleavedBuffer: groups of 2, 4, 8, 16
+  uint32_t firstChannel = 0;
+  for (uint32_t b = 0; b < output.getNumBuffers2(); ++b) {
+    convertGroup<Format>(
+      output.getBuffer2(b), 2, firstChannel, input, numFramesToRead);
+  }
+  for (uint32_t b = 0; b < output.getNumBuffers4(); ++b) {
+    convertGroup<Format>(
+      output.getBuffer4(b), 4, firstChannel, input, numFramesToRead);
+  }
+  for (uint32_t b = 0; b < output.getNumBuffers8(); ++b) {
+    convertGroup<Format>(
+      output.getBuffer8(b), 8, firstChannel, input, numFramesToRead);
+  }
+  for (uint32_t b = 0; b < output.getNumBuffers16(); ++b) {
+    convertGroup<Format>(
+      output.getBuffer16(b), 16, firstChannel, input, numFramesToRead);
+  }
+}
+
+template<typename Float>
+template<std::size_t Alignment, class Allocator>
+inline uint32_t
+PcmReader<Float>::read(InterleavedBuffer<Float, Alignment, Allocator>& output)
+{
+  if (output.getNumChannels() != numChannels || position >= numFrames) {
+    return 0;
+  }
+  auto const numFramesToRead =
+    (uint32_t)std::min((uint64_t)output.getNumSamples(), numFrames - position);
+  prefetch(position + numFramesToRead, numFramesToRead);
+  auto const* input = samples + position * frameSize;
+  switch (format) {
+    case PcmFormat::int16:
+      convertFrames<PcmFormat::int16>(output, input, numFramesToRead);
+      break;
+    case PcmFormat::int24:
+      convertFrames<PcmFormat::int24>(output, input, numFramesToRead);
+      break;
+    case PcmFormat::int32:
+      convertFrames<PcmFormat::int32>(output, input, numFramesToRead);
+      break;
+    case PcmFormat::float32:
+      convertFrames<PcmFormat::float32>(output, input, numFramesToRead);
+      break;
+    case PcmFormat::float64:
+      convertFrames<PcmFormat::float64>(output, input, numFramesToRead);
+      break;
+  }
+  position += numFramesToRead;
+  return numFramesToRead;
+}
+
+} // namespace avec
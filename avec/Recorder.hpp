@@ -0,0 +1,396 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "avec/InterleavedBuffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace avec {
+
+/**
+ * Records the blocks of an InterleavedBuffer to a WAV file, with floating
+ * point samples, without blocking the thread that produces them.
+ * The blocks are copied by push into a wait-free single producer single
+ * consumer queue of preallocated InterleavedBuffers. A background thread
+ * converts them to frame interleaved samples and writes them to the file in
+ * chunks of about WRITE_SIZE bytes: a chunk is written when the next block
+ * would not fit in it, and when the recorder stops, not whenever the queue is
+ * empty, so that the writes stay large. When the queue is full, push drops the
+ * block and counts it. Files with more than 2 channels use
+ * WAVE_FORMAT_EXTENSIBLE. The header of the WAV file is written in the native
+ * byte order, so only little endian platforms are supported.
+ * @tparam Float float or double
+ */
+template<typename Float>
+class Recorder final
+{
+public:
+  /**
+   * The size of the chunks written to the file, in bytes.
+   */
+  static constexpr std::size_t WRITE_SIZE = 1 << 20;
+
+private:
+  std::vector<InterleavedBuffer<Float>> blocks;
+  std::vector<uint32_t> blockSizes;
+  std::vector<Float> frames;
+  std::FILE* file = nullptr;
+  std::thread thread;
+  uint64_t numWrittenFrames = 0;
+  uint32_t numChannels = 0;
+  uint32_t sampleRate = 0;
+
+  // written only by the producer
+  alignas(64) std::atomic<uint32_t> writeIndex{ 0 };
+  std::atomic<uint32_t> highWaterMark{ 0 };
+  std::atomic<uint32_t> numDroppedBlocks{ 0 };
+  std::atomic<uint32_t> numPushing{ 0 };
+  // written only by the consumer
+  alignas(64) std::atomic<uint32_t> readIndex{ 0 };
+  std::atomic<uint32_t> numWrittenBlocks{ 0 };
+  std::atomic<uint32_t> numWrittenChunks{ 0 };
+  std::atomic<bool> writeError{ false };
+  // written only by the owner
+  alignas(64) std::atomic<bool> isRunning{ false };
+  // set by stop once no push can queue a block anymore
+  std::atomic<bool> isDraining{ false };
+
+  template<std::size_t Alignment, class Allocator>
+  bool enqueue(InterleavedBuffer<Float, Alignment, Allocator> const& block,
+               uint32_t numSamples);
+  void run();
+  bool flush(std::size_t numFrames);
+  bool writeHeader();
+
+public:
+  Recorder() = default;
+  Recorder(Recorder const&) = delete;
+  Recorder& operator=(Recorder const&) = delete;
+
+  ~Recorder() { stop(); }
+
+  /**
+   * Creates the file and starts the background thread. Allocates all the
+   * memory used by the recorder.
+   * @param path the path of the WAV file to write.
+   * @param numChannels_ the number of channels of the blocks to record.
+   * @param maxBlockSize the maximum number of samples of the blocks to record.
+   * @param numBlocks the number of blocks that the queue can hold.
+   * @param sampleRate_ the sample rate stored in the WAV file.
+   * @return true on success, false if the file could not be created or if the
+   * recorder is already running.
+   */
+  bool start(char const* path,
+             uint32_t numChannels_,
+             uint32_t maxBlockSize,
+             uint32_t numBlocks,
+             uint32_t sampleRate_ = 48000);
+
+  /**
+   * Waits for all the queued blocks to be written, stops the background thread
+   * and closes the file. It can be called while push is running on the
+   * real-time thread: every block for which push returns true is written.
+   * @return true if all the blocks were written successfully.
+   */
+  bool stop();
+
+  /**
+   * Queues a block to be recorded. Wait-free, to be called from a single
+   * real-time thread.
+   * @param block the block to record. It must have the same number of channels
+   * given to start.
+   * @param numSamples the number of samples of the block to record, at most
+   * the maxBlockSize given to start.
+   * @return true if the block was queued, false if the queue was full and the
+   * block was dropped, or if the recorder is not running.
+   */
+  template<std::size_t Alignment, class Allocator>
+  bool push(InterleavedBuffer<Float, Alignment, Allocator> const& block,
+            uint32_t numSamples);
+
+  /**
+   * Queues a block to be recorded, see push(block, numSamples).
+   */
+  template<std::size_t Alignment, class Allocator>
+  bool push(InterleavedBuffer<Float, Alignment, Allocator> const& block)
+  {
+    return push(block, block.getNumSamples());
+  }
+
+  /**
+   * @return the highest number of blocks that have been waiting in the queue
+   * since start was called.
+   */
+  uint32_t getHighWaterMark() const { return highWaterMark.load(); }
+
+  /**
+   * @return the number of blocks dropped because the queue was full.
+   */
+  uint32_t getNumDroppedBlocks() const { return numDroppedBlocks.load(); }
+
+  /**
+   * @return the number of blocks written to the file.
+   */
+  uint32_t getNumWrittenBlocks() const { return numWrittenBlocks.load(); }
+
+  /**
+   * @return the number of chunks of samples written to the file, each with a
+   * single call to fwrite.
+   */
+  uint32_t getNumWrittenChunks() const { return numWrittenChunks.load(); }
+
+  /**
+   * @return true if writing to the file failed.
+   */
+  bool hasWriteError() const { return writeError.load(); }
+};
+
+// implementation
+
+template<typename Float>
+inline bool
+Recorder<Float>::start(char const* path,
+                       uint32_t numChannels_,
+                       uint32_t maxBlockSize,
+                       uint32_t numBlocks,
+                       uint32_t sampleRate_)
+{
+  if (isRunning || numChannels_ == 0 || numBlocks == 0) {
+    return false;
+  }
+  file = std::fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+  numChannels = numChannels_;
+  sampleRate = sampleRate_;
+  numWrittenFrames = 0;
+  blocks.assign(numBlocks,
+                InterleavedBuffer<Float>(numChannels, maxBlockSize));
+  blockSizes.assign(numBlocks, 0);
+  auto const frameSize = numChannels * sizeof(Float);
+  frames.resize(
+    std::max((std::size_t)maxBlockSize, WRITE_SIZE / frameSize) * numChannels);
+  writeIndex = readIndex = 0;
+  highWaterMark = numDroppedBlocks = numWrittenBlocks = numWrittenChunks = 0;
+  writeError = !writeHeader();
+  isDraining = false;
+  isRunning = true;
+  thread = std::thread([this] { run(); });
+  return true;
+}
+
+template<typename Float>
+inline bool
+Recorder<Float>::stop()
+{
+  if (!isRunning) {
+    return false;
+  }
+  isRunning = false;
+  // a push that saw isRunning before it was cleared may still be queuing its
+  // block, the background thread must not stop before it is published
+  while (numPushing.load() != 0) {
+    std::this_thread::yield();
+  }
+  isDraining.store(true, std::memory_order_release);
+  thread.join();
+  // rewrite the header, now that the number of frames is known
+  if (std::fseek(file, 0, SEEK_SET) != 0 || !writeHeader()) {
+    writeError = true;
+  }
+  if (std::fclose(file) != 0) {
+    writeError = true;
+  }
+  file = nullptr;
+  return !writeError;
+}
+
+template<typename Float>
+template<std::size_t Alignment, class Allocator>
+inline bool
+Recorder<Float>::push(
+  InterleavedBuffer<Float, Alignment, Allocator> const& block,
+  uint32_t numSamples)
+{
+  // together with the sequentially consistent store and load in stop, either
+  // this push sees that the recorder is stopping, or stop waits for it
+  numPushing.fetch_add(1);
+  bool const isQueued = isRunning.load() && enqueue(block, numSamples);
+  numPushing.fetch_sub(1, std::memory_order_release);
+  return isQueued;
+}
+
+template<typename Float>
+template<std::size_t Alignment, class Allocator>
+inline bool
+Recorder<Float>::enqueue(
+  InterleavedBuffer<Float, Alignment, Allocator> const& block,
+  uint32_t numSamples)
+{
+  assert(block.getNumChannels() == numChannels);
+  assert(numSamples <= block.getNumSamples());
+  auto const write = writeIndex.load(std::memory_order_relaxed);
+  auto const read = readIndex.load(std::memory_order_acquire);
+  auto const numBlocks = (uint32_t)blocks.size();
+  if (write - read >= numBlocks) {
+    numDroppedBlocks.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  auto& slot = blocks[write % numBlocks];
+  assert(numSamples <= slot.getNumSamples());
+  for (uint32_t i = 0; i < block.getNumBuffers2(); ++i) {
+    Float const* in = block.getBuffer2(i);
+    Float* out = slot.getBuffer2(i);
+    std::copy(in, in + 2 * numSamples, out);
+  }
+  for (uint32_t i = 0; i < block.getNumBuffers4(); ++i) {
+    Float const* in = block.getBuffer4(i);
+    Float* out = slot.getBuffer4(i);
+    std::copy(in, in + 4 * numSamples, out);
+  }
+  for (uint32_t i = 0; i < block.getNumBuffers8(); ++i) {
+    Float const* in = block.getBuffer8(i);
+    Float* out = slot.getBuffer8(i);
+    std::copy(in, in + 8 * numSamples, out);
+  }
+  for (uint32_t i = 0; i < block.getNumBuffers16(); ++i) {
+    Float const* in = block.getBuffer16(i);
+    Float* out = slot.getBuffer16(i);
+    std::copy(in, in + 16 * numSamples, out);
+  }
+  blockSizes[write % numBlocks] = numSamples;
+  writeIndex.store(write + 1, std::memory_order_release);
+  auto const numQueued = write + 1 - read;
+  if (numQueued > highWaterMark.load(std::memory_order_relaxed)) {
+    highWaterMark.store(numQueued, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+template<typename Float>
+inline bool
+Recorder<Float>::flush(std::size_t numFrames)
+{
+  if (numFrames == 0) {
+    return true;
+  }
+  auto const numScalars = numFrames * numChannels;
+  numWrittenFrames += numFrames;
+  numWrittenChunks.fetch_add(1, std::memory_order_relaxed);
+  return std::fwrite(frames.data(), sizeof(Float), numScalars, file) ==
+         numScalars;
+}
+
+template<typename Float>
+inline void
+Recorder<Float>::run()
+{
+  auto const numBlocks = (uint32_t)blocks.size();
+  auto const maxFrames = frames.size() / numChannels;
+  std::size_t numFrames = 0;
+  while (true) {
+    auto const read = readIndex.load(std::memory_order_relaxed);
+    auto const write = writeIndex.load(std::memory_order_acquire);
+    if (read == write) {
+      if (isDraining.load(std::memory_order_acquire)) {
+        // the last blocks may have been pushed after write was loaded
+        if (read == writeIndex.load(std::memory_order_acquire)) {
+          break;
+        }
+        continue;
+      }
+      // the chunk is kept until it is full, writing it now would make the
+      // writes as small as the blocks
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      continue;
+    }
+    auto const blockSize = blockSizes[read % numBlocks];
+    if (numFrames + blockSize > maxFrames) {
+      if (!flush(numFrames)) {
+        writeError = true;
+      }
+      numFrames = 0;
+    }
+    blocks[read % numBlocks].deinterleaveFrames(
+      &frames[numFrames * numChannels], numChannels, blockSize);
+    numFrames += blockSize;
+    readIndex.store(read + 1, std::memory_order_release);
+    numWrittenBlocks.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (!flush(numFrames)) {
+    writeError = true;
+  }
+}
+
+template<typename Float>
+inline bool
+Recorder<Float>::writeHeader()
+{
+  auto const dataSize = numWrittenFrames * numChannels * sizeof(Float);
+  auto const clampSize = [](uint64_t size) {
+    return (uint32_t)std::min(size, (uint64_t)0xFFFFFFFF);
+  };
+  // more than 2 channels need WAVE_FORMAT_EXTENSIBLE, with a channel mask
+  // assigning the channels to the speaker positions in their standard order,
+  // or to no position if there are more channels than positions
+  bool const isExtensible = numChannels > 2;
+  uint32_t const fmtSize = isExtensible ? 40 : 16;
+  uint32_t const riffSize = clampSize(20 + fmtSize + dataSize);
+  // WAVE_FORMAT_EXTENSIBLE or WAVE_FORMAT_IEEE_FLOAT
+  uint16_t const formatTag = isExtensible ? 0xFFFE : 3;
+  auto const channels = (uint16_t)numChannels;
+  uint32_t const byteRate = sampleRate * numChannels * sizeof(Float);
+  auto const blockAlign = (uint16_t)(numChannels * sizeof(Float));
+  auto const bitsPerSample = (uint16_t)(8 * sizeof(Float));
+  uint16_t const extensionSize = 22;
+  uint32_t const channelMask =
+    numChannels <= 18 ? (1u << numChannels) - 1 : 0;
+  // KSDATAFORMAT_SUBTYPE_IEEE_FLOAT
+  static unsigned char const subFormat[16] = { 0x03, 0x00, 0x00, 0x00,
+                                               0x00, 0x00, 0x10, 0x00,
+                                               0x80, 0x00, 0x00, 0xAA,
+                                               0x00, 0x38, 0x9B, 0x71 };
+  uint32_t const dataChunkSize = clampSize(dataSize);
+  bool success = true;
+  auto const write = [&](void const* data, std::size_t size) {
+    success = success && std::fwrite(data, size, 1, file) == 1;
+  };
+  write("RIFF", 4);
+  write(&riffSize, 4);
+  write("WAVEfmt ", 8);
+  write(&fmtSize, 4);
+  write(&formatTag, 2);
+  write(&channels, 2);
+  write(&sampleRate, 4);
+  write(&byteRate, 4);
+  write(&blockAlign, 2);
+  write(&bitsPerSample, 2);
+  if (isExtensible) {
+    write(&extensionSize, 2);
+    write(&bitsPerSample, 2); // valid bits per sample
+    write(&channelMask, 4);
+    write(subFormat, 16);
+  }
+  write("data", 4);
+  write(&dataChunkSize, 4);
+  return success;
+}
+
+} // namespace avec
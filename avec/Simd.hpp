@@ -17,7 +17,38 @@ limitations under the License.
 #pragma once
 #include <cstdint>
 
-#if (defined(__arm__) || defined(__aarch64__) || defined(__arm64__))
+// The vectors are implemented with the vector extensions of GCC and Clang, see
+// GenericVec.hpp, on the targets with neither SSE nor NEON. Define
+// AVEC_GENERIC_VEC to 1 to use them on any target, for example to test and
+// benchmark them on x86.
+#ifndef AVEC_GENERIC_VEC
+#if (defined(__ARM_NEON) || defined(_M_ARM64) || defined(__x86_64__) ||       \
+     defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define AVEC_GENERIC_VEC 0
+#else
+#define AVEC_GENERIC_VEC 1
+#endif
+#endif
+
+#if AVEC_GENERIC_VEC
+
+#include "GenericVec.hpp"
+
+namespace avec {
+
+// The compiler lowers each vector to the registers of the target. 256 bit
+// vectors become pairs of 128 bit registers on most targets, which keeps more
+// floating point operations in flight, so they are treated as native, while
+// 512 bit vectors would use too many registers.
+constexpr bool has128bitSimdRegisters = true;
+constexpr bool has256bitSimdRegisters = true;
+constexpr bool has512bitSimdRegisters = false;
+constexpr bool supportsDoublePrecision = true;
+constexpr bool hasSimd = true;
+
+} // namespace avec
+
+#elif (defined(__arm__) || defined(__aarch64__) || defined(__arm64__))
 
 #define AVEC_ARM 1
 #define AVEC_X86 0
@@ -52,6 +83,13 @@ constexpr bool supportsDoublePrecision = false;
 
 #endif
 
+// conversions between half and single precision, see PackedVecBuffer.hpp
+#if AVEC_NEON && (AVEC_NEON_64 || (defined(__ARM_FP) && (__ARM_FP & 2)))
+#define AVEC_NEON_FP16 1
+#else
+#define AVEC_NEON_FP16 0
+#endif
+
 constexpr bool hasSimd = AVEC_NEON;
 
 } // namespace avec
@@ -68,6 +106,11 @@ constexpr bool hasSimd = AVEC_NEON;
 #include "vectormath_hyp.h"
 #include "vectormath_trig.h"
 
+#ifdef VCL_NAMESPACE
+// vectorclass can be compiled in a namespace, see dispatch/Kernels.cpp
+using namespace VCL_NAMESPACE;
+#endif
+
 namespace avec {
 
 #define AVEC_SSE (INSTRSET >= 1)
@@ -75,6 +118,21 @@ namespace avec {
 #define AVEC_AVX (INSTRSET >= 7)
 #define AVEC_AVX512 (INSTRSET >= 9)
 
+// conversions between half and single precision, see PackedVecBuffer.hpp.
+// MSVC does not define __F16C__, but all the AVX2 processors support it.
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define AVEC_F16C 1
+#else
+#define AVEC_F16C 0
+#endif
+
+// conversions from single precision to bfloat16, see PackedVecBuffer.hpp
+#if defined(__AVX512BF16__) && defined(__AVX512VL__)
+#define AVEC_AVX512BF16 1
+#else
+#define AVEC_AVX512BF16 0
+#endif
+
 constexpr bool has128bitSimdRegisters = AVEC_SSE2;
 constexpr bool supportsDoublePrecision = AVEC_SSE2;
 constexpr bool has256bitSimdRegisters = AVEC_AVX;
@@ -106,6 +164,15 @@ constexpr bool hasSimd = AVEC_SSE;
 #ifndef AVEC_AVX512
 #define AVEC_AVX512 0
 #endif
+#ifndef AVEC_F16C
+#define AVEC_F16C 0
+#endif
+#ifndef AVEC_AVX512BF16
+#define AVEC_AVX512BF16 0
+#endif
+#ifndef AVEC_NEON_FP16
+#define AVEC_NEON_FP16 0
+#endif
 
 namespace avec {
 
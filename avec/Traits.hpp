@@ -16,11 +16,118 @@ limitations under the License.
 
 #pragma once
 
+#include "avec/Alignment.hpp"
 #include "avec/Simd.hpp"
 #include <type_traits>
 
 namespace avec {
 
+/**
+ * Static template class with aliases for the vectorclass type with N elements
+ * of a given scalar type, and for its mask type. It is only defined, by
+ * specialization, for the floating point types Vec4f, Vec8f, Vec16f, Vec2d,
+ * Vec4d and Vec8d, and for the integer types with 128, 256 and 512 bits, for
+ * example Vec<int32_t, 8> is Vec8i and Vec<int16_t, 16> is Vec16s.
+ * @tparam Float the scalar type, float, double or a fixed width integer.
+ * @tparam N the number of elements.
+ */
+template<typename Float, uint32_t N>
+struct VecTypes;
+
+/**
+ * The vectorclass type with N elements of a given Float type, for example
+ * Vec<float, 8> is Vec8f. Code written over N can be instantiated for the
+ * widest width available on each target, see NativeVec.
+ * @tparam Float the scalar type.
+ * @tparam N the number of elements.
+ */
+template<typename Float, uint32_t N>
+using Vec = typename VecTypes<Float, N>::Vec;
+
+/**
+ * Static template class with an alias to deduce the underlying Float type from
+ * a vectorclass type. For integer vectors, Float is the integer type of the
+ * elements, for example int32_t for Vec8i.
+ * @tparam Vec the simd vector type.
+ */
+template<typename Vec>
+class ScalarTypes
+{
+  static_assert(sizeof(Vec) == 0,
+                "Only vectorclass floating point and integer types are "
+                "allowed here.");
+};
+
+/**
+ * Static template class with an alias to deduce the mask type from
+ * vectorclass type.
+ * @tparam Vec the simd vector type.
+ */
+template<typename Vec>
+class MaskTypes
+{
+  static_assert(sizeof(Vec) == 0,
+                "Only vectorclass floating point and integer types are "
+                "allowed here.");
+};
+
+#define AVEC_DEFINE_VEC_TYPES(FloatType, N, VecType, MaskType)                 \
+  template<>                                                                   \
+  struct VecTypes<FloatType, N>                                                \
+  {                                                                            \
+    using Vec = VecType;                                                       \
+    using Mask = MaskType;                                                     \
+  };                                                                           \
+  template<>                                                                   \
+  class ScalarTypes<VecType>                                                   \
+  {                                                                            \
+  public:                                                                      \
+    using Float = FloatType;                                                   \
+  };                                                                           \
+  template<>                                                                   \
+  class MaskTypes<VecType>                                                     \
+  {                                                                            \
+  public:                                                                      \
+    using Mask = MaskType;                                                     \
+  };
+
+AVEC_DEFINE_VEC_TYPES(float, 4, Vec4f, Vec4fb)
+AVEC_DEFINE_VEC_TYPES(float, 8, Vec8f, Vec8fb)
+AVEC_DEFINE_VEC_TYPES(float, 16, Vec16f, Vec16fb)
+AVEC_DEFINE_VEC_TYPES(double, 2, Vec2d, Vec2db)
+AVEC_DEFINE_VEC_TYPES(double, 4, Vec4d, Vec4db)
+AVEC_DEFINE_VEC_TYPES(double, 8, Vec8d, Vec8db)
+
+// integer types, the unsigned ones use the masks of the signed ones, as in
+// vectorclass
+
+AVEC_DEFINE_VEC_TYPES(int8_t, 16, Vec16c, Vec16cb)
+AVEC_DEFINE_VEC_TYPES(int8_t, 32, Vec32c, Vec32cb)
+AVEC_DEFINE_VEC_TYPES(int8_t, 64, Vec64c, Vec64cb)
+AVEC_DEFINE_VEC_TYPES(uint8_t, 16, Vec16uc, Vec16cb)
+AVEC_DEFINE_VEC_TYPES(uint8_t, 32, Vec32uc, Vec32cb)
+AVEC_DEFINE_VEC_TYPES(uint8_t, 64, Vec64uc, Vec64cb)
+AVEC_DEFINE_VEC_TYPES(int16_t, 8, Vec8s, Vec8sb)
+AVEC_DEFINE_VEC_TYPES(int16_t, 16, Vec16s, Vec16sb)
+AVEC_DEFINE_VEC_TYPES(int16_t, 32, Vec32s, Vec32sb)
+AVEC_DEFINE_VEC_TYPES(uint16_t, 8, Vec8us, Vec8sb)
+AVEC_DEFINE_VEC_TYPES(uint16_t, 16, Vec16us, Vec16sb)
+AVEC_DEFINE_VEC_TYPES(uint16_t, 32, Vec32us, Vec32sb)
+AVEC_DEFINE_VEC_TYPES(int32_t, 4, Vec4i, Vec4ib)
+AVEC_DEFINE_VEC_TYPES(int32_t, 8, Vec8i, Vec8ib)
+AVEC_DEFINE_VEC_TYPES(int32_t, 16, Vec16i, Vec16ib)
+AVEC_DEFINE_VEC_TYPES(uint32_t, 4, Vec4ui, Vec4ib)
+AVEC_DEFINE_VEC_TYPES(uint32_t, 8, Vec8ui, Vec8ib)
+AVEC_DEFINE_VEC_TYPES(uint32_t, 16, Vec16ui, Vec16ib)
+AVEC_DEFINE_VEC_TYPES(int64_t, 2, Vec2q, Vec2qb)
+AVEC_DEFINE_VEC_TYPES(int64_t, 4, Vec4q, Vec4qb)
+AVEC_DEFINE_VEC_TYPES(int64_t, 8, Vec8q, Vec8qb)
+AVEC_DEFINE_VEC_TYPES(uint64_t, 2, Vec2uq, Vec2qb)
+AVEC_DEFINE_VEC_TYPES(uint64_t, 4, Vec4uq, Vec4qb)
+AVEC_DEFINE_VEC_TYPES(uint64_t, 8, Vec8uq, Vec8qb)
+
+#undef AVEC_DEFINE_VEC_TYPES
+
 /**
  * Static template class with aliases for the available vectorclass types for a
  * given Float type (float or double).
@@ -32,32 +139,45 @@ struct SimdTypes
   static_assert(std::is_same<Float, float>::value ||
                   std::is_same<Float, double>::value,
                 "Only floating point types are allowed here.");
+  /**
+   * 16 elements vectorclass type. As there is no 16 elements vector of
+   * doubles, it is Vec8d for double.
+   */
+  using Vec16 = typename std::
+    conditional<std::is_same<Float, float>::value, Vec16f, Vec8d>::type;
   /**
    * 8 elements vectorclass type.
    */
-  using Vec8 = typename std::
-    conditional<std::is_same<Float, float>::value, Vec8f, Vec8d>::type;
+  using Vec8 = avec::Vec<Float, 8>;
   /**
    * 4 elements vectorclass type.
    */
-  using Vec4 = typename std::
-    conditional<std::is_same<Float, float>::value, Vec4f, Vec4d>::type;
+  using Vec4 = avec::Vec<Float, 4>;
   /**
-   * 2 elements vectorclass type.
+   * 2 elements vectorclass type. As there is no 2 elements vector of floats,
+   * it is Vec4f for float.
    */
   using Vec2 = typename std::
     conditional<std::is_same<Float, float>::value, Vec4f, Vec2d>::type;
   /**
-   * bool constexpr, true if 8 elements vector are not emulated.
+   * bool constexpr, true if 16 elements vector are not emulated.
    */
-  static constexpr bool VEC8_AVAILABLE = std::is_same<Float, float>::value
-                                           ? has256bitSimdRegisters
-                                           : has512bitSimdRegisters;
+  static constexpr bool VEC16_AVAILABLE =
+    std::is_same<Float, float>::value ? has512bitSimdRegisters : false;
   /**
-   * bool constexpr, true if 4 elements vector are not emulated.
+   * bool constexpr, true if 8 elements vector are not emulated. On NEON, Vec8f
+   * is a pair of registers that the core processes in parallel, so it is
+   * considered native.
+   */
+  static constexpr bool VEC8_AVAILABLE =
+    std::is_same<Float, float>::value ? (has256bitSimdRegisters || AVEC_NEON)
+                                      : has512bitSimdRegisters;
+  /**
+   * bool constexpr, true if 4 elements vector are not emulated. On AArch64,
+   * Vec4d is a pair of registers, like Vec8f.
    */
   static constexpr bool VEC4_AVAILABLE =
-    std::is_same<Float, float>::value ? true : has256bitSimdRegisters;
+    std::is_same<Float, float>::value || has256bitSimdRegisters || AVEC_NEON_64;
   /**
    * bool constexpr, true if 2 elements vector are available.
    */
@@ -66,80 +186,38 @@ struct SimdTypes
 };
 
 /**
- * Static template class with an alias to deduce the underlying Float type from
- * a vectorclass type.
- * @tparam Vec the simd vector type.
+ * Static template class with the widest vectorclass type of a given Float type
+ * that is not emulated on the target the code is compiled for.
+ * @tparam Float the scalar type.
  */
-template<typename Vec>
-class ScalarTypes
+template<typename Float>
+struct NativeVec
 {
-private:
-  using ErrorType = bool; // any type different from float or double is ok
-
-  using Scalar8f = typename std::
-    conditional<std::is_same<Vec, Vec8f>::value, float, ErrorType>::type;
-  using Scalar4f = typename std::
-    conditional<std::is_same<Vec, Vec4f>::value, float, ErrorType>::type;
-  using Scalar8d = typename std::
-    conditional<std::is_same<Vec, Vec8d>::value, double, ErrorType>::type;
-  using Scalar4d = typename std::
-    conditional<std::is_same<Vec, Vec4d>::value, double, ErrorType>::type;
-  using Scalar2d = typename std::
-    conditional<std::is_same<Vec, Vec2d>::value, double, ErrorType>::type;
-
-  using MaybeMaybeDouble = typename std::
-    conditional<std::is_same<Scalar8d, double>::value, double, Scalar4d>::type;
-  using MaybeDouble =
-    typename std::conditional<std::is_same<MaybeMaybeDouble, double>::value,
-                              double,
-                              Scalar2d>::type;
-  using MaybeFloat = typename std::
-    conditional<std::is_same<Scalar8f, float>::value, float, Scalar4f>::type;
-
-public:
   /**
-   * The scalar type deduced from Vec.
+   * The number of elements of the widest non emulated vector.
    */
-  using Float =
-    typename std::conditional<std::is_same<MaybeDouble, double>::value,
-                              double,
-                              MaybeFloat>::type;
-
-  static_assert(std::is_same<Float, float>::value ||
-                  std::is_same<Float, double>::value,
-                "Only Vec8f Vec4f Vec8d Vec4d and Vec2d are allowed here.");
+  static constexpr uint32_t SIZE =
+    SimdTypes<Float>::VEC16_AVAILABLE
+      ? 16
+      : (SimdTypes<Float>::VEC8_AVAILABLE
+           ? 8
+           : (SimdTypes<Float>::VEC4_AVAILABLE ? 4 : 2));
+  /**
+   * The widest non emulated vectorclass type, same as Vec<Float, SIZE>.
+   */
+  using Vec = typename VecTypes<Float, SIZE>::Vec;
 };
 
 /**
- * Static template class with an alias to deduce the mask type from
- * vectorclass type.
+ * Alignment of simd vector types: a VecView<Vec> requires its memory to be
+ * aligned to size<Vec>() * sizeof(Float).
  * @tparam Vec the simd vector type.
  */
 template<typename Vec>
-class MaskTypes
+struct AlignmentOf
 {
-public:
-  /**
-   * The Mask type deduced from Vec.
-   */
-  using Mask = typename std::conditional<
-    std::is_same<Vec, Vec8f>::value,
-    Vec8fb,
-    typename std::conditional<
-      std::is_same<Vec, Vec4f>::value,
-      Vec4fb,
-      typename std::conditional<
-        std::is_same<Vec, Vec8d>::value,
-        Vec8db,
-        typename std::conditional<
-          std::is_same<Vec, Vec4d>::value,
-          Vec4db,
-          typename std::conditional<std::is_same<Vec, Vec2d>::value,
-                                    Vec2db,
-                                    bool>::type>::type>::type>::type>::type;
-
-  static_assert(!std::is_same<Mask, bool>::value,
-                "Only Vec8f Vec4f Vec8d Vec4d and Vec2d are allowed here.");
+  static constexpr std::size_t value =
+    size<Vec>() * sizeof(typename ScalarTypes<Vec>::Float);
 };
 
 } // namespace avec
\ No newline at end of file
@@ -24,8 +24,17 @@ namespace avec {
  * mapped to simd vector objects.
  * @tparam Vec the simd vector object type that the VecBuffer can be mapped
  * with.
+ * @tparam Alignment the alignment of the memory of the buffer, in bytes. It
+ * must be at least size<Vec>() * sizeof(Float).
+ * @tparam Allocator the allocator used for the memory of the buffer. It must
+ * serve memory aligned at least to Alignment, like the default one does.
+ * ArenaAllocator and PoolAllocator serve memory aligned to ALIGNMENT.
  */
-template<class Vec>
+template<class Vec,
+         std::size_t Alignment = ALIGNMENT,
+         class Allocator =
+           boost::alignment::aligned_allocator<typename ScalarTypes<Vec>::Float,
+                                               Alignment>>
 class VecBuffer final
 {
 public:
@@ -34,21 +43,49 @@ public:
    */
   using Float = typename ScalarTypes<Vec>::Float;
 
+  /**
+   * The alignment of the memory of the buffer, in bytes.
+   */
+  static constexpr std::size_t alignment = Alignment;
+
+  static_assert(std::is_same<typename Allocator::value_type, Float>::value,
+                "The Allocator must allocate elements of type Float");
+
+  static_assert(Alignment >= AlignmentOf<Vec>::value,
+                "The Alignment must be at least size<Vec>() * sizeof(Float)");
+
 private:
-  aligned_vector<Float> data;
+  std::vector<Float, Allocator> data;
 
 public:
   /**
    * Constructor
    * @param numSamples the number of samples to initialize the buffer with
    * @param value value to initialize the memory to
+   * @param allocator the allocator to use
    */
-  VecBuffer(uint32_t numSamples = 0, Float value = 0.f)
+  VecBuffer(uint32_t numSamples = 0,
+            Float value = 0.f,
+            Allocator const& allocator = Allocator())
+    : data(allocator)
   {
     setNumSamples(numSamples);
     fill(value);
   }
 
+  /**
+   * Constructor for stateful allocators, like ArenaAllocator and
+   * PoolAllocator.
+   * @param allocator the allocator to use
+   * @param numSamples the number of samples to initialize the buffer with
+   * @param value value to initialize the memory to
+   */
+  explicit VecBuffer(Allocator const& allocator,
+                     uint32_t numSamples = 0,
+                     Float value = 0.f)
+    : VecBuffer(numSamples, value, allocator)
+  {}
+
   /**
    * @return the size of the buffer measured in number of Float elements
    */
@@ -103,7 +140,15 @@ public:
    * Fills the buffer with the supplied value
    * @param value value to set all the elements of the buffer to.
    */
-  void fill(Float value = 0.f) { std::fill(data.begin(), data.end(), value); }
+  void fill(Float value = 0.f)
+  {
+    if (data.empty()) {
+      return;
+    }
+    Float* ptr = data.data();
+    BOOST_ALIGN_ASSUME_ALIGNED(ptr, Alignment);
+    std::fill(ptr, ptr + data.size(), value);
+  }
 
   /**
    * @return a reference to the i-th Float elements of the buffer.
@@ -137,17 +182,51 @@ public:
 
   /**
    * Implicit conversion to Float*
-   * @return a pointer to the buffer's memory.
+   * @return a pointer to the buffer's memory, aligned to Alignment.
    */
-  operator Float*() { return &data[0]; }
+  operator Float*()
+  {
+    Float* ptr = data.data();
+    BOOST_ALIGN_ASSUME_ALIGNED(ptr, Alignment);
+    return ptr;
+  }
 
   /**
    * Implicit conversion to Float*
-   * @return a pointer to the buffer's memory.
+   * @return a pointer to the buffer's memory, aligned to Alignment.
    */
-  operator Float const *() const { return &data[0]; }
+  operator Float const *() const
+  {
+    Float const* ptr = data.data();
+    BOOST_ALIGN_ASSUME_ALIGNED(ptr, Alignment);
+    return ptr;
+  }
+};
+
+template<class Vec, std::size_t Alignment, class Allocator>
+struct AlignmentOf<VecBuffer<Vec, Alignment, Allocator>>
+{
+  static constexpr std::size_t value = Alignment;
 };
 
+/**
+ * A VecBuffer that takes its memory from an AlignedArena.
+ * @tparam Vec the simd vector object type that the VecBuffer can be mapped
+ * with.
+ */
+template<class Vec>
+using ArenaVecBuffer =
+  VecBuffer<Vec, ALIGNMENT, ArenaAllocator<typename ScalarTypes<Vec>::Float>>;
+
+/**
+ * A VecBuffer that takes its memory from an AlignedPool.
+ * @tparam Vec the simd vector object type that the VecBuffer can be mapped
+ * with.
+ */
+template<class Vec>
+using PoolVecBuffer =
+  VecBuffer<Vec, ALIGNMENT, PoolAllocator<typename ScalarTypes<Vec>::Float>>;
+
 // static asserts for paranoid me
 
 static_assert(std::is_nothrow_move_constructible<VecBuffer<Vec8f>>::value,
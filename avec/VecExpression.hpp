@@ -0,0 +1,472 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "avec/VecSpan.hpp"
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace avec {
+
+template<class Function, class... Operands>
+class VecExpression;
+
+namespace detail {
+
+/**
+ * An operand of a VecExpression that loads the vectors of a VecSpan.
+ */
+template<class Vec>
+struct SpanOperand final
+{
+  typename ScalarTypes<Vec>::Float* data;
+  uint32_t numSamples;
+
+  Vec operator[](uint32_t i) const
+  {
+    Vec x;
+    x.load_a(data + i * size<Vec>());
+    return x;
+  }
+
+  uint32_t getNumSamples() const { return numSamples; }
+};
+
+/**
+ * An operand of a VecExpression that is the same for all the vectors, like a
+ * gain.
+ */
+template<class T>
+struct ValueOperand final
+{
+  T value;
+
+  T operator[](uint32_t) const { return value; }
+
+  uint32_t getNumSamples() const { return UINT32_MAX; }
+};
+
+template<class T>
+struct OperandTraits
+{
+  static constexpr bool isExpression = false;
+  static constexpr bool isRange = false;
+  using Vec = void;
+};
+
+template<class Function, class... Operands>
+struct OperandTraits<VecExpression<Function, Operands...>>
+{
+  static constexpr bool isExpression = true;
+  static constexpr bool isRange = true;
+  using Vec = typename VecExpression<Function, Operands...>::Vec;
+};
+
+template<class TVec>
+struct OperandTraits<VecSpan<TVec>>
+{
+  static constexpr bool isExpression = false;
+  static constexpr bool isRange = true;
+  using Vec = TVec;
+};
+
+template<class TVec, std::size_t Alignment, class Allocator>
+struct OperandTraits<VecBuffer<TVec, Alignment, Allocator>>
+{
+  static constexpr bool isExpression = false;
+  static constexpr bool isRange = true;
+  using Vec = TVec;
+};
+
+template<class... T>
+constexpr bool anyExpression =
+  (OperandTraits<std::decay_t<T>>::isExpression || ...);
+
+template<class... T>
+constexpr bool anyRange =
+  (OperandTraits<std::decay_t<T>>::isRange || ...);
+
+/**
+ * The vector type of the first operand that is an expression, a VecSpan or a
+ * VecBuffer.
+ */
+template<class... T>
+struct FirstVec;
+
+template<class T, class... Others>
+struct FirstVec<T, Others...>
+{
+  using Vec =
+    typename std::conditional_t<OperandTraits<std::decay_t<T>>::isRange,
+                                OperandTraits<std::decay_t<T>>,
+                                FirstVec<Others...>>::Vec;
+};
+
+template<>
+struct FirstVec<>
+{
+  using Vec = void;
+};
+
+/**
+ * Makes the operand of a VecExpression: expressions are stored by value,
+ * VecSpans and VecBuffers are viewed, arithmetic values are broadcast to Vec,
+ * anything else, like a vector, is passed to the function as it is.
+ */
+template<class Vec, class T>
+auto
+makeOperand(T const& x)
+{
+  using Traits = OperandTraits<T>;
+  if constexpr (Traits::isExpression) {
+    return x;
+  }
+  else if constexpr (Traits::isRange) {
+    auto const span = VecSpan<typename Traits::Vec>(x);
+    return SpanOperand<typename Traits::Vec>{ span.getData(),
+                                              span.getNumSamples() };
+  }
+  else if constexpr (std::is_arithmetic_v<T>) {
+    using Float = typename ScalarTypes<Vec>::Float;
+    return ValueOperand<Vec>{ Vec(static_cast<Float>(x)) };
+  }
+  else {
+    return ValueOperand<T>{ x };
+  }
+}
+
+template<class Vec, class Function, class... Operands>
+auto
+makeExpression(Function const& function, Operands const&... operands)
+{
+  return VecExpression<Function, decltype(makeOperand<Vec>(operands))...>(
+    function, makeOperand<Vec>(operands)...);
+}
+
+struct IdentityFunction final
+{
+  template<class A>
+  A operator()(A const& a) const
+  {
+    return a;
+  }
+};
+
+#define AVEC_EXPRESSION_FUNCTION_1(Name, function)                             \
+  struct Name##Function final                                                  \
+  {                                                                            \
+    template<class A>                                                          \
+    auto operator()(A const& a) const                                          \
+    {                                                                          \
+      return function(a);                                                      \
+    }                                                                          \
+  };
+
+#define AVEC_EXPRESSION_FUNCTION_2(Name, function)                             \
+  struct Name##Function final                                                  \
+  {                                                                            \
+    template<class A, class B>                                                 \
+    auto operator()(A const& a, B const& b) const                              \
+    {                                                                          \
+      return function(a, b);                                                   \
+    }                                                                          \
+  };
+
+#define AVEC_EXPRESSION_FUNCTION_3(Name, function)                             \
+  struct Name##Function final                                                  \
+  {                                                                            \
+    template<class A, class B, class C>                                        \
+    auto operator()(A const& a, B const& b, C const& c) const                  \
+    {                                                                          \
+      return function(a, b, c);                                                \
+    }                                                                          \
+  };
+
+#define AVEC_EXPRESSION_OPERATOR_1(Name, op)                                   \
+  struct Name##Function final                                                  \
+  {                                                                            \
+    template<class A>                                                          \
+    auto operator()(A const& a) const                                          \
+    {                                                                          \
+      return op a;                                                             \
+    }                                                                          \
+  };
+
+#define AVEC_EXPRESSION_OPERATOR_2(Name, op)                                   \
+  struct Name##Function final                                                  \
+  {                                                                            \
+    template<class A, class B>                                                 \
+    auto operator()(A const& a, B const& b) const                              \
+    {                                                                          \
+      return a op b;                                                           \
+    }                                                                          \
+  };
+
+AVEC_EXPRESSION_OPERATOR_1(Negate, -)
+AVEC_EXPRESSION_OPERATOR_1(Not, !)
+AVEC_EXPRESSION_OPERATOR_2(Add, +)
+AVEC_EXPRESSION_OPERATOR_2(Subtract, -)
+AVEC_EXPRESSION_OPERATOR_2(Multiply, *)
+AVEC_EXPRESSION_OPERATOR_2(Divide, /)
+AVEC_EXPRESSION_OPERATOR_2(Less, <)
+AVEC_EXPRESSION_OPERATOR_2(Greater, >)
+AVEC_EXPRESSION_OPERATOR_2(LessEqual, <=)
+AVEC_EXPRESSION_OPERATOR_2(GreaterEqual, >=)
+AVEC_EXPRESSION_OPERATOR_2(Equal, ==)
+AVEC_EXPRESSION_OPERATOR_2(NotEqual, !=)
+AVEC_EXPRESSION_OPERATOR_2(And, &)
+AVEC_EXPRESSION_OPERATOR_2(Or, |)
+AVEC_EXPRESSION_FUNCTION_1(Exp, exp)
+AVEC_EXPRESSION_FUNCTION_1(Log, log)
+AVEC_EXPRESSION_FUNCTION_1(Sin, sin)
+AVEC_EXPRESSION_FUNCTION_1(Cos, cos)
+AVEC_EXPRESSION_FUNCTION_1(Tan, tan)
+AVEC_EXPRESSION_FUNCTION_1(Tanh, tanh)
+AVEC_EXPRESSION_FUNCTION_1(Sqrt, sqrt)
+AVEC_EXPRESSION_FUNCTION_1(Abs, abs)
+AVEC_EXPRESSION_FUNCTION_2(Min, min)
+AVEC_EXPRESSION_FUNCTION_2(Max, max)
+AVEC_EXPRESSION_FUNCTION_3(MulAdd, mul_add)
+AVEC_EXPRESSION_FUNCTION_3(Select, select)
+
+#undef AVEC_EXPRESSION_FUNCTION_1
+#undef AVEC_EXPRESSION_FUNCTION_2
+#undef AVEC_EXPRESSION_FUNCTION_3
+#undef AVEC_EXPRESSION_OPERATOR_1
+#undef AVEC_EXPRESSION_OPERATOR_2
+
+} // namespace detail
+
+/**
+ * A lazy element-wise expression over VecBuffers and VecSpans, built with
+ * lazy() and the operators and math functions overloaded for it. Nothing is
+ * computed until it is evaluated, which is done in a single loop that loads
+ * each vector of the operands once and stores each vector of the output once,
+ * with no temporary buffers. The expression views the memory of its
+ * operands, which must outlive it.
+ * @tparam Function the function computing each vector from the operands.
+ * @tparam Operands the operands: other expressions, views over the memory of
+ * VecSpans and VecBuffers, and values that are the same for all the vectors.
+ */
+template<class Function, class... Operands>
+class VecExpression final
+{
+public:
+  /**
+   * The type the expression evaluates to, a vector type, or a mask type for
+   * comparisons.
+   */
+  using Vec = decltype(std::declval<Function const&>()(
+    std::declval<Operands const&>()[0u]...));
+
+private:
+  Function function;
+  std::tuple<Operands...> operands;
+  uint32_t numSamples;
+
+  template<std::size_t... I>
+  Vec compute(uint32_t i, std::index_sequence<I...>) const
+  {
+    return function(std::get<I>(operands)[i]...);
+  }
+
+public:
+  /**
+   * Constructor. See lazy() and the operators overloaded for VecExpression
+   * for a friendlier way to build expressions.
+   * @param function the function computing each vector from the operands.
+   * @param operands the operands, all with the same number of vectors, unless
+   * they are the same for all the vectors.
+   */
+  explicit VecExpression(Function const& function_,
+                         Operands const&... operands_)
+    : function(function_)
+    , operands(operands_...)
+    , numSamples(std::min({ UINT32_MAX, operands_.getNumSamples()... }))
+  {
+    assert(((operands_.getNumSamples() == UINT32_MAX ||
+             operands_.getNumSamples() == numSamples) &&
+            ...));
+  }
+
+  /**
+   * @return the number of vectors of the expression, or UINT32_MAX if it
+   * does not depend on any VecSpan or VecBuffer.
+   */
+  uint32_t getNumSamples() const { return numSamples; }
+
+  /**
+   * @return the i-th vector of the expression.
+   */
+  Vec operator[](uint32_t i) const
+  {
+    return compute(i, std::index_sequence_for<Operands...>{});
+  }
+
+  /**
+   * Evaluates the expression into a VecSpan or a VecBuffer, which can also be
+   * one of the operands of the expression.
+   * @param output the VecSpan or VecBuffer to store the expression to.
+   * @param offset the index of the vector of the expression to store to the
+   * first vector of the output, so that the work can be split in chunks, each
+   * evaluated to a subspan of the output.
+   */
+  template<class Output>
+  void evaluate(Output&& output, uint32_t offset = 0) const
+  {
+    auto const span = VecSpan<Vec>(output);
+    assert(offset + span.getNumSamples() <= numSamples);
+    for (uint32_t i = 0; i < span.getNumSamples(); ++i) {
+      span[i] = (*this)[offset + i];
+    }
+  }
+};
+
+/**
+ * Makes a VecExpression from a VecBuffer, a VecSpan, or an expression, to be
+ * combined with others with the operators and math functions overloaded for
+ * VecExpression.
+ * @param range the VecBuffer or VecSpan to view, which must outlive the
+ * expression.
+ * @return a VecExpression evaluating to the vectors of range.
+ */
+template<class Range, class = std::enable_if_t<detail::anyRange<Range>>>
+auto
+lazy(Range const& range)
+{
+  using Vec = typename detail::FirstVec<Range>::Vec;
+  return detail::makeExpression<Vec>(detail::IdentityFunction{}, range);
+}
+
+/**
+ * Makes a VecExpression applying a function to its operands, for the math
+ * functions of vectorclass that have no overload for VecExpression.
+ * @param function the function, which takes the operands, each one evaluated
+ * to a vector, and returns a vector.
+ * @param operands the operands: VecExpressions, VecBuffers, VecSpans, or
+ * values that are the same for all the vectors. At least one must be a
+ * VecExpression, a VecBuffer or a VecSpan.
+ * @return a VecExpression applying the function.
+ */
+template<class Function,
+         class... Operands,
+         class = std::enable_if_t<(sizeof...(Operands) > 0) &&
+                                  detail::anyRange<Operands...>>>
+auto
+lazy(Function const& function, Operands const&... operands)
+{
+  using Vec = typename detail::FirstVec<Operands...>::Vec;
+  return detail::makeExpression<Vec>(function, operands...);
+}
+
+#define AVEC_EXPRESSION_OPERATOR_1(Name, op)                                   \
+  template<class A, class = std::enable_if_t<detail::anyExpression<A>>>        \
+  auto operator op(A const& a)                                                 \
+  {                                                                            \
+    using Vec = typename detail::FirstVec<A>::Vec;                            \
+    return detail::makeExpression<Vec>(detail::Name##Function{}, a);           \
+  }
+
+#define AVEC_EXPRESSION_OPERATOR_2(Name, op)                                   \
+  template<class A,                                                            \
+           class B,                                                            \
+           class = std::enable_if_t<detail::anyExpression<A, B>>>              \
+  auto operator op(A const& a, B const& b)                                     \
+  {                                                                            \
+    using Vec = typename detail::FirstVec<A, B>::Vec;                         \
+    return detail::makeExpression<Vec>(detail::Name##Function{}, a, b);        \
+  }
+
+#define AVEC_EXPRESSION_FUNCTION_1(Name, function)                             \
+  template<class A, class = std::enable_if_t<detail::anyExpression<A>>>        \
+  auto function(A const& a)                                                    \
+  {                                                                            \
+    using Vec = typename detail::FirstVec<A>::Vec;                            \
+    return detail::makeExpression<Vec>(detail::Name##Function{}, a);           \
+  }
+
+#define AVEC_EXPRESSION_FUNCTION_2(Name, function)                             \
+  template<class A,                                                            \
+           class B,                                                            \
+           class = std::enable_if_t<detail::anyExpression<A, B>>>              \
+  auto function(A const& a, B const& b)                                        \
+  {                                                                            \
+    using Vec = typename detail::FirstVec<A, B>::Vec;                         \
+    return detail::makeExpression<Vec>(detail::Name##Function{}, a, b);        \
+  }
+
+AVEC_EXPRESSION_OPERATOR_1(Negate, -)
+AVEC_EXPRESSION_OPERATOR_1(Not, !)
+AVEC_EXPRESSION_OPERATOR_2(Add, +)
+AVEC_EXPRESSION_OPERATOR_2(Subtract, -)
+AVEC_EXPRESSION_OPERATOR_2(Multiply, *)
+AVEC_EXPRESSION_OPERATOR_2(Divide, /)
+AVEC_EXPRESSION_OPERATOR_2(Less, <)
+AVEC_EXPRESSION_OPERATOR_2(Greater, >)
+AVEC_EXPRESSION_OPERATOR_2(LessEqual, <=)
+AVEC_EXPRESSION_OPERATOR_2(GreaterEqual, >=)
+AVEC_EXPRESSION_OPERATOR_2(Equal, ==)
+AVEC_EXPRESSION_OPERATOR_2(NotEqual, !=)
+AVEC_EXPRESSION_OPERATOR_2(And, &)
+AVEC_EXPRESSION_OPERATOR_2(Or, |)
+AVEC_EXPRESSION_FUNCTION_1(Exp, exp)
+AVEC_EXPRESSION_FUNCTION_1(Log, log)
+AVEC_EXPRESSION_FUNCTION_1(Sin, sin)
+AVEC_EXPRESSION_FUNCTION_1(Cos, cos)
+AVEC_EXPRESSION_FUNCTION_1(Tan, tan)
+AVEC_EXPRESSION_FUNCTION_1(Tanh, tanh)
+AVEC_EXPRESSION_FUNCTION_1(Sqrt, sqrt)
+AVEC_EXPRESSION_FUNCTION_1(Abs, abs)
+AVEC_EXPRESSION_FUNCTION_2(Min, min)
+AVEC_EXPRESSION_FUNCTION_2(Max, max)
+
+#undef AVEC_EXPRESSION_OPERATOR_1
+#undef AVEC_EXPRESSION_OPERATOR_2
+#undef AVEC_EXPRESSION_FUNCTION_1
+#undef AVEC_EXPRESSION_FUNCTION_2
+
+/**
+ * Lazy mul_add: a * b + c, fused when the target supports it.
+ */
+template<class A,
+         class B,
+         class C,
+         class = std::enable_if_t<detail::anyExpression<A, B, C>>>
+auto
+mul_add(A const& a, B const& b, C const& c)
+{
+  using Vec = typename detail::FirstVec<A, B, C>::Vec;
+  return detail::makeExpression<Vec>(detail::MulAddFunction{}, a, b, c);
+}
+
+/**
+ * Lazy select: for each element, the one of a if the one of condition is
+ * true, the one of b otherwise.
+ */
+template<class Condition,
+         class A,
+         class B,
+         class = std::enable_if_t<detail::anyExpression<Condition, A, B>>>
+auto
+select(Condition const& condition, A const& a, B const& b)
+{
+  using Vec = typename detail::FirstVec<A, B, Condition>::Vec;
+  return detail::makeExpression<Vec>(
+    detail::SelectFunction{}, condition, a, b);
+}
+
+} // namespace avec
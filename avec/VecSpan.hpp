@@ -0,0 +1,345 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+#include "avec/VecBuffer.hpp"
+#include <cstddef>
+#include <iterator>
+
+namespace avec {
+
+/**
+ * A non-owning view over a contiguous range of simd vectors in aligned memory,
+ * such as a VecBuffer or a channel group of an InterleavedBuffer. Its
+ * iterators are random access and dereference to VecViews, so that the
+ * algorithms of the standard library, including the parallel ones, and
+ * chunked schedulers can run directly over it.
+ * @tparam Vec the vector type.
+ */
+template<class Vec>
+class VecSpan final
+{
+public:
+  /**
+   * The scalar type.
+   */
+  using Float = typename ScalarTypes<Vec>::Float;
+
+  /**
+   * A random access iterator over the vectors of a VecSpan. As the one of
+   * std::vector<bool>, it dereferences to a proxy, a VecView, which converts
+   * to Vec, can be assigned from it, and swaps the viewed vectors with swap.
+   */
+  class Iterator final
+  {
+    Float* ptr = nullptr;
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Vec;
+    using difference_type = std::ptrdiff_t;
+    using reference = VecView<Vec>;
+    using pointer = void;
+
+    /**
+     * Default constructor, an iterator that points to nothing.
+     */
+    Iterator() = default;
+
+    /**
+     * Constructor.
+     * @param ptr pointer to the first element of the vector to point to, which
+     * must be aligned to size<Vec>() * sizeof(Float).
+     */
+    explicit Iterator(Float* ptr)
+      : ptr(ptr)
+    {}
+
+    /**
+     * @return a VecView over the vector the iterator points to.
+     */
+    reference operator*() const { return VecView<Vec>(ptr); }
+
+    /**
+     * @return a VecView over the vector i positions after the one the iterator
+     * points to.
+     */
+    reference operator[](difference_type i) const
+    {
+      return VecView<Vec>(ptr + i * (difference_type)size<Vec>());
+    }
+
+    /**
+     * Moves the iterator to the next vector.
+     * @return the iterator after the increment.
+     */
+    Iterator& operator++()
+    {
+      ptr += size<Vec>();
+      return *this;
+    }
+
+    /**
+     * Moves the iterator to the next vector.
+     * @return a copy of the iterator before the increment.
+     */
+    Iterator operator++(int)
+    {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    /**
+     * Moves the iterator to the previous vector.
+     * @return the iterator after the decrement.
+     */
+    Iterator& operator--()
+    {
+      ptr -= size<Vec>();
+      return *this;
+    }
+
+    /**
+     * Moves the iterator to the previous vector.
+     * @return a copy of the iterator before the decrement.
+     */
+    Iterator operator--(int)
+    {
+      auto copy = *this;
+      --*this;
+      return copy;
+    }
+
+    /**
+     * Moves the iterator n vectors forward.
+     * @return the moved iterator.
+     */
+    Iterator& operator+=(difference_type n)
+    {
+      ptr += n * (difference_type)size<Vec>();
+      return *this;
+    }
+
+    /**
+     * Moves the iterator n vectors backward.
+     * @return the moved iterator.
+     */
+    Iterator& operator-=(difference_type n)
+    {
+      ptr -= n * (difference_type)size<Vec>();
+      return *this;
+    }
+
+    /**
+     * @return an iterator n vectors after it.
+     */
+    friend Iterator operator+(Iterator it, difference_type n)
+    {
+      return it += n;
+    }
+
+    /**
+     * @return an iterator n vectors after it.
+     */
+    friend Iterator operator+(difference_type n, Iterator it)
+    {
+      return it += n;
+    }
+
+    /**
+     * @return an iterator n vectors before it.
+     */
+    friend Iterator operator-(Iterator it, difference_type n)
+    {
+      return it -= n;
+    }
+
+    /**
+     * @return the number of vectors from rhs to lhs.
+     */
+    friend difference_type operator-(Iterator const& lhs, Iterator const& rhs)
+    {
+      return (lhs.ptr - rhs.ptr) / (difference_type)size<Vec>();
+    }
+
+    /**
+     * @return true if the iterators point to the same vector.
+     */
+    friend bool operator==(Iterator const& lhs, Iterator const& rhs)
+    {
+      return lhs.ptr == rhs.ptr;
+    }
+
+    /**
+     * @return true if the iterators point to different vectors.
+     */
+    friend bool operator!=(Iterator const& lhs, Iterator const& rhs)
+    {
+      return lhs.ptr != rhs.ptr;
+    }
+
+    /**
+     * @return true if lhs points to a vector before the one of rhs.
+     */
+    friend bool operator<(Iterator const& lhs, Iterator const& rhs)
+    {
+      return lhs.ptr < rhs.ptr;
+    }
+
+    /**
+     * @return true if lhs points to a vector after the one of rhs.
+     */
+    friend bool operator>(Iterator const& lhs, Iterator const& rhs)
+    {
+      return lhs.ptr > rhs.ptr;
+    }
+
+    /**
+     * @return true if lhs does not point to a vector after the one of rhs.
+     */
+    friend bool operator<=(Iterator const& lhs, Iterator const& rhs)
+    {
+      return lhs.ptr <= rhs.ptr;
+    }
+
+    /**
+     * @return true if lhs does not point to a vector before the one of rhs.
+     */
+    friend bool operator>=(Iterator const& lhs, Iterator const& rhs)
+    {
+      return lhs.ptr >= rhs.ptr;
+    }
+  };
+
+  using iterator = Iterator;
+  using value_type = Vec;
+  using reference = VecView<Vec>;
+  using difference_type = std::ptrdiff_t;
+
+private:
+  Float* data = nullptr;
+  uint32_t numSamples = 0;
+
+public:
+  /**
+   * Default constructor, an empty span.
+   */
+  VecSpan() = default;
+
+  /**
+   * Constructor.
+   * @param data pointer to the memory to view, which must be aligned to
+   * size<Vec>() * sizeof(Float).
+   * @param numSamples the number of vectors to view.
+   */
+  VecSpan(Float* data, uint32_t numSamples)
+    : data(data)
+    , numSamples(numSamples)
+  {
+    AVEC_ASSERT_ALIGNMENT(data, Vec);
+  }
+
+  /**
+   * Constructor, viewing all the vectors of a VecBuffer, for example one of
+   * the channel groups of an InterleavedBuffer.
+   * @param buffer the VecBuffer to view.
+   */
+  template<std::size_t Alignment, class Allocator>
+  VecSpan(VecBuffer<Vec, Alignment, Allocator>& buffer)
+    : VecSpan(buffer.getNumSamples() > 0 ? &buffer(0) : nullptr,
+              buffer.getNumSamples())
+  {}
+
+  /**
+   * Constructor, viewing all the vectors of a VecBuffer. As with the const
+   * operator[] of VecBuffer, the VecViews of the span can write to it.
+   * @param buffer the VecBuffer to view.
+   */
+  template<std::size_t Alignment, class Allocator>
+  VecSpan(VecBuffer<Vec, Alignment, Allocator> const& buffer)
+    : VecSpan(const_cast<VecBuffer<Vec, Alignment, Allocator>&>(buffer))
+  {}
+
+  /**
+   * @return the number of vectors in the span.
+   */
+  uint32_t getNumSamples() const { return numSamples; }
+
+  /**
+   * @return true if the span has no vectors.
+   */
+  bool empty() const { return numSamples == 0; }
+
+  /**
+   * @return a pointer to the first element of the span.
+   */
+  Float* getData() const { return data; }
+
+  /**
+   * @return a VecView over the i-th vector of the span.
+   */
+  VecView<Vec> operator[](uint32_t i) const
+  {
+    assert(i < numSamples);
+    return VecView<Vec>(data + i * size<Vec>());
+  }
+
+  /**
+   * @return an iterator to the first vector of the span.
+   */
+  Iterator begin() const { return Iterator(data); }
+
+  /**
+   * @return an iterator past the last vector of the span.
+   */
+  Iterator end() const { return Iterator(data + numSamples * size<Vec>()); }
+
+  /**
+   * Views the same memory as vectors of a different width, with no copy, for
+   * example a VecSpan<Vec8f> as a VecSpan<Vec4f> with twice the vectors, so
+   * that code written for one width can run over buffers of the other.
+   * @tparam OtherVec the vector type to view the memory as, with the same
+   * Float. If it is wider than Vec, the memory must be aligned to it and hold
+   * a whole number of its vectors.
+   * @return a VecSpan<OtherVec> over the memory of this span.
+   */
+  template<class OtherVec>
+  VecSpan<OtherVec> reinterpret() const
+  {
+    static_assert(
+      std::is_same<typename ScalarTypes<OtherVec>::Float, Float>::value,
+      "VecSpan can only be reinterpreted to vectors of the same Float type");
+    assert((numSamples * size<Vec>()) % size<OtherVec>() == 0);
+    return VecSpan<OtherVec>(data,
+                             numSamples * size<Vec>() / size<OtherVec>());
+  }
+
+  /**
+   * @param offset the index of the first vector of the subspan.
+   * @param count the number of vectors of the subspan, by default all the
+   * ones from offset to the end of the span.
+   * @return a VecSpan over a part of this one.
+   */
+  VecSpan subspan(uint32_t offset, uint32_t count = UINT32_MAX) const
+  {
+    assert(offset <= numSamples);
+    count = std::min(count, numSamples - offset);
+    return VecSpan(data + offset * size<Vec>(), count);
+  }
+};
+
+} // namespace avec
@@ -20,16 +20,155 @@ limitations under the License.
 
 namespace avec {
 
+/**
+ * How a VecView accesses its memory.
+ */
+enum class VecAccess
+{
+  /**
+   * The memory is aligned to size<Vec>() * sizeof(Float), and it is accessed
+   * with load_a and store_a.
+   */
+  aligned,
+  /**
+   * The memory can have any alignment, and it is accessed with load and
+   * store, for example for the sliding windows of FIR filters.
+   */
+  unaligned,
+  /**
+   * Only the first elements of the vector are viewed, and the memory can have
+   * any alignment. They are accessed with load_partial and store_partial, and
+   * the other elements are set to zero when loading, for the tails of blocks
+   * whose length is not a multiple of the vector size.
+   */
+  partial
+};
+
+namespace detail {
+
+template<bool isPartial>
+struct VecViewLength
+{
+  static constexpr uint32_t numElements = 0;
+};
+
+template<>
+struct VecViewLength<true>
+{
+  uint32_t numElements = 0;
+};
+
+template<class Vec, class Float>
+inline Vec
+loadPartial(Float const* ptr, uint32_t numElements)
+{
+  Vec v;
+#if AVEC_X86
+  v.load_partial((int)numElements, ptr);
+#else
+  Float values[size<Vec>()] = {};
+  for (uint32_t i = 0; i < numElements; ++i) {
+    values[i] = ptr[i];
+  }
+  v.load(values);
+#endif
+  return v;
+}
+
+template<class Vec, class Float>
+inline void
+storePartial(Vec const& v, Float* ptr, uint32_t numElements)
+{
+#if AVEC_X86
+  v.store_partial((int)numElements, ptr);
+#else
+  Float values[size<Vec>()];
+  v.store(values);
+  for (uint32_t i = 0; i < numElements; ++i) {
+    ptr[i] = values[i];
+  }
+#endif
+}
+
+/**
+ * Stores the elements of a vector for which a mask is true, leaving the others
+ * untouched, using the masked stores of AVX and AVX-512 when available, and
+ * select, which is a bitwise select on NEON, otherwise.
+ */
+template<class Vec, class Float>
+inline void
+storeMasked(Vec const& v, typename MaskTypes<Vec>::Mask const& mask, Float* ptr)
+{
+#if AVEC_X86
+#if INSTRSET >= 10
+  if constexpr (std::is_same<Vec, Vec4f>::value) {
+    _mm_mask_store_ps(ptr, mask, v);
+    return;
+  }
+  else if constexpr (std::is_same<Vec, Vec8f>::value) {
+    _mm256_mask_store_ps(ptr, mask, v);
+    return;
+  }
+  else if constexpr (std::is_same<Vec, Vec2d>::value) {
+    _mm_mask_store_pd(ptr, mask, v);
+    return;
+  }
+  else if constexpr (std::is_same<Vec, Vec4d>::value) {
+    _mm256_mask_store_pd(ptr, mask, v);
+    return;
+  }
+#elif AVEC_AVX
+  if constexpr (std::is_same<Vec, Vec4f>::value) {
+    _mm_maskstore_ps(ptr, _mm_castps_si128(mask), v);
+    return;
+  }
+  else if constexpr (std::is_same<Vec, Vec8f>::value) {
+    _mm256_maskstore_ps(ptr, _mm256_castps_si256(mask), v);
+    return;
+  }
+  else if constexpr (std::is_same<Vec, Vec2d>::value) {
+    _mm_maskstore_pd(ptr, _mm_castpd_si128(mask), v);
+    return;
+  }
+  else if constexpr (std::is_same<Vec, Vec4d>::value) {
+    _mm256_maskstore_pd(ptr, _mm256_castpd_si256(mask), v);
+    return;
+  }
+#endif
+#if AVEC_AVX512
+  if constexpr (std::is_same<Vec, Vec16f>::value) {
+    _mm512_mask_store_ps(ptr, mask, v);
+    return;
+  }
+  else if constexpr (std::is_same<Vec, Vec8d>::value) {
+    _mm512_mask_store_pd(ptr, mask, v);
+    return;
+  }
+#endif
+#endif
+  Vec previous;
+  previous.load_a(ptr);
+  select(mask, v, previous).store_a(ptr);
+}
+
+} // namespace detail
+
+template<class Vec>
+class MaskedVecView;
+
 /**
  * A view over a simd sized and aligned piece of a vector/array, with operators
  * overloaded to convert it and/or use it as a vector type from vectorclass.
  * @tparam Vec the vector type.
+ * @tparam Access how the memory is accessed, see VecAccess. Views with
+ * VecAccess::unaligned and VecAccess::partial do not require the memory to be
+ * aligned, see UnalignedVecView and PartialVecView.
  */
-
-template<class Vec>
+template<class Vec, VecAccess Access = VecAccess::aligned>
 class VecView final
+  : detail::VecViewLength<Access == VecAccess::partial>
 {
-  template<class TVec>
+  template<class TVec, VecAccess TAccess>
   friend class VecView;
 
 public:
@@ -41,105 +180,110 @@ public:
 private:
   Float* ptr;
 
+  template<class OtherVec, VecAccess OtherAccess>
+  VecView& copyFrom(VecView<OtherVec, OtherAccess> const& other)
+  {
+    static_assert(
+      std::is_same<typename ScalarTypes<OtherVec>::Float, Float>::value,
+      "Can't assign a VecView<Vec*f> to a VecView<Vec*d> or viceversa.");
+    if constexpr (Access == VecAccess::partial ||
+                  OtherAccess == VecAccess::partial) {
+      auto const numElements =
+        std::min(getNumElements(), other.getNumElements());
+      std::copy(other.ptr, other.ptr + numElements, ptr);
+    }
+    else if constexpr (size<OtherVec>() < size<Vec>()) {
+      auto narrower = VecView<OtherVec, Access>(ptr);
+      narrower = OtherVec(other);
+    }
+    else {
+      *this = Vec(VecView<Vec, OtherAccess>(other.ptr));
+    }
+    return *this;
+  }
+
 public:
   /**
    * Constructor.
-   * @param ptr pointer to the memory to view. It must be aligned
-   * tosize<Vec>()
-   * * sizeof(Float).
+   * @param ptr pointer to the memory to view. Unless Access is
+   * VecAccess::unaligned, it must be aligned to size<Vec>() * sizeof(Float).
    */
-  VecView(Float* ptr) { setPointer(ptr); }
+  VecView(Float* ptr)
+  {
+    static_assert(Access != VecAccess::partial,
+                  "A partial VecView needs the number of elements to view");
+    setPointer(ptr);
+  }
 
   /**
-   * Resets the view to point to a different address.
-   * @param ptr_ pointer to the memory to view. It must be aligned to
-   *size<Vec>()*sizeof(Float).
+   * Constructor for partial views.
+   * @param ptr pointer to the memory to view, with any alignment.
+   * @param numElements the number of elements to view, at most size<Vec>().
    */
-  void setPointer(Float* ptr_)
+  VecView(Float* ptr, uint32_t numElements)
   {
-    AVEC_ASSERT_ALIGNMENT(ptr_, Vec);
-    ptr = ptr_;
-    AVEC_ASSUME_ALIGNMENT(ptr, Vec);
+    static_assert(Access == VecAccess::partial,
+                  "Only a partial VecView can view part of a vector");
+    assert(numElements <= size<Vec>());
+    this->numElements = numElements;
+    setPointer(ptr);
   }
 
   /**
-   * Copies the memory viewed by a VecView<Vec4f>. Can only be called if the
-   * VecView's Float is also float.
-   * @param other the view to copy from.
+   * Resets the view to point to a different address.
+   * @param ptr_ pointer to the memory to view. Unless Access is
+   * VecAccess::unaligned or VecAccess::partial, it must be aligned to
+   * size<Vec>() * sizeof(Float).
    */
-  VecView& operator=(VecView<Vec4f> const other)
+  void setPointer(Float* ptr_)
   {
-    if constexpr (!std::is_same<Float, float>::value) {
-      // Can't assign a VecView<Vec*f> to a VecView<Vec*d> or viceversa.
-      assert(false);
-      return *this;
+    if constexpr (Access == VecAccess::aligned) {
+      AVEC_ASSERT_ALIGNMENT(ptr_, Vec);
+      ptr = ptr_;
+      AVEC_ASSUME_ALIGNMENT(ptr, Vec);
+    }
+    else {
+      ptr = ptr_;
     }
-    std::copy(other.ptr, other.ptr + Vec4f::size(), ptr);
-    return *this;
   }
 
   /**
-   * Copies the memory viewed by a VecView<Vec8f>. Can only be called if the
-   * VecView's Float is also float.
-   * @param other the view to copy from.
+   * @return the number of elements viewed: size<Vec>(), or less for a partial
+   * view.
    */
-  VecView& operator=(VecView<Vec8f> const x)
+  uint32_t getNumElements() const
   {
-    if constexpr (!std::is_same<Float, float>::value) {
-      // Can't assign a VecView<Vec*f> to a VecView<Vec*d> or viceversa.
-      assert(false);
-      return *this;
+    if constexpr (Access == VecAccess::partial) {
+      return this->numElements;
+    }
+    else {
+      return size<Vec>();
     }
-    std::copy(x.ptr, x.ptr + size<Vec>(), ptr);
-    return *this;
   }
 
   /**
-   * Copies the memory viewed by a VecView<Vec2d>. Can only be called if the
-   * VecView's Float is also double.
-   * @param other the view to copy from.
+   * Copy constructor. Copies the pointer, so both views share the memory; use
+   * operator= to copy the viewed elements instead.
    */
-  VecView& operator=(VecView<Vec2d> const other)
-  {
-    if constexpr (!std::is_same<Float, double>::value) {
-      // Can't assign a VecView<Vec*f> to a VecView<Vec*d> or viceversa.
-      assert(false);
-      return *this;
-    }
-    std::copy(other.ptr, other.ptr + size<Vec>(), ptr);
-    return *this;
-  }
+  VecView(VecView const&) = default;
 
   /**
-   * Copies the memory viewed by a VecView<Vec4d>. Can only be called if the
-   * VecView's Float is also double.
+   * Copies the memory viewed by another VecView of the same type.
    * @param other the view to copy from.
    */
-  VecView& operator=(VecView<Vec4d> const other)
-  {
-    if constexpr (!std::is_same<Float, double>::value) {
-      // Can't assign a VecView<Vec*f> to a VecView<Vec*d> or viceversa.
-      assert(false);
-      return *this;
-    }
-    std::copy(other.ptr, other.ptr + Vec4d::size(), ptr);
-    return *this;
-  }
+  VecView& operator=(VecView const& other) { return copyFrom(other); }
 
   /**
-   * Copies the memory viewed by a VecView<Vec8d>. Can only be called if the
-   * VecView's Float is also double.
+   * Copies the memory viewed by a VecView of any width and access over the
+   * same Float type. Only the first elements are copied if the widths differ,
+   * loading and storing them as the narrower vector type, so no shuffles are
+   * needed.
    * @param other the view to copy from.
    */
-  VecView& operator=(VecView<Vec8d> const other)
+  template<class OtherVec, VecAccess OtherAccess>
+  VecView& operator=(VecView<OtherVec, OtherAccess> const& other)
   {
-    if constexpr (!std::is_same<Float, double>::value) {
-      // Can't assign a VecView<Vec*f> to a VecView<Vec*d> or viceversa.
-      assert(false);
-      return *this;
-    }
-    std::copy(other.ptr, other.ptr + size<Vec>(), ptr);
-    return *this;
+    return copyFrom(other);
   }
 
   /**
@@ -148,7 +292,7 @@ public:
    */
   VecView& operator=(Float value)
   {
-    for (uint32_t i = 0; i < size<Vec>(); ++i) {
+    for (uint32_t i = 0; i < getNumElements(); ++i) {
       ptr[i] = value;
     }
     return *this;
@@ -160,20 +304,54 @@ public:
    */
   VecView& operator=(Float const* src)
   {
-    std::copy(src, src + size<Vec>(), ptr);
+    std::copy(src, src + getNumElements(), ptr);
     return *this;
   }
 
   /**
-   * Copies from the a vectorclass simd vector object.
+   * Copies from the a vectorclass simd vector object. A partial view only
+   * stores its first elements.
    * @param v the simd vector object.
    */
   VecView& operator=(Vec const& v)
   {
-    v.store_a(ptr);
+    if constexpr (Access == VecAccess::aligned) {
+      v.store_a(ptr);
+    }
+    else if constexpr (Access == VecAccess::unaligned) {
+      v.store(ptr);
+    }
+    else {
+      detail::storePartial(v, ptr, this->numElements);
+    }
     return *this;
   }
 
+  /**
+   * @return a VecView over the first half of the viewed vector, for example a
+   * VecView<Vec4f> for a VecView<Vec8f>, with no copy.
+   */
+  template<class T = Vec>
+  VecView<avec::Vec<Float, size<T>() / 2>, Access> getLow() const
+  {
+    static_assert(Access != VecAccess::partial,
+                  "A partial VecView can not be split");
+    return VecView<avec::Vec<Float, size<T>() / 2>, Access>(ptr);
+  }
+
+  /**
+   * @return a VecView over the second half of the viewed vector, for example
+   * a VecView<Vec4f> for a VecView<Vec8f>, with no copy.
+   */
+  template<class T = Vec>
+  VecView<avec::Vec<Float, size<T>() / 2>, Access> getHigh() const
+  {
+    static_assert(Access != VecAccess::partial,
+                  "A partial VecView can not be split");
+    return VecView<avec::Vec<Float, size<T>() / 2>, Access>(ptr +
+                                                            size<T>() / 2);
+  }
+
   /**
    * Implicit conversion to Float*
    * @returns the pointer to the viewed memory.
@@ -188,13 +366,24 @@ public:
 
   /**
    * Implicit conversion to a simd vector object.
-   * @returns simd vector object initialized with the viewed memory.
+   * @returns simd vector object initialized with the viewed memory. For a
+   * partial view, the elements after the viewed ones are zero.
    */
   operator Vec() const
   {
-    Vec v;
-    v.load_a(ptr);
-    return v;
+    if constexpr (Access == VecAccess::partial) {
+      return detail::loadPartial<Vec>(ptr, this->numElements);
+    }
+    else {
+      Vec v;
+      if constexpr (Access == VecAccess::aligned) {
+        v.load_a(ptr);
+      }
+      else {
+        v.load(ptr);
+      }
+      return v;
+    }
   }
 
   /**
@@ -209,20 +398,155 @@ public:
    */
   Float const* getPtr() const { return ptr; }
 
+  /**
+   * @param mask the mask of the elements to store to.
+   * @return a MaskedVecView over the same memory, which only stores the
+   * elements for which the mask is true.
+   */
+  MaskedVecView<Vec> masked(typename MaskTypes<Vec>::Mask const& mask) const
+  {
+    static_assert(Access == VecAccess::aligned,
+                  "Only an aligned VecView can be masked");
+    return MaskedVecView<Vec>(ptr, mask);
+  }
+
+  /**
+   * Swaps the vectors viewed by two VecViews, not the views, as the swap of the
+   * references of std::vector<bool>. It is found by argument dependent lookup,
+   * so that std::reverse, std::rotate and the other algorithms that swap
+   * elements work over a VecSpan, whose iterators dereference to VecViews.
+   * @param lhs the view over the first vector.
+   * @param rhs the view over the second vector.
+   */
+  friend void swap(VecView lhs, VecView rhs)
+  {
+    Vec const x = lhs;
+    lhs = Vec(rhs);
+    rhs = x;
+  }
+
   /**
    * A nullptr with VecView type.
    * @returns a VecView VecView pointing to nullptr.
    */
-  static VecView null() { return VecView(nullptr); }
+  static VecView null()
+  {
+    if constexpr (Access == VecAccess::partial) {
+      return VecView(nullptr, 0);
+    }
+    else {
+      return VecView(nullptr);
+    }
+  }
 };
 
-template<class Vec>
+template<class Vec, VecAccess Access>
 inline Vec
-operator-(VecView<Vec> const lhs, VecView<Vec> const rhs)
+operator-(VecView<Vec, Access> const lhs, VecView<Vec, Access> const rhs)
+{
+  return Vec(lhs) - Vec(rhs);
+}
+
+/**
+ * A view over a simd sized and aligned piece of memory that only stores the
+ * elements for which a mask is true, leaving the others untouched, for example
+ * to process some of the channels of a group of an InterleavedBuffer, see
+ * InterleavedBuffer::getMask8. The stores are masked stores on AVX and
+ * AVX-512, so they cost as much as regular stores.
+ * @tparam Vec the vector type.
+ */
+template<class Vec>
+class MaskedVecView final
+{
+public:
+  /**
+   * The scalar type.
+   */
+  using Float = typename ScalarTypes<Vec>::Float;
+
+  /**
+   * The mask type.
+   */
+  using Mask = typename MaskTypes<Vec>::Mask;
+
+private:
+  Float* ptr;
+  Mask mask;
+
+public:
+  /**
+   * Constructor.
+   * @param ptr pointer to the memory to view, which must be aligned to
+   * size<Vec>() * sizeof(Float).
+   * @param mask the mask of the elements to store to.
+   */
+  MaskedVecView(Float* ptr, Mask const& mask)
+    : ptr(ptr)
+    , mask(mask)
+  {
+    AVEC_ASSERT_ALIGNMENT(ptr, Vec);
+  }
+
+  /**
+   * Stores the elements of a vector for which the mask is true.
+   * @param v the simd vector object.
+   */
+  MaskedVecView& operator=(Vec const& v)
+  {
+    detail::storeMasked(v, mask, ptr);
+    return *this;
+  }
+
+  /**
+   * Implicit conversion to Vec, loading all the elements.
+   * @returns the vector.
+   */
+  operator Vec() const
+  {
+    Vec v;
+    v.load_a(ptr);
+    return v;
+  }
+
+  /**
+   * @returns the mask of the elements to store to.
+   */
+  Mask const& getMask() const { return mask; }
+};
+
+/**
+ * Makes a mask from the bits of an integer.
+ * @tparam Vec the vector type.
+ * @param bits the bits of the mask, the k-th is the one of the k-th element.
+ * @return a mask that is true for the elements whose bit is set.
+ */
+template<class Vec>
+inline typename MaskTypes<Vec>::Mask
+laneMask(uint64_t bits)
 {
-  Vec x;
-  x.load_a(lhs);
-  return x - rhs;
+  using Float = typename ScalarTypes<Vec>::Float;
+  Float lanes[size<Vec>()];
+  for (uint32_t k = 0; k < size<Vec>(); ++k) {
+    lanes[k] = (Float)((bits >> k) & 1);
+  }
+  Vec v;
+  v.load(lanes);
+  return v != Vec(0);
 }
 
+/**
+ * A VecView over memory with any alignment.
+ * @tparam Vec the vector type.
+ */
+template<class Vec>
+using UnalignedVecView = VecView<Vec, VecAccess::unaligned>;
+
+/**
+ * A VecView over the first elements of a vector, for the tails of blocks whose
+ * length is not a multiple of the vector size.
+ * @tparam Vec the vector type.
+ */
+template<class Vec>
+using PartialVecView = VecView<Vec, VecAccess::partial>;
+
 } // namespace avec
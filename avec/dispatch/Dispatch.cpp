@@ -0,0 +1,198 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+// The selection of the kernels of Dispatch.hpp. AVEC_DISPATCH_WITH_AVX2 and
+// AVEC_DISPATCH_WITH_AVX512 tell which instruction sets Kernels.cpp has been
+// compiled for, besides the baseline, see CMakeLists.txt.
+
+#include "avec/Dispatch.hpp"
+#include <atomic>
+#include <initializer_list>
+
+#if (defined(__arm__) || defined(__aarch64__) || defined(__arm64__))
+#define AVEC_DISPATCH_ARM 1
+#else
+#define AVEC_DISPATCH_ARM 0
+#endif
+
+#if !defined(AVEC_DISPATCH_WITH_AVX2) || AVEC_DISPATCH_ARM
+#undef AVEC_DISPATCH_WITH_AVX2
+#define AVEC_DISPATCH_WITH_AVX2 0
+#endif
+
+#if !defined(AVEC_DISPATCH_WITH_AVX512) || AVEC_DISPATCH_ARM
+#undef AVEC_DISPATCH_WITH_AVX512
+#define AVEC_DISPATCH_WITH_AVX512 0
+#endif
+
+// instrset_detect is only needed, and compiled, to choose between the x86
+// instruction sets
+#if AVEC_DISPATCH_WITH_AVX2 || AVEC_DISPATCH_WITH_AVX512
+#include "instrset.h"
+#endif
+
+namespace avec {
+
+namespace detail {
+
+// defined in Kernels.cpp
+
+#define AVEC_DISPATCH_DECLARE_KERNELS(isa)                                     \
+  template<>                                                                   \
+  Kernels<float> const& getIsaKernels<Isa::isa, float>();                      \
+  template<>                                                                   \
+  Kernels<double> const& getIsaKernels<Isa::isa, double>();
+
+#if AVEC_DISPATCH_ARM
+AVEC_DISPATCH_DECLARE_KERNELS(neon)
+#else
+AVEC_DISPATCH_DECLARE_KERNELS(sse2)
+#if AVEC_DISPATCH_WITH_AVX2
+AVEC_DISPATCH_DECLARE_KERNELS(avx2)
+#endif
+#if AVEC_DISPATCH_WITH_AVX512
+AVEC_DISPATCH_DECLARE_KERNELS(avx512)
+#endif
+#endif
+
+#undef AVEC_DISPATCH_DECLARE_KERNELS
+
+} // namespace detail
+
+namespace {
+
+bool
+isSupported(Isa isa)
+{
+#if AVEC_DISPATCH_ARM
+  return isa == Isa::neon;
+#else
+  switch (isa) {
+    case Isa::sse2:
+      return true;
+#if AVEC_DISPATCH_WITH_AVX2
+    case Isa::avx2:
+      return instrset_detect() >= 8 && hasFMA3() && hasF16C();
+#endif
+#if AVEC_DISPATCH_WITH_AVX512
+    case Isa::avx512:
+      return instrset_detect() >= 10 && hasFMA3() && hasF16C();
+#endif
+    default:
+      return false;
+  }
+#endif
+}
+
+Isa
+detectIsa()
+{
+  for (auto isa : { Isa::avx512, Isa::avx2, Isa::sse2, Isa::neon }) {
+    if (isSupported(isa)) {
+      return isa;
+    }
+  }
+  // the baseline
+  return AVEC_DISPATCH_ARM ? Isa::neon : Isa::sse2;
+}
+
+std::atomic<Isa>&
+getActiveIsaReference()
+{
+  static std::atomic<Isa> activeIsa{ detectIsa() };
+  return activeIsa;
+}
+
+template<typename Float>
+Kernels<Float> const&
+getKernelsFor(Isa isa)
+{
+  switch (isa) {
+#if AVEC_DISPATCH_ARM
+    default:
+      return detail::getIsaKernels<Isa::neon, Float>();
+#else
+#if AVEC_DISPATCH_WITH_AVX512
+    case Isa::avx512:
+      return detail::getIsaKernels<Isa::avx512, Float>();
+#endif
+#if AVEC_DISPATCH_WITH_AVX2
+    case Isa::avx2:
+      return detail::getIsaKernels<Isa::avx2, Float>();
+#endif
+    default:
+      return detail::getIsaKernels<Isa::sse2, Float>();
+#endif
+  }
+}
+
+} // namespace
+
+Isa
+getActiveIsa()
+{
+  return getActiveIsaReference().load(std::memory_order_relaxed);
+}
+
+bool
+isIsaAvailable(Isa isa)
+{
+  return isSupported(isa);
+}
+
+bool
+setActiveIsa(Isa isa)
+{
+  if (!isSupported(isa)) {
+    return false;
+  }
+  getActiveIsaReference().store(isa, std::memory_order_relaxed);
+  return true;
+}
+
+char const*
+getIsaName(Isa isa)
+{
+  switch (isa) {
+    case Isa::sse2:
+      return "sse2";
+    case Isa::avx2:
+      return "avx2";
+    case Isa::avx512:
+      return "avx512";
+    case Isa::neon:
+      return "neon";
+    default:
+      return "unknown";
+  }
+}
+
+template<>
+Kernels<float> const&
+getKernels<float>()
+{
+  return getKernelsFor<float>(getActiveIsa());
+}
+
+template<>
+Kernels<double> const&
+getKernels<double>()
+{
+  return getKernelsFor<double>(getActiveIsa());
+}
+
+} // namespace avec
@@ -0,0 +1,230 @@
+/*
+Copyright 2019-2021 Dario Mambro
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+// The kernels of Dispatch.hpp, compiled once for each instruction set, with
+// AVEC_DISPATCH_ISA set to its name in avec::Isa and the matching compiler
+// flags, see CMakeLists.txt. If AVEC_DISPATCH_ISA is not defined, they are
+// compiled for the baseline, sse2 or neon.
+// The inline functions of avec and vectorclass are compiled differently in
+// each translation unit, so they are moved to a different namespace for each
+// instruction set, to keep the linker from merging them: vectorclass supports
+// it with VCL_NAMESPACE, and avec is renamed with a macro, which is why
+// Dispatch.hpp must not include the other headers of avec.
+// Any other inline function used here, like the containers and algorithms of
+// the standard library, would be emitted by each translation unit with the
+// same name, and the linker would keep one of its copies, maybe compiled for
+// an instruction set that the processor does not support. So the kernels only
+// use the functions of avec and vectorclass that do not call them, and keep
+// their scratch memory on the stack.
+
+#include "avec/Dispatch.hpp"
+
+#ifndef AVEC_DISPATCH_ISA
+#if (defined(__arm__) || defined(__aarch64__) || defined(__arm64__))
+#define AVEC_DISPATCH_ISA neon
+#else
+#define AVEC_DISPATCH_ISA sse2
+#endif
+#endif
+
+#define AVEC_DISPATCH_CONCAT_(a, b) a##b
+#define AVEC_DISPATCH_CONCAT(a, b) AVEC_DISPATCH_CONCAT_(a, b)
+#define AVEC_DISPATCH_NAMESPACE AVEC_DISPATCH_CONCAT(avec_, AVEC_DISPATCH_ISA)
+#define VCL_NAMESPACE AVEC_DISPATCH_CONCAT(vcl_, AVEC_DISPATCH_ISA)
+
+#define avec AVEC_DISPATCH_NAMESPACE
+#include "avec/InterleavedBuffer.hpp"
+
+namespace avec {
+namespace {
+
+template<typename Float>
+struct IsaKernels final
+{
+  using Vec = typename NativeVec<Float>::Vec;
+  static constexpr uint32_t N = NativeVec<Float>::SIZE;
+
+  template<class Function>
+  static void map(Float const* input,
+                  Float* output,
+                  uint32_t size,
+                  Function const& function)
+  {
+    uint32_t i = 0;
+    for (; i + N <= size; i += N) {
+      Vec const x = UnalignedVecView<Vec>(const_cast<Float*>(input + i));
+      auto y = UnalignedVecView<Vec>(output + i);
+      y = function(x);
+    }
+    if (i < size) {
+      Vec const x =
+        PartialVecView<Vec>(const_cast<Float*>(input + i), size - i);
+      auto y = PartialVecView<Vec>(output + i, size - i);
+      y = function(x);
+    }
+  }
+
+  // the number of samples copied through a group on the stack at a time
+  static constexpr uint32_t blockSize = 64;
+
+  // the channels of an array of pointers, from a sample on
+  template<class Pointer>
+  struct Channels final
+  {
+    Pointer const* channels;
+    uint32_t firstSample;
+
+    Pointer operator[](uint32_t channel) const
+    {
+      return channels[channel] + firstSample;
+    }
+  };
+
+  // the same steps as InterleavedBuffer::interleave followed by
+  // InterleavedBuffer::deinterleaveFrames, over a group of N channels
+  static void interleave(Float const* const* input,
+                         Float* output,
+                         uint32_t numChannels,
+                         uint32_t numSamples)
+  {
+    alignas(64) Float group[N * blockSize];
+    for (uint32_t s = 0; s < numSamples; s += blockSize) {
+      auto const numGroupSamples =
+        numSamples - s < blockSize ? numSamples - s : blockSize;
+      auto const channels = Channels<Float const*>{ input, s };
+      for (uint32_t c = 0; c < numChannels; c += N) {
+        auto const numLanes = numChannels - c < N ? numChannels - c : N;
+        detail::channelsToGroup<N>(
+          channels, c, numLanes, numGroupSamples, group);
+        detail::groupToFrames<Vec>(group,
+                                   numLanes,
+                                   numGroupSamples,
+                                   output + s * numChannels + c,
+                                   numChannels);
+      }
+    }
+  }
+
+  // the same steps as InterleavedBuffer::interleaveFrames followed by
+  // InterleavedBuffer::deinterleave, over a group of N channels
+  static void deinterleave(Float const* input,
+                           Float* const* output,
+                           uint32_t numChannels,
+                           uint32_t numSamples)
+  {
+    alignas(64) Float group[N * blockSize];
+    for (uint32_t s = 0; s < numSamples; s += blockSize) {
+      auto const numGroupSamples =
+        numSamples - s < blockSize ? numSamples - s : blockSize;
+      auto const channels = Channels<Float*>{ output, s };
+      for (uint32_t c = 0; c < numChannels; c += N) {
+        auto const numLanes = numChannels - c < N ? numChannels - c : N;
+        detail::framesToGroup<Vec>(input + s * numChannels + c,
+                                   numChannels,
+                                   numLanes,
+                                   numGroupSamples,
+                                   group);
+        detail::groupToChannels<N>(
+          group, numLanes, numGroupSamples, channels, c);
+      }
+    }
+  }
+
+  static void copy(Float const* input, Float* output, uint32_t size, Float gain)
+  {
+    map(input, output, size, [gain](Vec const& x) { return x * gain; });
+  }
+
+  static void fill(Float* output, uint32_t size, Float value)
+  {
+    uint32_t i = 0;
+    for (; i + N <= size; i += N) {
+      auto y = UnalignedVecView<Vec>(output + i);
+      y = Vec(value);
+    }
+    if (i < size) {
+      auto y = PartialVecView<Vec>(output + i, size - i);
+      y = Vec(value);
+    }
+  }
+
+  static void mapExp(Float const* input, Float* output, uint32_t size)
+  {
+    map(input, output, size, [](Vec const& x) { return exp(x); });
+  }
+
+  static void mapLog(Float const* input, Float* output, uint32_t size)
+  {
+    map(input, output, size, [](Vec const& x) { return log(x); });
+  }
+
+  static void mapSin(Float const* input, Float* output, uint32_t size)
+  {
+    map(input, output, size, [](Vec const& x) { return sin(x); });
+  }
+
+  static void mapCos(Float const* input, Float* output, uint32_t size)
+  {
+    map(input, output, size, [](Vec const& x) { return cos(x); });
+  }
+
+  static void mapTanh(Float const* input, Float* output, uint32_t size)
+  {
+    map(input, output, size, [](Vec const& x) { return tanh(x); });
+  }
+};
+
+} // namespace
+} // namespace avec
+
+#undef avec
+
+namespace avec {
+namespace detail {
+namespace {
+
+template<typename Float>
+Kernels<Float> const&
+makeIsaKernels()
+{
+  using IsaKernels = AVEC_DISPATCH_NAMESPACE::IsaKernels<Float>;
+  static Kernels<Float> const kernels = {
+    &IsaKernels::interleave, &IsaKernels::deinterleave, &IsaKernels::copy,
+    &IsaKernels::fill,       &IsaKernels::mapExp,       &IsaKernels::mapLog,
+    &IsaKernels::mapSin,     &IsaKernels::mapCos,       &IsaKernels::mapTanh
+  };
+  return kernels;
+}
+
+} // namespace
+
+template<>
+Kernels<float> const&
+getIsaKernels<Isa::AVEC_DISPATCH_ISA, float>()
+{
+  return makeIsaKernels<float>();
+}
+
+template<>
+Kernels<double> const&
+getIsaKernels<Isa::AVEC_DISPATCH_ISA, double>()
+{
+  return makeIsaKernels<double>();
+}
+
+} // namespace detail
+} // namespace avec
@@ -14,13 +14,29 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include "avec/BufferFile.hpp"
+#include "avec/Dispatch.hpp"
+#include "avec/HugePages.hpp"
+#include "avec/InterleavedView.hpp"
 #include "avec/InterleavedBuffer.hpp"
+#include "avec/Numa.hpp"
+#include "avec/PackedVecBuffer.hpp"
+#include "avec/PcmReader.hpp"
+#include "avec/Recorder.hpp"
+#include "avec/VecExpression.hpp"
+#include "avec/VecSpan.hpp"
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <numeric>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <thread>
 
 // macro-paranoia macro
 #ifdef _MSC_VER
@@ -57,6 +73,17 @@ i2s(uint32_t x)
   return stream.str();
 }
 
+template<typename Scalar>
+std::string
+scalarName()
+{
+  if (std::is_integral<Scalar>::value) {
+    return std::to_string(8 * sizeof(Scalar)) + " bit integers";
+  }
+  return typeid(Scalar) == typeid(float) ? "single precision"
+                                         : "double precision";
+}
+
 void
 verify(bool condition, string description)
 {
@@ -83,6 +110,14 @@ testInterleavedBuffer(uint32_t numChannels, uint32_t samplesPerBlock)
   }
   // interleaver test
   auto buffer = InterleavedBuffer<Float>(numChannels, samplesPerBlock);
+  verify(2 * buffer.getNumBuffers2() + 4 * buffer.getNumBuffers4() +
+             8 * buffer.getNumBuffers8() + 16 * buffer.getNumBuffers16() >=
+           numChannels,
+         "checking the number of lanes of InterleavedBuffer\n");
+  if constexpr (SimdTypes<Float>::VEC16_AVAILABLE) {
+    verify(numChannels <= 8 || buffer.getNumBuffers16() > 0,
+           "checking the groups of 16 channels of InterleavedBuffer\n");
+  }
   buffer.interleave(inout, numChannels, samplesPerBlock);
   for (uint32_t i = 0; i < numChannels; ++i) {
     for (uint32_t s = 0; s < samplesPerBlock; ++s) {
@@ -120,6 +155,1399 @@ testInterleavedBuffer(uint32_t numChannels, uint32_t samplesPerBlock)
        << " precision\n\n";
 }
 
+template<typename Float>
+void
+testFrameInterleaving(uint32_t numChannels, uint32_t numSamples)
+{
+  cout << "Testing frame interleaving with " << numChannels
+       << " channels and "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  std::vector<Float> frames(numChannels * numSamples);
+  for (uint32_t s = 0; s < numSamples; ++s) {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      frames[s * numChannels + c] = (Float)(s * 100 + c);
+    }
+  }
+  auto interleaved = InterleavedBuffer<Float>(numChannels, numSamples);
+  interleaved.fill(-1);
+  verify(interleaved.interleaveFrames(frames.data(), numChannels, numSamples),
+         "checking interleaveFrames\n");
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      verify(*interleaved.at(c, s) == frames[s * numChannels + c],
+             "checking interleaveFrames\n");
+    }
+  }
+  auto partial = InterleavedBuffer<Float>(numChannels, numSamples);
+  partial.fill(-1);
+  std::vector<Float> shortFrames(numSamples * (numChannels - 1), 1);
+  partial.interleaveFrames(shortFrames.data(), numChannels - 1, numSamples);
+  verify(*partial.at(numChannels - 1, numSamples - 1) == 0,
+         "checking that interleaveFrames zeroes the channels left out\n");
+  std::vector<Float> output(numChannels * numSamples, -1);
+  verify(interleaved.deinterleaveFrames(
+           output.data(), numChannels, numSamples),
+         "checking deinterleaveFrames\n");
+  verify(output == frames, "checking deinterleaveFrames\n");
+  verify(!interleaved.deinterleaveFrames(
+           output.data(), numChannels + 1, numSamples),
+         "checking deinterleaveFrames with too many channels\n");
+  cout << "completed testing frame interleaving\n\n";
+}
+
+template<typename Float, uint32_t N>
+void
+testVecTypes()
+{
+  cout << "Testing Vec<Float, " << N << "> with "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  using V = avec::Vec<Float, N>;
+  verify(size<V>() == N, "checking the size of Vec<Float, N>\n");
+  verify(std::is_same<typename ScalarTypes<V>::Float, Float>::value,
+         "checking ScalarTypes of Vec<Float, N>\n");
+  verify(std::is_same<typename MaskTypes<V>::Mask,
+                      typename VecTypes<Float, N>::Mask>::value,
+         "checking MaskTypes of Vec<Float, N>\n");
+  verify(AlignmentOf<V>::value == N * sizeof(Float),
+         "checking AlignmentOf Vec<Float, N>\n");
+  // a kernel written once over N
+  Float input[N], output[N];
+  for (uint32_t i = 0; i < N; ++i) {
+    input[i] = (Float)i;
+  }
+  V v;
+  v.load(input);
+  (v * (Float)2 + (Float)1).store(output);
+  for (uint32_t i = 0; i < N; ++i) {
+    verify(output[i] == (Float)(2 * i + 1),
+           "checking arithmetic with Vec<Float, N>\n");
+  }
+}
+
+template<typename Float, uint32_t N>
+void
+testVecFunctions()
+{
+  cout << "Testing the operators and functions of Vec<Float, " << N
+       << "> with " << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  using V = avec::Vec<Float, N>;
+  Float a[N], b[N];
+  for (uint32_t i = 0; i < N; ++i) {
+    a[i] = (Float)0.25 + (Float)i / (Float)N;
+    b[i] = (Float)1 - (Float)(i % 3) / (Float)4;
+  }
+  V x, y;
+  x.load(a);
+  y.load(b);
+  auto const isNear = [](Float value, Float expected) {
+    return std::abs(value - expected) <= (Float)1e-5;
+  };
+  for (uint32_t i = 0; i < N; ++i) {
+    verify((x + y)[i] == a[i] + b[i] && (x - y)[i] == a[i] - b[i] &&
+             (x * y)[i] == a[i] * b[i] && (x / y)[i] == a[i] / b[i] &&
+             (-x)[i] == -a[i],
+           "checking the arithmetic operators\n");
+    V z = x;
+    verify((z++)[i] == a[i] && z[i] == a[i] + 1 && (++z)[i] == a[i] + 2 &&
+             (z--)[i] == a[i] + 2 && z[i] == a[i] + 1 && (--z)[i] == a[i],
+           "checking the increment and decrement operators\n");
+    verify(select(x < y, x, y)[i] == std::min(a[i], b[i]) &&
+             select(x >= y, x, y)[i] == std::max(a[i], b[i]) &&
+             select((x < y) & (x > (Float)0.5), x, y)[i] ==
+               (a[i] < b[i] && a[i] > (Float)0.5 ? a[i] : b[i]),
+           "checking comparisons and select\n");
+    verify(min(x, y)[i] == std::min(a[i], b[i]) &&
+             max(x, y)[i] == std::max(a[i], b[i]) && abs(-x)[i] == a[i],
+           "checking min, max and abs\n");
+    verify(isNear(mul_add(x, y, x)[i], a[i] * b[i] + a[i]),
+           "checking mul_add\n");
+    verify(isNear(sqrt(x)[i], std::sqrt(a[i])) &&
+             isNear(exp(x)[i], std::exp(a[i])) &&
+             isNear(log(x)[i], std::log(a[i])) &&
+             isNear(sin(x)[i], std::sin(a[i])) &&
+             isNear(cos(x)[i], std::cos(a[i])),
+           "checking the math functions\n");
+  }
+}
+
+template<typename Float>
+void
+testNativeVec()
+{
+  cout << "Testing NativeVec with "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  using Native = NativeVec<Float>;
+  verify(std::is_same<typename Native::Vec, Vec<Float, Native::SIZE>>::value,
+         "checking NativeVec::Vec\n");
+  verify(size<typename Native::Vec>() == Native::SIZE,
+         "checking NativeVec::SIZE\n");
+  uint32_t expectedSize = std::is_same<Float, float>::value ? 4 : 2;
+  if (SimdTypes<Float>::VEC4_AVAILABLE) {
+    expectedSize = 4;
+  }
+  if (SimdTypes<Float>::VEC8_AVAILABLE) {
+    expectedSize = 8;
+  }
+  if (SimdTypes<Float>::VEC16_AVAILABLE) {
+    expectedSize = 16;
+  }
+  verify(Native::SIZE == expectedSize,
+         "checking that NativeVec is the widest non emulated vector\n");
+}
+
+template<typename Float>
+void
+testBufferView()
+{
+  cout << "Testing BufferView with "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  uint32_t const numChannels = 11;
+  uint32_t const numSamples = 64;
+  auto buffer = Buffer<Float>(numChannels, numSamples);
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      buffer[c][s] = (Float)(c * numSamples + s);
+    }
+  }
+  auto const view = BufferView<Float>(buffer);
+  // interleave a subset of the channels, in two blocks
+  uint32_t const subset[] = { 9, 2, 5 };
+  auto const channels = view.getChannels(subset, 3);
+  auto interleaved = InterleavedBuffer<Float>(3, numSamples / 2);
+  for (uint32_t block = 0; block < 2; ++block) {
+    auto const offset = block * numSamples / 2;
+    interleaved.interleave(channels.getSamples(offset, numSamples / 2));
+    for (uint32_t c = 0; c < 3; ++c) {
+      for (uint32_t s = 0; s < numSamples / 2; ++s) {
+        verify(interleaved.at(c, s)[0] == buffer[subset[c]][offset + s],
+               "checking interleaving from a BufferView\n");
+      }
+    }
+  }
+  // deinterleave to a range of channels and samples
+  auto output = Buffer<Float>(numChannels, numSamples);
+  output.fill(-1);
+  interleaved.deinterleave(
+    BufferView<Float>(output).getChannels(4, 3).getSamples(10, 20));
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      bool const isInView = c >= 4 && c < 7 && s >= 10 && s < 30;
+      auto const expected = isInView ? interleaved.at(c - 4, s - 10)[0] : -1;
+      verify(output[c][s] == expected,
+             "checking deinterleaving to a BufferView\n");
+    }
+  }
+  // copy and convert
+  auto converted = Buffer<double>(numChannels, numSamples);
+  copyBuffer(view.getSamples(1, numSamples - 1),
+             BufferView<double>(converted).getSamples(0, numSamples - 1));
+  verify(converted[3][0] == (double)buffer[3][1],
+         "checking copyBuffer with BufferView\n");
+  // a const Buffer can only be viewed as read-only
+  static_assert(!std::is_constructible<BufferView<Float>,
+                                       Buffer<Float> const&>::value,
+                "a const Buffer should not be viewed as mutable");
+  auto const& constBuffer = buffer;
+  auto const readOnly = BufferView<Float const>(constBuffer);
+  static_assert(std::is_same<decltype(readOnly[0]), Float const*>::value,
+                "a read-only BufferView should give pointers to const");
+  interleaved.interleave(readOnly.getChannels(2, 3).getSamples(0, 32));
+  verify(interleaved.at(1, 31)[0] == buffer[3][31],
+         "checking interleaving from a read-only BufferView\n");
+  copyBuffer(BufferView<Float const>(view).getSamples(2, numSamples - 2),
+             BufferView<double>(converted));
+  verify(converted[5][0] == (double)buffer[5][2],
+         "checking copyBuffer from a read-only BufferView\n");
+  cout << "completed testing BufferView\n\n";
+}
+
+template<typename InScalar, typename OutScalar>
+void
+testCopyBuffer()
+{
+  cout << "Testing copyBuffer from "
+       << (typeid(InScalar) == typeid(float) ? "single" : "double") << " to "
+       << (typeid(OutScalar) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  uint32_t const numChannels = 13;
+  uint32_t const numSamples = 1001;
+  auto input = Buffer<InScalar>(numChannels, numSamples);
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      input[c][s] = (InScalar)(0.25 * c - 0.5 + s / (double)numSamples);
+    }
+  }
+  auto output = Buffer<OutScalar>(numChannels, numSamples);
+  output.setNumSamples(1);
+  copyBuffer(input, output);
+  verify(output.getNumSamples() == numSamples,
+         "checking that copyBuffer resizes the output\n");
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      verify(output[c][s] == (OutScalar)input[c][s],
+             "checking copyBuffer conversion\n");
+    }
+  }
+  CopySettings settings;
+  settings.gain = 2.0;
+  settings.clamp = true;
+  settings.clampLevel = 1.5;
+  copyBuffer(input, output, settings);
+  auto const verifyGainAndClamping = [&] {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t s = 0; s < numSamples; ++s) {
+        double const expected =
+          std::min(std::max(2.0 * (double)input[c][s], -1.5), 1.5);
+        verify(std::abs(output[c][s] - expected) < 1.e-6,
+               "checking copyBuffer with gain and clamping\n");
+      }
+    }
+  };
+  verifyGainAndClamping();
+  // an executor splitting the channels over 4 threads
+  std::fill(output[0].begin(), output[0].end(), (OutScalar)0);
+  uint32_t numTasks = 0;
+  auto const executor = [&](uint32_t numTasksToRun, auto const& task) {
+    numTasks = numTasksToRun;
+    uint32_t const numThreads = 4;
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (uint32_t i = t; i < numTasksToRun; i += numThreads) {
+          task(i);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  copyBuffer(BufferView<InScalar const>(input),
+             BufferView<OutScalar>(output),
+             settings,
+             executor);
+  verify(numTasks == numChannels,
+         "checking that copyBuffer gives a task per channel to the executor\n");
+  verifyGainAndClamping();
+  cout << "completed testing copyBuffer\n\n";
+}
+
+template<typename Float>
+void
+testBufferFile(uint32_t numChannels, uint32_t numSamples = 77)
+{
+  cout << "Testing buffer files with " << numChannels << " channels, "
+       << numSamples << " samples and "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  auto buffer = Buffer<Float>(numChannels, numSamples);
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      buffer[c][s] = (Float)(c * 1000 + s);
+    }
+  }
+  auto interleaved = InterleavedBuffer<Float>(numChannels, numSamples);
+  interleaved.interleave(buffer);
+  char const* path = "avec-test-buffer-file.bin";
+
+  verify(saveBufferFile(path, BufferView<Float>(buffer)),
+         "checking saveBufferFile with a Buffer\n");
+  MappedBuffer<Float> mapped;
+  verify(mapped.open(path), "checking MappedBuffer::open\n");
+  auto const& view = mapped.getView();
+  verify(view.getNumChannels() == numChannels &&
+           view.getNumSamples() == numSamples,
+         "checking the size of a MappedBuffer\n");
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    verify(boost::alignment::is_aligned(view[c], BUFFER_FILE_ALIGNMENT),
+           "checking the alignment of a MappedBuffer\n");
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      verify(view[c][s] == buffer[c][s],
+             "checking the content of a MappedBuffer\n");
+    }
+  }
+  verify(!MappedInterleavedBuffer<Float>().open(path),
+         "checking that a planar file is not mapped as interleaved\n");
+  mapped.close();
+
+  verify(saveBufferFile(path, interleaved),
+         "checking saveBufferFile with an InterleavedBuffer\n");
+  MappedInterleavedBuffer<Float> mappedInterleaved;
+  verify(mappedInterleaved.open(path),
+         "checking MappedInterleavedBuffer::open\n");
+  auto const& interleavedView = mappedInterleaved.getView();
+  verify(interleavedView.getNumBuffers16() == interleaved.getNumBuffers16() &&
+           interleavedView.getNumBuffers8() == interleaved.getNumBuffers8() &&
+           interleavedView.getNumBuffers4() == interleaved.getNumBuffers4() &&
+           interleavedView.getNumBuffers2() == interleaved.getNumBuffers2(),
+         "checking the layout of a MappedInterleavedBuffer\n");
+  // the view of a buffer without samples should not index its VecBuffers
+  auto const bufferView = InterleavedView<Float>(interleaved);
+  for (uint32_t i = 0; i < interleaved.getNumBuffers16(); ++i) {
+    verify(bufferView.getBuffer16(i) == interleaved.getBuffer16(i),
+           "checking the view of an InterleavedBuffer\n");
+  }
+  for (uint32_t i = 0; i < interleaved.getNumBuffers8(); ++i) {
+    verify(bufferView.getBuffer8(i) == interleaved.getBuffer8(i),
+           "checking the view of an InterleavedBuffer\n");
+  }
+  for (uint32_t i = 0; i < interleaved.getNumBuffers4(); ++i) {
+    verify(bufferView.getBuffer4(i) == interleaved.getBuffer4(i),
+           "checking the view of an InterleavedBuffer\n");
+  }
+  for (uint32_t i = 0; i < interleaved.getNumBuffers2(); ++i) {
+    verify(bufferView.getBuffer2(i) == interleaved.getBuffer2(i),
+           "checking the view of an InterleavedBuffer\n");
+  }
+  auto output = Buffer<Float>(numChannels, numSamples);
+  verify(interleavedView.deinterleave(BufferView<Float>(output)),
+         "checking InterleavedView::deinterleave\n");
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      verify(*interleavedView.at(c, s) == buffer[c][s] &&
+               output[c][s] == buffer[c][s],
+             "checking the content of a MappedInterleavedBuffer\n");
+    }
+  }
+  verify(!MappedBuffer<Float>().open(path),
+         "checking that an interleaved file is not mapped as planar\n");
+  mappedInterleaved.close();
+  std::remove(path);
+  cout << "completed testing buffer files\n\n";
+}
+
+template<typename Float>
+void
+testCorruptBufferFiles()
+{
+  cout << "Testing corrupt buffer files with "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  char const* path = "avec-test-corrupt-buffer-file.bin";
+  auto const isRejected = [&](BufferFileHeader const& header) {
+    std::FILE* file = std::fopen(path, "wb");
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fclose(file);
+    bool const isRejected = !MappedBuffer<Float>().open(path) &&
+                            !MappedInterleavedBuffer<Float>().open(path);
+    std::remove(path);
+    return isRejected;
+  };
+  BufferFileHeader header;
+  header.scalarSize = sizeof(Float);
+  header.numChannels = 1;
+  header.numSamples = 1000;
+  verify(isRejected(header),
+         "checking that a file shorter than its samples is rejected\n");
+  header.numChannels = 1u << 31;
+  header.numSamples = 0;
+  verify(isRejected(header),
+         "checking that a file with too many channels is rejected\n");
+  header.layout = BufferFileLayout::interleaved;
+  header.numChannels = 4;
+  header.num4 = 1;
+  header.num16 = 1u << 28;
+  verify(isRejected(header),
+         "checking that a file with too many lanes is rejected\n");
+  header.numSamples = 1u << 31;
+  header.num16 = 1;
+  header.numChannels = 16;
+  header.num4 = 0;
+  verify(isRejected(header),
+         "checking that a file with too many samples is rejected\n");
+  header.numChannels = 3;
+  header.numSamples = 0;
+  header.num16 = 0;
+  header.num4 = 1;
+  header.num2 = 1;
+  verify(isRejected(header),
+         "checking that a file with more groups than needed is rejected\n");
+  header.num2 = 0;
+  verify(!isRejected(header),
+         "checking that a valid header is not rejected\n");
+  cout << "completed testing corrupt buffer files\n\n";
+}
+
+template<typename Float>
+void
+testPcmReader(uint32_t numChannels)
+{
+  cout << "Testing PcmReader with " << numChannels << " channels and "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  uint32_t const numFrames = 130;
+  uint32_t const blockSize = 32;
+  char const* path = "avec-test-pcm-reader.wav";
+  auto const sampleAt = [&](uint32_t frame, uint32_t channel) {
+    return (int16_t)((int)(frame * 100 + channel * 7) - 6000);
+  };
+  {
+    // 16 bit wav file
+    std::vector<int16_t> samples;
+    for (uint32_t f = 0; f < numFrames; ++f) {
+      for (uint32_t c = 0; c < numChannels; ++c) {
+        samples.push_back(sampleAt(f, c));
+      }
+    }
+    uint32_t const dataSize = (uint32_t)samples.size() * 2;
+    uint32_t const riffSize = 36 + dataSize;
+    uint32_t const fmtSize = 16;
+    uint16_t const formatTag = 1;
+    uint16_t const channels = (uint16_t)numChannels;
+    uint32_t const sampleRate = 48000;
+    uint32_t const byteRate = sampleRate * numChannels * 2;
+    uint16_t const blockAlign = (uint16_t)(numChannels * 2);
+    uint16_t const bitsPerSample = 16;
+    std::FILE* file = std::fopen(path, "wb");
+    std::fwrite("RIFF", 1, 4, file);
+    std::fwrite(&riffSize, 4, 1, file);
+    std::fwrite("WAVEfmt ", 1, 8, file);
+    std::fwrite(&fmtSize, 4, 1, file);
+    std::fwrite(&formatTag, 2, 1, file);
+    std::fwrite(&channels, 2, 1, file);
+    std::fwrite(&sampleRate, 4, 1, file);
+    std::fwrite(&byteRate, 4, 1, file);
+    std::fwrite(&blockAlign, 2, 1, file);
+    std::fwrite(&bitsPerSample, 2, 1, file);
+    std::fwrite("data", 1, 4, file);
+    std::fwrite(&dataSize, 4, 1, file);
+    std::fwrite(samples.data(), 2, samples.size(), file);
+    std::fclose(file);
+  }
+  PcmReader<Float> reader;
+  verify(reader.openWav(path), "checking PcmReader::openWav\n");
+  verify(reader.getNumChannels() == numChannels &&
+           reader.getNumFrames() == numFrames &&
+           reader.getFormat() == PcmFormat::int16,
+         "checking the format read by PcmReader::openWav\n");
+  auto block = InterleavedBuffer<Float>(numChannels, blockSize);
+  uint32_t frame = 0;
+  while (uint32_t const numRead = reader.read(block)) {
+    verify(numRead == std::min(blockSize, numFrames - frame),
+           "checking the number of frames read by PcmReader\n");
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t s = 0; s < blockSize; ++s) {
+        Float const expected =
+          s < numRead ? (Float)sampleAt(frame + s, c) / (Float)32768.0 : 0;
+        verify(*block.at(c, s) == expected,
+               "checking the samples read by PcmReader\n");
+      }
+    }
+    frame += numRead;
+  }
+  verify(frame == numFrames, "checking that PcmReader reads all frames\n");
+  verify(reader.openRaw(path, numChannels, PcmFormat::int16, 44) &&
+           reader.getNumFrames() == numFrames && reader.read(block) > 0 &&
+           *block.at(numChannels - 1, 1) ==
+             (Float)sampleAt(1, numChannels - 1) / (Float)32768.0,
+         "checking PcmReader::openRaw\n");
+  auto empty = InterleavedBuffer<Float>(numChannels, 0);
+  verify(reader.read(empty) == 0 && reader.read(block) > 0,
+         "checking PcmReader::read with an empty buffer\n");
+  reader.close();
+  std::remove(path);
+  cout << "completed testing PcmReader\n\n";
+}
+
+template<typename Float>
+void
+testRecorder(uint32_t numChannels)
+{
+  cout << "Testing Recorder with " << numChannels << " channels and "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  uint32_t const blockSize = 64;
+  uint32_t const numBlocks = 20;
+  char const* path = "avec-test-recorder.wav";
+  Recorder<Float> recorder;
+  verify(recorder.start(path, numChannels, blockSize, 32),
+         "checking Recorder::start\n");
+  auto block = InterleavedBuffer<Float>(numChannels, blockSize);
+  for (uint32_t b = 0; b < numBlocks; ++b) {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t s = 0; s < blockSize; ++s) {
+        *block.at(c, s) = (Float)((b * blockSize + s) * 100 + c);
+      }
+    }
+    // the last block is shorter
+    verify(recorder.push(block, b + 1 < numBlocks ? blockSize : 10),
+           "checking Recorder::push\n");
+    // let the background thread empty the queue, as between two callbacks
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  auto const emptyBlock = InterleavedBuffer<Float>(numChannels, 0);
+  verify(recorder.push(emptyBlock, 0),
+         "checking Recorder::push with an empty block\n");
+  verify(recorder.stop(), "checking Recorder::stop\n");
+  verify(recorder.getNumWrittenBlocks() == numBlocks + 1 &&
+           recorder.getNumDroppedBlocks() == 0,
+         "checking the counters of Recorder\n");
+  verify(recorder.getHighWaterMark() >= 1 &&
+           recorder.getHighWaterMark() <= numBlocks + 1,
+         "checking the high water mark of Recorder\n");
+  // all the samples fit in WRITE_SIZE bytes
+  verify(recorder.getNumWrittenChunks() == 1,
+         "checking that Recorder writes the samples in a single chunk\n");
+
+  PcmReader<Float> reader;
+  verify(reader.openWav(path), "checking the file written by Recorder\n");
+  uint32_t const numFrames = (numBlocks - 1) * blockSize + 10;
+  verify(reader.getNumChannels() == numChannels &&
+           reader.getNumFrames() == numFrames,
+         "checking the size of the file written by Recorder\n");
+  {
+    unsigned char header[22] = {};
+    std::FILE* file = std::fopen(path, "rb");
+    verify(file && std::fread(header, sizeof(header), 1, file) == 1,
+           "checking the header of the file written by Recorder\n");
+    if (file) {
+      std::fclose(file);
+    }
+    uint32_t const formatTag = header[20] | (header[21] << 8);
+    verify(formatTag == (numChannels > 2 ? 0xFFFEu : 3u),
+           "checking the format of the file written by Recorder\n");
+  }
+  uint32_t frame = 0;
+  while (uint32_t const numRead = reader.read(block)) {
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t s = 0; s < numRead; ++s) {
+        verify(*block.at(c, s) == (Float)((frame + s) * 100 + c),
+               "checking the samples written by Recorder\n");
+      }
+    }
+    frame += numRead;
+  }
+  reader.close();
+  std::remove(path);
+  cout << "completed testing Recorder\n\n";
+}
+
+template<typename Float>
+void
+testRecorderConcurrentStop()
+{
+  cout << "Testing Recorder::stop concurrently with Recorder::push in "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  // large blocks, so that push is often copying one when stop is called
+  uint32_t const numChannels = 13;
+  uint32_t const blockSize = 1024;
+  char const* path = "avec-test-recorder-stop.wav";
+  auto const block = InterleavedBuffer<Float>(numChannels, blockSize);
+  for (uint32_t run = 0; run < 100; ++run) {
+    Recorder<Float> recorder;
+    verify(recorder.start(path, numChannels, blockSize, 64),
+           "checking Recorder::start\n");
+    std::atomic<bool> isStopped{ false };
+    uint32_t numPushed = 0;
+    auto producer = std::thread([&] {
+      while (!isStopped) {
+        numPushed += recorder.push(block) ? 1 : 0;
+      }
+    });
+    std::this_thread::sleep_for(std::chrono::microseconds(100 * (run % 5)));
+    verify(recorder.stop(), "checking Recorder::stop\n");
+    isStopped = true;
+    producer.join();
+    verify(recorder.getNumWrittenBlocks() == numPushed,
+           "checking that Recorder writes every block pushed before stop\n");
+    PcmReader<Float> reader;
+    verify(reader.openWav(path) &&
+             reader.getNumFrames() == numPushed * blockSize,
+           "checking the size of the file written by Recorder\n");
+    reader.close();
+  }
+  std::remove(path);
+  cout << "completed testing Recorder::stop\n\n";
+}
+
+template<typename Float>
+void
+testRegroup(uint32_t numChannels)
+{
+  cout << "Testing regroup with " << numChannels << " channels and "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  uint32_t const numSamples = 33;
+  auto buffer = InterleavedBuffer<Float>(numChannels, numSamples);
+  for (uint32_t c = 0; c < numChannels; ++c) {
+    for (uint32_t s = 0; s < numSamples; ++s) {
+      *buffer.at(c, s) = (Float)(s * 100 + c);
+    }
+  }
+  auto const native = InterleavedView<Float>(buffer);
+  verify(native.hasNativeLayout(), "checking hasNativeLayout\n");
+  for (uint32_t width : { 2u, 4u, 8u }) {
+    // a layout using only groups of one width
+    uint32_t const numGroups = (numChannels + width - 1) / width;
+    aligned_vector<Float> memory(numGroups * width * numSamples, -1);
+    std::vector<Float*> groups;
+    for (uint32_t g = 0; g < numGroups; ++g) {
+      groups.push_back(memory.data() + g * width * numSamples);
+    }
+    auto const foreign =
+      InterleavedView<Float>(numChannels,
+                             numSamples,
+                             width == 2 ? groups : std::vector<Float*>{},
+                             width == 4 ? groups : std::vector<Float*>{},
+                             width == 8 ? groups : std::vector<Float*>{});
+    verify(regroup(native, foreign), "checking regroup\n");
+    for (uint32_t c = 0; c < foreign.getNumLanes(); ++c) {
+      for (uint32_t s = 0; s < numSamples; ++s) {
+        auto const value = memory[(c / width) * width * numSamples +
+                                  s * width + c % width];
+        verify(value == (c < numChannels ? (Float)(s * 100 + c) : 0),
+               "checking the layout produced by regroup\n");
+      }
+    }
+    auto regrouped = InterleavedBuffer<Float>(numChannels, numSamples);
+    regrouped.fill(-1);
+    verify(regroup(foreign, regrouped), "checking regroup\n");
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t s = 0; s < numSamples; ++s) {
+        verify(*regrouped.at(c, s) == *buffer.at(c, s),
+               "checking regroup to an InterleavedBuffer\n");
+      }
+    }
+  }
+  cout << "completed testing regroup\n\n";
+}
+
+void
+testAllocators()
+{
+  cout << "Testing AlignedArena and AlignedPool\n";
+  using Vec = SimdTypes<float>::Vec4;
+  AlignedArena arena(4096);
+  for (int block = 0; block < 2; ++block) {
+    arena.reset();
+    auto a = ArenaVecBuffer<Vec>(arena, 16, 1.f);
+    auto b = ArenaVecBuffer<Vec>(arena, 16, 2.f);
+    verify(boost::alignment::is_aligned(&a(0), ALIGNMENT),
+           "checking ArenaVecBuffer alignment\n");
+    verify(boost::alignment::is_aligned(&b(0), ALIGNMENT),
+           "checking ArenaVecBuffer alignment\n");
+    verify(&b(0) > &a(0), "checking that arena allocations are adjacent\n");
+    verify(arena.getNumAllocatedBytes() == 2 * 16 * 4 * sizeof(float),
+           "checking AlignedArena::getNumAllocatedBytes\n");
+    for (uint32_t i = 0; i < 16; ++i) {
+      verify(Vec(a[i])[0] == 1.f && Vec(b[i])[3] == 2.f,
+             "checking ArenaVecBuffer content\n");
+    }
+  }
+  verify(arena.allocate(8192) == nullptr,
+         "checking AlignedArena exhaustion\n");
+
+  AlignedPool pool(256, 4);
+  verify(pool.getNumFreeBlocks() == 4, "checking AlignedPool size\n");
+  {
+    auto a = PoolVecBuffer<Vec>(PoolAllocator<float>(pool), 16, 3.f);
+    verify(pool.getNumFreeBlocks() == 3, "checking AlignedPool allocate\n");
+    verify(boost::alignment::is_aligned(&a(0), ALIGNMENT),
+           "checking PoolVecBuffer alignment\n");
+    verify(Vec(a[15])[2] == 3.f, "checking PoolVecBuffer content\n");
+  }
+  verify(pool.getNumFreeBlocks() == 4, "checking AlignedPool deallocate\n");
+  cout << "completed testing AlignedArena and AlignedPool\n\n";
+}
+
+template<typename Vec>
+void
+testIntegerVecBuffer()
+{
+  using Int = typename ScalarTypes<Vec>::Float;
+  constexpr uint32_t N = size<Vec>();
+  cout << "Testing VecBuffer with " << N << " integers of " << 8 * sizeof(Int)
+       << " bits\n";
+  verify(std::is_same<avec::Vec<Int, N>, Vec>::value,
+         "checking Vec<Int, N> for integer vectors\n");
+  verify(std::is_same<typename MaskTypes<Vec>::Mask,
+                      typename VecTypes<Int, N>::Mask>::value,
+         "checking MaskTypes for integer vectors\n");
+  uint32_t const numSamples = 5;
+  auto buffer = VecBuffer<Vec>(numSamples, (Int)3);
+  verify(boost::alignment::is_aligned(&buffer(0), AlignmentOf<Vec>::value),
+         "checking the alignment of an integer VecBuffer\n");
+  for (uint32_t i = 0; i < buffer.getScalarSize(); ++i) {
+    verify(buffer(i) == 3, "checking VecBuffer::fill with integers\n");
+    buffer(i) = (Int)(i % 16);
+  }
+  for (uint32_t s = 0; s < numSamples; ++s) {
+    Vec v = buffer[s];
+    buffer[s] = (v << 1) + Vec((Int)1);
+  }
+  for (uint32_t i = 0; i < buffer.getScalarSize(); ++i) {
+    verify(buffer(i) == (Int)(2 * (i % 16) + 1),
+           "checking VecView with integer vectors\n");
+  }
+}
+
+template<class Vec>
+void
+testVecSpan()
+{
+  using Float = typename ScalarTypes<Vec>::Float;
+  constexpr uint32_t N = size<Vec>();
+  cout << "Testing VecSpan with " << N << " lanes of "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  uint32_t const numSamples = 37;
+  auto input = VecBuffer<Vec>(numSamples);
+  auto output = VecBuffer<Vec>(numSamples, (Float)-1);
+  for (uint32_t i = 0; i < input.getScalarSize(); ++i) {
+    input(i) = (Float)i;
+  }
+  auto const inputSpan = VecSpan<Vec>(input);
+  auto const outputSpan = VecSpan<Vec>(output);
+  verify(inputSpan.getNumSamples() == numSamples &&
+           inputSpan.end() - inputSpan.begin() == numSamples,
+         "checking VecSpan size\n");
+  std::transform(inputSpan.begin(),
+                 inputSpan.end(),
+                 outputSpan.begin(),
+                 [](Vec const& x) { return x * (Float)2; });
+  for (uint32_t i = 0; i < output.getScalarSize(); ++i) {
+    verify(output(i) == (Float)(2 * i), "checking std::transform\n");
+  }
+  Vec const sum = std::accumulate(
+    inputSpan.begin(), inputSpan.end(), Vec((Float)0), [](Vec a, Vec b) {
+      return a + b;
+    });
+  for (uint32_t i = 0; i < N; ++i) {
+    Float expected = 0;
+    for (uint32_t k = 0; k < numSamples; ++k) {
+      expected += (Float)(k * N + i);
+    }
+    verify(sum[i] == expected, "checking std::accumulate\n");
+  }
+  auto const subspan = outputSpan.subspan(5, 10);
+  verify(subspan.getNumSamples() == 10 &&
+           subspan.begin() == outputSpan.begin() + 5,
+         "checking VecSpan::subspan\n");
+  std::for_each(subspan.begin(), subspan.end(), [](VecView<Vec> v) {
+    v = Vec((Float)-3);
+  });
+  for (uint32_t i = 0; i < numSamples; ++i) {
+    Vec const x = outputSpan[i];
+    bool const isInSubspan = i >= 5 && i < 15;
+    for (uint32_t k = 0; k < N; ++k) {
+      verify(x[k] == (isInSubspan ? (Float)-3 : (Float)(2 * (i * N + k))),
+             "checking std::for_each over a subspan\n");
+    }
+  }
+  verify(outputSpan.subspan(30).getNumSamples() == numSamples - 30,
+         "checking VecSpan::subspan to the end\n");
+  // the vectors are swapped through their VecViews
+  std::rotate(inputSpan.begin(), inputSpan.begin() + 3, inputSpan.end());
+  for (uint32_t i = 0; i < numSamples; ++i) {
+    Vec const x = inputSpan[i];
+    for (uint32_t k = 0; k < N; ++k) {
+      verify(x[k] == (Float)(((i + 3) % numSamples) * N + k),
+             "checking std::rotate over a VecSpan\n");
+    }
+  }
+  auto const reversed = VecSpan<Vec>(input).subspan(0, 4);
+  std::reverse(reversed.begin(), reversed.end());
+  for (uint32_t i = 0; i < 4; ++i) {
+    Vec const x = reversed[i];
+    for (uint32_t k = 0; k < N; ++k) {
+      verify(x[k] == (Float)(((3 - i + 3) % numSamples) * N + k),
+             "checking std::reverse over a VecSpan\n");
+    }
+  }
+  auto it = outputSpan.end();
+  it -= 2;
+  verify(static_cast<Float*>(it[1]) == &output((numSamples - 1) * N) &&
+           static_cast<Float*>(*--it) == &output((numSamples - 3) * N),
+         "checking VecSpan iterator arithmetic\n");
+  if constexpr (std::is_same_v<Vec, typename SimdTypes<Float>::Vec4>) {
+    auto interleaved = InterleavedBuffer<Float>(4, numSamples);
+    if (interleaved.getNumBuffers4() > 0) {
+      auto const group = VecSpan<Vec>(interleaved.getBuffer4(0));
+      verify(group.getNumSamples() == numSamples &&
+               group.getData() == &interleaved.getBuffer4(0)(0),
+             "checking VecSpan over a group of an InterleavedBuffer\n");
+    }
+  }
+}
+
+template<class Vec>
+void
+testVecExpression()
+{
+  using Float = typename ScalarTypes<Vec>::Float;
+  constexpr uint32_t N = size<Vec>();
+  cout << "Testing VecExpression with " << N << " lanes of "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  uint32_t const numSamples = 19;
+  auto a = VecBuffer<Vec>(numSamples);
+  auto b = VecBuffer<Vec>(numSamples);
+  auto gain = VecBuffer<Vec>(numSamples);
+  auto output = VecBuffer<Vec>(numSamples, (Float)-1);
+  for (uint32_t i = 0; i < a.getScalarSize(); ++i) {
+    a(i) = (Float)i / (Float)a.getScalarSize() - (Float)0.25;
+    b(i) = (Float)1 - (Float)2 * a(i);
+    gain(i) = (Float)(i % 7) / (Float)6;
+  }
+  // the double precision functions of NeonMathDouble.hpp use the polynomials of
+  // the single precision ones
+  Float const tolerance = std::is_same_v<Float, float> ? 1.e-5f
+                          : AVEC_NEON                  ? 1.e-8
+                                                       : 1.e-12;
+  auto const check = [&](auto const& expected, std::string const& name) {
+    for (uint32_t i = 0; i < output.getScalarSize(); ++i) {
+      verify(std::abs(output(i) - (Float)expected(i)) <= tolerance,
+             "checking VecExpression " + name + "\n");
+    }
+  };
+
+  auto const crossfade = lazy(a) * gain + b * ((Float)1 - lazy(gain));
+  verify(crossfade.getNumSamples() == numSamples,
+         "checking VecExpression::getNumSamples\n");
+  crossfade.evaluate(output);
+  check([&](uint32_t i) { return a(i) * gain(i) + b(i) * (1 - gain(i)); },
+        "crossfade");
+
+  avec::exp(-lazy(a)).evaluate(output);
+  check([&](uint32_t i) { return std::exp(-a(i)); }, "exp");
+
+  avec::mul_add(avec::sin(lazy(a)), 2, lazy(b)).evaluate(output);
+  check([&](uint32_t i) { return std::sin(a(i)) * 2 + b(i); }, "mul_add");
+
+  avec::select(lazy(a) > (Float)0, lazy(a), (Float)0).evaluate(output);
+  check([&](uint32_t i) { return a(i) > 0 ? a(i) : 0; }, "select");
+
+  lazy([](Vec const& x, Vec const& y) { return max(x, y); }, a, b)
+    .evaluate(output);
+  check([&](uint32_t i) { return std::max(a(i), b(i)); }, "lazy function");
+
+  // in place, in chunks
+  auto const outputSpan = VecSpan<Vec>(output);
+  auto const square = lazy(output) * lazy(output);
+  for (uint32_t offset = 0; offset < numSamples; offset += 4) {
+    square.evaluate(outputSpan.subspan(offset, 4), offset);
+  }
+  check(
+    [&](uint32_t i) {
+      Float const x = std::max(a(i), b(i));
+      return x * x;
+    },
+    "evaluated in chunks");
+}
+
+template<class Vec>
+void
+testWidthReinterpretation()
+{
+  using Float = typename ScalarTypes<Vec>::Float;
+  constexpr uint32_t N = size<Vec>();
+  using HalfVec = avec::Vec<Float, N / 2>;
+  cout << "Testing width reinterpretation from " << N << " to " << N / 2
+       << " lanes of "
+       << (typeid(Float) == typeid(float) ? "single" : "double")
+       << " precision\n";
+  uint32_t const numSamples = 5;
+  auto buffer = VecBuffer<Vec>(numSamples);
+  for (uint32_t i = 0; i < buffer.getScalarSize(); ++i) {
+    buffer(i) = (Float)i;
+  }
+  auto const halves = VecSpan<Vec>(buffer).template reinterpret<HalfVec>();
+  verify(halves.getNumSamples() == 2 * numSamples &&
+           halves.getData() == &buffer(0),
+         "checking VecSpan::reinterpret to narrower vectors\n");
+  auto const whole = halves.template reinterpret<Vec>();
+  verify(whole.getNumSamples() == numSamples && whole.getData() == &buffer(0),
+         "checking VecSpan::reinterpret to wider vectors\n");
+  for (uint32_t i = 0; i < numSamples; ++i) {
+    HalfVec const low = buffer[i].getLow();
+    HalfVec const high = buffer[i].getHigh();
+    HalfVec const even = halves[2 * i];
+    HalfVec const odd = halves[2 * i + 1];
+    for (uint32_t k = 0; k < N / 2; ++k) {
+      verify(low[k] == (Float)(i * N + k) && even[k] == low[k],
+             "checking VecView::getLow\n");
+      verify(high[k] == (Float)(i * N + N / 2 + k) && odd[k] == high[k],
+             "checking VecView::getHigh\n");
+    }
+  }
+  // copies between views of different widths copy the first elements
+  halves[3] = buffer[0];
+  buffer[1] = halves[0];
+  buffer[2] = buffer[4];
+  for (uint32_t k = 0; k < N; ++k) {
+    Float const expected = k < N / 2 ? (Float)k : (Float)(k - N / 2);
+    verify(buffer(N + k) == expected &&
+             buffer(2 * N + k) == (Float)(4 * N + k),
+           "checking copies between VecViews of different widths\n");
+  }
+  auto unaligned = UnalignedVecView<HalfVec>(&buffer(1));
+  unaligned = buffer[4];
+  for (uint32_t k = 0; k < N / 2; ++k) {
+    verify(buffer(1 + k) == (Float)(4 * N + k),
+           "checking copies between VecViews of different access\n");
+  }
+}
+
+template<class Vec>
+void
+testMaskedVecView()
+{
+  using Float = typename ScalarTypes<Vec>::Float;
+  constexpr uint32_t N = size<Vec>();
+  cout << "Testing MaskedVecView with " << N << " lanes of "
+       << scalarName<Float>() << "\n";
+  auto buffer = VecBuffer<Vec>(1);
+  for (uint64_t bits : { (uint64_t)0, (uint64_t)1, (uint64_t)0b1010110101 }) {
+    for (uint32_t k = 0; k < N; ++k) {
+      buffer(k) = (Float)k;
+    }
+    auto const mask = laneMask<Vec>(bits);
+    auto view = buffer[0].masked(mask);
+    view = Vec((Float)-1);
+    for (uint32_t k = 0; k < N; ++k) {
+      bool const isStored = (bits >> k) & 1;
+      // on NEON and with GenericVec.hpp the masks are vectors, their true
+      // lanes have all the bits set and convert to true
+      verify(static_cast<bool>(mask[k]) == isStored, "checking laneMask\n");
+      verify(buffer(k) == (isStored ? (Float)-1 : (Float)k),
+             "checking MaskedVecView store\n");
+    }
+  }
+}
+
+template<typename Float>
+void
+testChannelMasks()
+{
+  cout << "Testing the channel masks of InterleavedBuffer<"
+       << (typeid(Float) == typeid(float) ? "float" : "double") << ">\n";
+  for (uint32_t numChannels = 1; numChannels < 24; numChannels += 3) {
+    auto buffer = InterleavedBuffer<Float>(numChannels, 8);
+    for (uint32_t c = 0; c < numChannels; c += 3) {
+      buffer.setChannelActive(c, false);
+    }
+    // and back, which updates only the mask of the group of the channel
+    buffer.setChannelActive(numChannels - 1, true);
+    auto const check = [&](auto const& group, auto const& mask) {
+      uint32_t const width = group.getScalarSize() / buffer.getNumSamples();
+      for (uint32_t lane = 0; lane < width; ++lane) {
+        bool isActive = false;
+        for (uint32_t c = 0; c < numChannels; ++c) {
+          if (buffer.at(c, 0) == &group(lane)) {
+            isActive = buffer.isChannelActive(c);
+          }
+        }
+        verify(static_cast<bool>(mask[lane]) == isActive,
+               "checking the mask of a group of an InterleavedBuffer\n");
+      }
+    };
+    // there are no groups of the vectors that are not available, which may
+    // not be implemented, as on NEON
+    if constexpr (SimdTypes<Float>::VEC16_AVAILABLE) {
+      for (uint32_t i = 0; i < buffer.getNumBuffers16(); ++i) {
+        check(buffer.getBuffer16(i), buffer.getMask16(i));
+      }
+    }
+    if constexpr (SimdTypes<Float>::VEC8_AVAILABLE) {
+      for (uint32_t i = 0; i < buffer.getNumBuffers8(); ++i) {
+        check(buffer.getBuffer8(i), buffer.getMask8(i));
+      }
+    }
+    if constexpr (SimdTypes<Float>::VEC4_AVAILABLE) {
+      for (uint32_t i = 0; i < buffer.getNumBuffers4(); ++i) {
+        check(buffer.getBuffer4(i), buffer.getMask4(i));
+      }
+    }
+    if constexpr (std::is_same<Float, float>::value ||
+                  supportsDoublePrecision) {
+      for (uint32_t i = 0; i < buffer.getNumBuffers2(); ++i) {
+        check(buffer.getBuffer2(i), buffer.getMask2(i));
+      }
+    }
+  }
+}
+
+#if AVEC_TEST_DISPATCH
+
+template<typename Float>
+void
+testKernels(Kernels<Float> const& kernels)
+{
+  uint32_t const numSamples = 37;
+  // see testVecExpression
+  Float const tolerance = std::is_same_v<Float, float> ? 1.e-5f
+                          : AVEC_NEON                  ? 1.e-8
+                                                       : 1.e-12;
+  auto const isClose = [&](Float x, Float y) {
+    return std::abs(x - y) <= tolerance * std::max((Float)1, std::abs(y));
+  };
+  // offset by one element, the kernels do not need aligned memory
+  std::vector<Float> input(numSamples + 1);
+  std::vector<Float> output(numSamples + 2, (Float)-7);
+  for (uint32_t i = 0; i < numSamples; ++i) {
+    input[i + 1] = (Float)0.1 + (Float)i / (Float)numSamples;
+  }
+  Float const* const in = input.data() + 1;
+  Float* const out = output.data() + 1;
+  auto const check = [&](auto const& expected, std::string const& name) {
+    bool isOk = output[0] == (Float)-7 && output[numSamples + 1] == (Float)-7;
+    for (uint32_t i = 0; i < numSamples; ++i) {
+      isOk = isOk && isClose(out[i], (Float)expected(in[i]));
+    }
+    verify(isOk, "checking the " + name + " kernel\n");
+  };
+  kernels.copy(in, out, numSamples, (Float)0.5);
+  check([](Float x) { return x * (Float)0.5; }, "copy");
+  kernels.fill(out, numSamples, (Float)3);
+  check([](Float) { return (Float)3; }, "fill");
+  kernels.exp(in, out, numSamples);
+  check([](Float x) { return std::exp(x); }, "exp");
+  kernels.log(in, out, numSamples);
+  check([](Float x) { return std::log(x); }, "log");
+  kernels.sin(in, out, numSamples);
+  check([](Float x) { return std::sin(x); }, "sin");
+  kernels.cos(in, out, numSamples);
+  check([](Float x) { return std::cos(x); }, "cos");
+  kernels.tanh(in, out, numSamples);
+  check([](Float x) { return std::tanh(x); }, "tanh");
+
+  auto const checkInterleaving = [&](uint32_t numChannels, uint32_t numFrames) {
+    Buffer<Float> channels(numChannels, numFrames);
+    Buffer<Float> deinterleaved(numChannels, numFrames);
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < numFrames; ++i) {
+        channels.get()[c][i] = (Float)(c * numFrames + i);
+      }
+    }
+    std::vector<Float> frames(numChannels * numFrames);
+    kernels.interleave(channels.get(), frames.data(), numChannels, numFrames);
+    kernels.deinterleave(
+      frames.data(), deinterleaved.get(), numChannels, numFrames);
+    bool isOk = true;
+    for (uint32_t c = 0; c < numChannels; ++c) {
+      for (uint32_t i = 0; i < numFrames; ++i) {
+        isOk = isOk && frames[i * numChannels + c] == channels.get()[c][i] &&
+               deinterleaved.get()[c][i] == channels.get()[c][i];
+      }
+    }
+    verify(isOk, "checking the interleave and deinterleave kernels\n");
+  };
+  // more channels than the vectors have lanes, and more samples than the
+  // kernels copy at a time
+  checkInterleaving(3, 37);
+  checkInterleaving(13, 150);
+}
+
+void
+testDispatch()
+{
+  Isa const activeIsa = getActiveIsa();
+  cout << "Testing the multi-versioned kernels, the active instruction set is "
+       << getIsaName(activeIsa) << "\n";
+  for (auto isa : { Isa::sse2, Isa::avx2, Isa::avx512, Isa::neon }) {
+    if (!isIsaAvailable(isa)) {
+      verify(!setActiveIsa(isa), "checking setActiveIsa\n");
+      continue;
+    }
+    cout << "Testing the kernels compiled for " << getIsaName(isa) << "\n";
+    verify(setActiveIsa(isa) && getActiveIsa() == isa,
+           "checking setActiveIsa\n");
+    testKernels(getKernels<float>());
+    testKernels(getKernels<double>());
+  }
+  setActiveIsa(activeIsa);
+}
+
+#endif
+
+template<class Vec>
+void
+testVecViewAccess()
+{
+  using Float = typename ScalarTypes<Vec>::Float;
+  constexpr uint32_t N = size<Vec>();
+  cout << "Testing unaligned and partial VecViews with " << N << " lanes of "
+       << scalarName<Float>() << "\n";
+  auto memory = aligned_vector<Float>(3 * N, (Float)-1);
+  for (uint32_t i = 0; i < memory.size(); ++i) {
+    memory[i] = (Float)i;
+  }
+  // a sliding window, as in a FIR filter
+  for (uint32_t offset = 0; offset < N; ++offset) {
+    Vec const v = UnalignedVecView<Vec>(&memory[offset]);
+    for (uint32_t i = 0; i < N; ++i) {
+      verify(v[i] == (Float)(offset + i), "checking UnalignedVecView load\n");
+    }
+  }
+  auto unaligned = UnalignedVecView<Vec>(&memory[1]);
+  unaligned = Vec((Float)7);
+  for (uint32_t i = 0; i < memory.size(); ++i) {
+    Float const expected = i >= 1 && i <= N ? (Float)7 : (Float)i;
+    verify(memory[i] == expected, "checking UnalignedVecView store\n");
+  }
+  // tails
+  for (uint32_t numElements = 0; numElements <= N; ++numElements) {
+    for (uint32_t i = 0; i < memory.size(); ++i) {
+      memory[i] = (Float)i;
+    }
+    auto view = PartialVecView<Vec>(&memory[N + 1], numElements);
+    verify(view.getNumElements() == numElements,
+           "checking PartialVecView::getNumElements\n");
+    Vec const v = view;
+    for (uint32_t i = 0; i < N; ++i) {
+      Float const expected = i < numElements ? (Float)(N + 1 + i) : (Float)0;
+      verify(v[i] == expected, "checking PartialVecView load\n");
+    }
+    view = Vec((Float)-3);
+    for (uint32_t i = 0; i < memory.size(); ++i) {
+      bool const isViewed = i >= N + 1 && i < N + 1 + numElements;
+      verify(memory[i] == (isViewed ? (Float)-3 : (Float)i),
+             "checking PartialVecView store\n");
+    }
+  }
+}
+
+void
+testHalfConversions()
+{
+  cout << "Testing half precision conversions\n";
+  struct Case
+  {
+    float value;
+    uint16_t half;
+  };
+  Case const cases[] = {
+    { 0.f, 0x0000 },
+    { -0.f, 0x8000 },
+    { 1.f, 0x3C00 },
+    { -2.f, 0xC000 },
+    { 65504.f, 0x7BFF },
+    { 65520.f, 0x7C00 },               // rounds to infinity
+    { std::ldexp(1.f, -14), 0x0400 }, // smallest normal
+    { std::ldexp(1.f, -24), 0x0001 }, // smallest subnormal
+    { std::ldexp(1.f, -26), 0x0000 }, // rounds to zero
+    { 1.f + std::ldexp(1.f, -11), 0x3C00 },     // tie, rounds to even
+    { 1.f + 3.f * std::ldexp(1.f, -11), 0x3C02 }, // tie, rounds to even
+    { INFINITY, 0x7C00 },
+    { -INFINITY, 0xFC00 },
+  };
+  for (auto const& c : cases) {
+    verify(Half::fromFloat(c.value) == c.half,
+           "checking the conversion from float to half\n");
+  }
+  // NaNs keep the high bits of the payload and become quiet, as with F16C
+  auto const fromBits = [](uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  };
+  auto const toBits = [](float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  };
+  verify(Half::fromFloat(fromBits(0x7F802000)) == 0x7E01 &&
+           Half::fromFloat(fromBits(0xFFC00001)) == 0xFE00 &&
+           toBits(Half::toFloat(0x7C01)) == 0x7FC02000 &&
+           toBits(Half::toFloat(0xFE00)) == 0xFFC00000,
+         "checking the conversions of NaNs between float and half\n");
+  for (uint32_t h = 0; h < 0x10000; ++h) {
+    auto const value = Half::toFloat((uint16_t)h);
+    bool const isNan = (h & 0x7C00) == 0x7C00 && (h & 0x3FF) != 0;
+    verify(std::isnan(value) == isNan &&
+             Half::fromFloat(value) == (isNan ? h | 0x200 : h),
+           "checking the round trip from half to float\n");
+  }
+  // the simd conversions give the same bits
+  uint16_t const halves[4] = { 0x7C01, 0xFE00, 0x3C00, 0x7DFF };
+  alignas(16) float floats[4];
+  Half::load<Vec4f>(halves).store_a(floats);
+  for (uint32_t i = 0; i < 4; ++i) {
+    verify(toBits(floats[i]) == toBits(Half::toFloat(halves[i])),
+           "checking the simd conversion from half to float\n");
+  }
+  floats[3] = fromBits(0x7F802000);
+  Vec4f v;
+  v.load_a(floats);
+  uint16_t stored[4];
+  Half::store(v, stored);
+  for (uint32_t i = 0; i < 4; ++i) {
+    verify(stored[i] == Half::fromFloat(floats[i]),
+           "checking the simd conversion from float to half\n");
+  }
+}
+
+void
+testBFloat16Conversions()
+{
+  cout << "Testing bfloat16 conversions\n";
+  struct Case
+  {
+    float value;
+    uint16_t bfloat16;
+  };
+  Case const cases[] = {
+    { 0.f, 0x0000 },
+    { -0.f, 0x8000 },
+    { 1.f, 0x3F80 },
+    { -2.f, 0xC000 },
+    { 1.f + std::ldexp(1.f, -8), 0x3F80 },       // tie, rounds to even
+    { 1.f + 3.f * std::ldexp(1.f, -8), 0x3F82 }, // tie, rounds to even
+    { 1.f + std::ldexp(1.f, -7) + std::ldexp(1.f, -9), 0x3F81 },
+    { FLT_MAX, 0x7F80 }, // rounds to infinity
+    { INFINITY, 0x7F80 },
+    { -INFINITY, 0xFF80 },
+  };
+  for (auto const& c : cases) {
+    verify(BFloat16::fromFloat(c.value) == c.bfloat16,
+           "checking the conversion from float to bfloat16\n");
+  }
+  verify(std::isnan(BFloat16::toFloat(BFloat16::fromFloat(NAN))),
+         "checking the conversion of NaN to bfloat16\n");
+  for (uint32_t b = 0; b < 0x10000; ++b) {
+    auto const value = BFloat16::toFloat((uint16_t)b);
+    verify(std::isnan(value) || BFloat16::fromFloat(value) == b,
+           "checking the round trip from bfloat16 to float\n");
+  }
+}
+
+template<class Vec, class Format>
+void
+testPackedVecBuffer(char const* formatName)
+{
+  constexpr uint32_t N = size<Vec>();
+  cout << "Testing PackedVecBuffer with " << N << " lanes of " << formatName
+       << "\n";
+  uint32_t const numSamples = 7;
+  auto buffer = PackedVecBuffer<Vec, Format>(numSamples, 0.5f);
+  verify(boost::alignment::is_aligned(buffer.getData(), ALIGNMENT),
+         "checking the alignment of PackedVecBuffer\n");
+  for (uint32_t i = 0; i < buffer.getScalarSize(); ++i) {
+    verify(buffer.get(i) == 0.5f, "checking PackedVecBuffer::fill\n");
+  }
+  for (uint32_t s = 0; s < numSamples; ++s) {
+    float values[N];
+    for (uint32_t i = 0; i < N; ++i) {
+      // the second value needs rounding
+      values[i] = (float)(s * N + i) * 0.25f + (i % 2 ? 1.f / 4096.f : 0.f);
+    }
+    Vec v;
+    v.load(values);
+    buffer[s] = v;
+  }
+  for (uint32_t s = 0; s < numSamples; ++s) {
+    Vec const v = buffer[s];
+    for (uint32_t i = 0; i < N; ++i) {
+      float const value =
+        (float)(s * N + i) * 0.25f + (i % 2 ? 1.f / 4096.f : 0.f);
+      verify(v[i] == Format::toFloat(Format::fromFloat(value)) &&
+               buffer.get(s * N + i) == v[i],
+             "checking the conversions of PackedVecView\n");
+    }
+  }
+  buffer.set(3, -1.5f);
+  verify(buffer.get(3) == -1.5f, "checking PackedVecBuffer::set\n");
+}
+
+void
+testAlignment()
+{
+  cout << "Testing containers with custom alignment\n";
+  constexpr std::size_t alignment = 4096;
+  auto vecBuffer = VecBuffer<SimdTypes<float>::Vec4, alignment>(16, 1.f);
+  verify(boost::alignment::is_aligned(&vecBuffer(0), alignment),
+         "checking VecBuffer alignment\n");
+  auto buffer = Buffer<double, alignment>(3, 100);
+  for (uint32_t c = 0; c < buffer.getNumChannels(); ++c) {
+    verify(boost::alignment::is_aligned(&buffer[c][0], alignment),
+           "checking Buffer alignment\n");
+  }
+  auto interleaved = InterleavedBuffer<double, alignment>(13, 100);
+  buffer.fill(2.0);
+  interleaved.interleave(buffer);
+  verify(boost::alignment::is_aligned(interleaved.at(0, 0), alignment),
+         "checking InterleavedBuffer alignment\n");
+  verify(interleaved.at(2, 99)[0] == 2.0,
+         "checking InterleavedBuffer with custom alignment\n");
+  auto aligned = Aligned<double, alignment>::make();
+  verify(boost::alignment::is_aligned(aligned.get(), alignment),
+         "checking Aligned::make\n");
+  static_assert(AlignmentOf<decltype(interleaved)>::value == alignment,
+                "checking AlignmentOf");
+  cout << "completed testing containers with custom alignment\n\n";
+}
+
+void
+testHugePages()
+{
+  cout << "Testing huge page allocations\n";
+  auto const hugePageSize = getHugePageSize();
+  verify(hugePageSize >= 4096 && (hugePageSize & (hugePageSize - 1)) == 0,
+         "checking getHugePageSize\n");
+  // 8 MiB, which is less than a huge page on some systems
+  constexpr uint32_t numSamples = 2 * 1024 * 1024;
+  for (auto policy : { HugePagePolicy::regular,
+                       HugePagePolicy::transparent,
+                       HugePagePolicy::hugeTlb }) {
+    auto backing = PageBacking::hugeTlb;
+    auto ptr = static_cast<float*>(
+      allocateHugePages(numSamples * sizeof(float), policy, &backing));
+    verify(ptr != nullptr, "checking allocateHugePages\n");
+    verify(!AVEC_HUGE_PAGES || boost::alignment::is_aligned(ptr, hugePageSize),
+           "checking the alignment of allocateHugePages\n");
+    verify(policy != HugePagePolicy::regular ||
+             backing == PageBacking::regular,
+           "checking allocateHugePages backing\n");
+    verify(policy == HugePagePolicy::hugeTlb ||
+             backing != PageBacking::hugeTlb,
+           "checking allocateHugePages backing\n");
+    std::fill(ptr, ptr + numSamples, 1.f);
+    // transparent huge pages may back any memory, depending on the system
+    verify(backing != PageBacking::hugeTlb ||
+             queryPageBacking(ptr) == PageBacking::hugeTlb,
+           "checking queryPageBacking\n");
+    freeHugePages(ptr, numSamples * sizeof(float));
+  }
+  auto buffer = Buffer<float, ALIGNMENT, HugePageAllocator<float>>(2, numSamples);
+  buffer.fill(1.f);
+  verify(buffer[1][numSamples - 1] == 1.f,
+         "checking Buffer with HugePageAllocator\n");
+  verify(buffer[1].get_allocator().getPageBacking() != PageBacking::hugeTlb &&
+           (AVEC_HUGE_PAGES ||
+            buffer[1].get_allocator().getPageBacking() == PageBacking::regular),
+         "checking the backing of a Buffer with HugePageAllocator\n");
+  auto small = Buffer<float, ALIGNMENT, HugePageAllocator<float>>(2, 256);
+  verify(small[0].get_allocator().getPageBacking() == PageBacking::regular,
+         "checking the backing of a small Buffer with HugePageAllocator\n");
+  auto interleaved = InterleavedBuffer<float>(2, numSamples);
+  interleaved.interleave(buffer);
+  verify(interleaved.at(1, numSamples - 1)[0] == 1.f,
+         "checking interleaving from a Buffer with HugePageAllocator\n");
+  cout << "completed testing huge page allocations\n\n";
+}
+
+void
+testNuma()
+{
+  cout << "Testing NUMA placement, " << getNumNumaNodes()
+       << " nodes, current node " << getCurrentNumaNode() << "\n";
+  uint32_t const numChannels = 19;
+  uint32_t const numSamples = 1 << 16;
+  auto buffer = FirstTouchInterleavedBuffer<float>(numChannels, numSamples);
+  verify(bindToNumaNode(buffer, getCurrentNumaNode()) || !AVEC_NUMA,
+         "checking bindToNumaNode\n");
+  buffer.fill(1.f);
+  verify(buffer.at(numChannels - 1, numSamples - 1)[0] == 1.f,
+         "checking FirstTouchInterleavedBuffer\n");
+  cout << "completed testing NUMA placement\n\n";
+}
+
 int
 main()
 {
@@ -130,6 +1558,117 @@ main()
   for (uint32_t c = 1; c < 32; ++c) {
     testInterleavedBuffer<float>(c, 128);
     testInterleavedBuffer<double>(c, 128);
+    if (c > 1) {
+      testFrameInterleaving<float>(c, 67);
+      testFrameInterleaving<double>(c, 67);
+      testRegroup<float>(c);
+      testRegroup<double>(c);
+    }
+  }
+  testVecTypes<float, 4>();
+  testVecTypes<float, 8>();
+  testVecTypes<double, 2>();
+  testVecTypes<double, 4>();
+#if !AVEC_NEON
+  // Vec16f and Vec8d are only declared on NEON, see NeonVec.hpp
+  testVecTypes<float, 16>();
+  testVecTypes<double, 8>();
+#endif
+  testVecFunctions<float, 4>();
+  testVecFunctions<float, 8>();
+  testVecFunctions<double, 2>();
+  testVecFunctions<double, 4>();
+  testNativeVec<float>();
+  testNativeVec<double>();
+  testBufferView<float>();
+  testBufferView<double>();
+  testCopyBuffer<float, double>();
+  testCopyBuffer<double, float>();
+  testCopyBuffer<float, float>();
+  testCopyBuffer<double, double>();
+  testCorruptBufferFiles<float>();
+  testCorruptBufferFiles<double>();
+  for (uint32_t c : { 1u, 3u, 6u, 13u }) {
+    testBufferFile<float>(c);
+    testBufferFile<double>(c);
+    testBufferFile<float>(c, 0);
+    testBufferFile<double>(c, 0);
+    testPcmReader<float>(c);
+    testPcmReader<double>(c);
+    testRecorder<float>(c);
+    testRecorder<double>(c);
   }
+  testRecorderConcurrentStop<float>();
+  testRecorderConcurrentStop<double>();
+  testAllocators();
+  testIntegerVecBuffer<Vec16c>();
+  testIntegerVecBuffer<Vec8s>();
+  testIntegerVecBuffer<Vec4i>();
+  testIntegerVecBuffer<Vec2q>();
+#if !AVEC_NEON
+  // only the 128 bit integer vectors are implemented on NEON
+  testIntegerVecBuffer<Vec32uc>();
+  testIntegerVecBuffer<Vec16s>();
+  testIntegerVecBuffer<Vec32us>();
+  testIntegerVecBuffer<Vec8i>();
+  testIntegerVecBuffer<Vec16ui>();
+  testIntegerVecBuffer<Vec8uq>();
+#endif
+  testVecSpan<Vec4f>();
+  testVecSpan<Vec8f>();
+  testVecSpan<Vec2d>();
+  testVecSpan<Vec4d>();
+  testVecExpression<Vec4f>();
+  testVecExpression<Vec8f>();
+  testVecExpression<Vec2d>();
+  testVecExpression<Vec4d>();
+  testWidthReinterpretation<Vec8f>();
+  testWidthReinterpretation<Vec4d>();
+#if !AVEC_NEON
+  // Vec16f and Vec8d are only declared on NEON, see NeonVec.hpp
+  testWidthReinterpretation<Vec16f>();
+  testWidthReinterpretation<Vec8d>();
+#endif
+  testMaskedVecView<Vec4f>();
+  testMaskedVecView<Vec8f>();
+  testMaskedVecView<Vec2d>();
+  testMaskedVecView<Vec4d>();
+#if !AVEC_NEON
+  // Vec16f and Vec8d are only declared on NEON, see NeonVec.hpp, and the
+  // NEON integer vectors have no select
+  testMaskedVecView<Vec16f>();
+  testMaskedVecView<Vec8d>();
+  testMaskedVecView<Vec8i>();
+#endif
+  testChannelMasks<float>();
+  testChannelMasks<double>();
+#if AVEC_TEST_DISPATCH
+  testDispatch();
+#endif
+  testVecViewAccess<Vec4f>();
+  testVecViewAccess<Vec8f>();
+  testVecViewAccess<Vec2d>();
+  testVecViewAccess<Vec4d>();
+  testVecViewAccess<Vec4i>();
+#if !AVEC_NEON
+  // Vec16f, Vec8d and Vec8i are only declared on NEON, see NeonVec.hpp
+  testVecViewAccess<Vec16f>();
+  testVecViewAccess<Vec8d>();
+  testVecViewAccess<Vec8i>();
+#endif
+  testHalfConversions();
+  testBFloat16Conversions();
+  testPackedVecBuffer<Vec4f, Half>("half");
+  testPackedVecBuffer<Vec8f, Half>("half");
+  testPackedVecBuffer<Vec4f, BFloat16>("bfloat16");
+  testPackedVecBuffer<Vec8f, BFloat16>("bfloat16");
+#if !AVEC_NEON
+  // Vec16f is only declared on NEON, see NeonVec.hpp
+  testPackedVecBuffer<Vec16f, Half>("half");
+  testPackedVecBuffer<Vec16f, BFloat16>("bfloat16");
+#endif
+  testAlignment();
+  testHugePages();
+  testNuma();
   return 0;
 }